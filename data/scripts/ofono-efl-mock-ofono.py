@@ -0,0 +1,867 @@
+#!/usr/bin/python
+#
+# Stand-in for oFono, to run the dialer and messages without a modem.
+#
+# Implements the parts of org.ofono that utils/ofono.c uses: Manager,
+# Modem, VoiceCallManager, VoiceCall, MessageManager, Message,
+# CallVolume and SupplementaryServices. Besides answering the clients
+# it generates load at the given rates: incoming calls, property storms
+# and incoming SMS, or does what a script says.
+#
+# Run it on a private bus with ofono-efl-mock-session.sh or
+# "make mock-ofono", the programs then find it as the real oFono.
+#
+# Script lines are "<seconds since start> <command> [args]":
+#       1.0 call 5551234 [name]
+#       2.5 answer              the newest incoming call
+#       4.0 hangup              the oldest call, from the remote side
+#       5.0 sms 5551234 text of the message
+#       6.0 storm 500           PropertyChanged signals at once
+#       9.0 quit
+#
+# tools/ofono-bench.c and tools/tones-check.c drive it with org.ofono.Mock
+# at /.
+
+from __future__ import print_function
+
+import sys, time, random, optparse
+
+import dbus
+import dbus.service
+import dbus.mainloop.glib
+
+try:
+    from gi.repository import GLib as mainloop
+except ImportError:
+    import gobject as mainloop
+
+OFONO = "org.ofono"
+MANAGER = OFONO + ".Manager"
+MODEM = OFONO + ".Modem"
+VOICE = OFONO + ".VoiceCallManager"
+CALL = OFONO + ".VoiceCall"
+MSG = OFONO + ".MessageManager"
+MESSAGE = OFONO + ".Message"
+VOLUME = OFONO + ".CallVolume"
+USSD = OFONO + ".SupplementaryServices"
+MOCK = OFONO + ".Mock"
+
+TICK = 10 # ms, generators emit what is due at each tick
+
+
+class OFonoError(dbus.DBusException):
+    def __init__(self, name, message=""):
+        dbus.DBusException.__init__(self, message)
+        self._dbus_error_name = OFONO + ".Error." + name
+
+
+def named(name):
+    """D-Bus member name of the decorated signal, so an object may emit
+    the same signal on several interfaces. Methods are looked up by the
+    name of the attribute, see ModemInterface.
+    """
+    def rename(func):
+        func.__name__ = name
+        return func
+    return rename
+
+
+def timestamp():
+    return time.strftime("%Y-%m-%dT%H:%M:%S%z")
+
+
+def props_dict(props):
+    return dbus.Dictionary(props, signature="sv")
+
+
+def later(seconds, func, *args):
+    def run():
+        func(*args)
+        return False
+    mainloop.timeout_add(int(seconds * 1000), run)
+
+
+class Stats(object):
+    def __init__(self):
+        self.counters = {}
+
+    def add(self, name, n=1):
+        self.counters[name] = self.counters.get(name, 0) + n
+
+    def dump(self, fp=sys.stderr):
+        for name in sorted(self.counters):
+            print("%-20s %d" % (name, self.counters[name]), file=fp)
+
+
+stats = Stats()
+
+
+class Call(dbus.service.Object):
+    def __init__(self, modem, path, number, name, state):
+        dbus.service.Object.__init__(self, modem.bus, path)
+        self.modem = modem
+        self.path = path
+        self.props = {
+            "LineIdentification": dbus.String(number),
+            "IncomingLine": dbus.String(""),
+            "Name": dbus.String(name),
+            "Multiparty": dbus.Boolean(False),
+            "State": dbus.String(state),
+            "Emergency": dbus.Boolean(False),
+            "RemoteHeld": dbus.Boolean(False),
+            "RemoteMultiparty": dbus.Boolean(False),
+        }
+
+    def state(self):
+        return self.props["State"]
+
+    def set(self, name, value):
+        self.props[name] = value
+        self.PropertyChanged(name, value)
+        stats.add("signals")
+
+    def state_set(self, state):
+        if self.state() == state:
+            return
+        if state == "active" and "StartTime" not in self.props:
+            self.set("StartTime", dbus.String(timestamp()))
+        self.set("State", dbus.String(state))
+
+    @dbus.service.method(CALL, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return props_dict(self.props)
+
+    @dbus.service.method(CALL, in_signature="", out_signature="")
+    def Answer(self):
+        if self.state() != "incoming":
+            raise OFonoError("Failed", "call is not incoming")
+        self.modem.call_answer(self)
+
+    @dbus.service.method(CALL, in_signature="", out_signature="")
+    def Hangup(self):
+        self.modem.call_remove(self, "local")
+
+    @dbus.service.method(CALL, in_signature="s", out_signature="")
+    def Deflect(self, number):
+        if self.state() not in ("incoming", "waiting"):
+            raise OFonoError("Failed", "call is not incoming")
+        self.modem.call_remove(self, "local")
+
+    @dbus.service.signal(CALL, signature="sv")
+    def PropertyChanged(self, name, value):
+        pass
+
+    @dbus.service.signal(CALL, signature="s")
+    def DisconnectReason(self, reason):
+        pass
+
+
+class Message(dbus.service.Object):
+    def __init__(self, modem, path, to, text):
+        dbus.service.Object.__init__(self, modem.bus, path)
+        self.modem = modem
+        self.path = path
+        self.to = to
+        self.text = text
+        self.props = {"State": dbus.String("pending")}
+
+    def state_set(self, state):
+        self.props["State"] = dbus.String(state)
+        self.PropertyChanged("State", self.props["State"])
+        stats.add("signals")
+        if state in ("sent", "failed"):
+            later(0.1, self.modem.message_remove, self)
+
+    @dbus.service.method(MESSAGE, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return props_dict(self.props)
+
+    @dbus.service.method(MESSAGE, in_signature="", out_signature="")
+    def Cancel(self):
+        if self.props["State"] != "pending":
+            raise OFonoError("Failed", "message was sent already")
+        self.state_set("failed")
+
+    @dbus.service.signal(MESSAGE, signature="sv")
+    def PropertyChanged(self, name, value):
+        pass
+
+
+# The interfaces of a modem share method names, dbus-python looks a
+# method up by its interface along the class hierarchy, so each one
+# with GetProperties, SetProperty or Cancel is a class of its own.
+
+class ModemInterface(dbus.service.Object):
+    @dbus.service.method(MODEM, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return self.properties(MODEM)
+
+    @dbus.service.method(MODEM, in_signature="sv", out_signature="")
+    def SetProperty(self, name, value):
+        self.set_property(MODEM, name, value,
+                          ("Powered", "Online", "Lockdown"))
+        if name == "Online":
+            ifaces = self.interfaces if value else ()
+            self.set(MODEM, "Interfaces",
+                     dbus.Array(ifaces, signature="s"))
+            if not value:
+                self.HangupAll()
+
+
+class VoiceInterface(dbus.service.Object):
+    @dbus.service.method(VOICE, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return self.properties(VOICE)
+
+
+class MsgInterface(dbus.service.Object):
+    @dbus.service.method(MSG, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return self.properties(MSG)
+
+    @dbus.service.method(MSG, in_signature="sv", out_signature="")
+    def SetProperty(self, name, value):
+        self.set_property(MSG, name, value, self.props[MSG].keys())
+
+
+class VolumeInterface(dbus.service.Object):
+    @dbus.service.method(VOLUME, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return self.properties(VOLUME)
+
+    @dbus.service.method(VOLUME, in_signature="sv", out_signature="")
+    def SetProperty(self, name, value):
+        self.set_property(VOLUME, name, value, self.props[VOLUME].keys())
+
+
+class UssdInterface(dbus.service.Object):
+    @dbus.service.method(USSD, in_signature="", out_signature="a{sv}")
+    def GetProperties(self):
+        return self.properties(USSD)
+
+    @dbus.service.method(USSD, in_signature="", out_signature="")
+    def Cancel(self):
+        self.set(USSD, "State", dbus.String("idle"))
+
+
+class Modem(ModemInterface, VoiceInterface, MsgInterface, VolumeInterface,
+            UssdInterface):
+    """All interfaces of a modem, oFono has them on the same path."""
+
+    interfaces = (VOICE, MSG, VOLUME, USSD)
+
+    def __init__(self, bus, path, index, opts):
+        dbus.service.Object.__init__(self, bus, path)
+        self.bus = bus
+        self.path = path
+        self.opts = opts
+        self.calls = [] # oldest first
+        self.messages = []
+        self.serial = 0
+        self.tones = [] # of each SendTones, see Manager.TakeTones
+        self.tones_in_flight = 0
+        self.tones_in_flight_max = 0
+        self.tones_until = 0
+        self.props = {
+            MODEM: {
+                "Powered": dbus.Boolean(True),
+                "Online": dbus.Boolean(True),
+                "Lockdown": dbus.Boolean(False),
+                "Emergency": dbus.Boolean(False),
+                "Name": dbus.String("Mock %d" % index),
+                "Manufacturer": dbus.String("ofono-efl"),
+                "Model": dbus.String("mock"),
+                "Serial": dbus.String("%015d" % (10 ** 14 + index)),
+                "Type": dbus.String(opts.modem_type),
+                "Features": dbus.Array(["sms", "ussd"], signature="s"),
+                "Interfaces": dbus.Array(self.interfaces, signature="s"),
+            },
+            VOICE: {
+                "EmergencyNumbers": dbus.Array(["112", "911"],
+                                               signature="s"),
+            },
+            MSG: {
+                "ServiceCenterAddress": dbus.String("+15550000000"),
+                "UseDeliveryReports": dbus.Boolean(False),
+                "Bearer": dbus.String("cs-preferred"),
+                "Alphabet": dbus.String("default"),
+            },
+            VOLUME: {
+                "Muted": dbus.Boolean(False),
+                "SpeakerVolume": dbus.Byte(50),
+                "MicrophoneVolume": dbus.Byte(50),
+            },
+            USSD: {
+                "State": dbus.String("idle"),
+            },
+        }
+        self.emitters = {
+            MODEM: self.ModemPropertyChanged,
+            VOICE: self.VoicePropertyChanged,
+            MSG: self.MsgPropertyChanged,
+            VOLUME: self.VolumePropertyChanged,
+            USSD: self.UssdPropertyChanged,
+        }
+
+    def properties(self, iface=MODEM):
+        return props_dict(self.props[iface])
+
+    def set(self, iface, name, value):
+        self.props[iface][name] = value
+        self.emitters[iface](name, value)
+        stats.add("signals")
+
+    def set_property(self, iface, name, value, writable):
+        if name not in writable:
+            raise OFonoError("InvalidArguments", "%s is read-only" % name)
+        self.set(iface, name, value)
+
+    def next_serial(self):
+        self.serial += 1
+        return self.serial
+
+    # calls
+
+    def call_add(self, number, name="", state="incoming"):
+        path = "%s/voicecall%02d" % (self.path, self.next_serial())
+        if state == "incoming" and self.calls_busy():
+            state = "waiting"
+        call = Call(self, path, number, name, state)
+        self.calls.append(call)
+        self.CallAdded(path, props_dict(call.props))
+        stats.add("calls")
+        return call
+
+    def call_remove(self, call, reason="remote"):
+        if call not in self.calls:
+            return
+        self.calls.remove(call)
+        call.DisconnectReason(reason)
+        call.state_set("disconnected")
+        self.CallRemoved(call.path)
+        call.remove_from_connection()
+        if not self.calls_busy():
+            for c in self.calls:
+                if c.state() == "waiting":
+                    c.state_set("incoming")
+                    break
+
+    def calls_busy(self):
+        return [c for c in self.calls
+                if c.state() in ("active", "held", "dialing", "alerting")]
+
+    def calls_in(self, *states):
+        return [c for c in self.calls if c.state() in states]
+
+    def call_find(self, path):
+        for c in self.calls:
+            if c.path == path:
+                return c
+        raise OFonoError("NotFound", "no call %s" % path)
+
+    def call_answer(self, call):
+        for c in self.calls_in("active"):
+            if c is not call:
+                c.state_set("held")
+        call.state_set("active")
+        if self.opts.talk > 0:
+            later(self.opts.talk, self.call_remove, call, "remote")
+
+    def _call_alerting(self, call):
+        if call in self.calls and call.state() == "dialing":
+            call.state_set("alerting")
+            later(self.opts.pickup / 2.0, self._call_picked_up, call)
+
+    def _call_picked_up(self, call):
+        if call in self.calls and call.state() == "alerting":
+            self.call_answer(call)
+
+    def _call_unanswered(self, call):
+        if call in self.calls and call.state() in ("incoming", "waiting"):
+            self.call_remove(call, "remote")
+
+    def incoming_call(self, number, name=""):
+        call = self.call_add(number, name, "incoming")
+        if self.opts.ring > 0:
+            later(self.opts.ring, self._call_unanswered, call)
+        return call
+
+    # messages
+
+    def incoming_message(self, sender, text):
+        self.IncomingMessage(text, props_dict({
+            "Sender": dbus.String(sender),
+            "SentTime": dbus.String(timestamp()),
+            "LocalSentTime": dbus.String(timestamp()),
+        }))
+        stats.add("sms in")
+
+    def message_remove(self, msg):
+        if msg in self.messages:
+            self.messages.remove(msg)
+            self.MessageRemoved(msg.path)
+            msg.remove_from_connection()
+
+    def _message_done(self, msg):
+        if msg not in self.messages or msg.props["State"] != "pending":
+            return
+        if random.random() < self.opts.sms_fail:
+            msg.state_set("failed")
+            stats.add("sms failed")
+        else:
+            msg.state_set("sent")
+            stats.add("sms sent")
+
+    # org.ofono.Modem
+
+    @dbus.service.signal(MODEM, signature="sv")
+    @named("PropertyChanged")
+    def ModemPropertyChanged(self, name, value):
+        pass
+
+    # org.ofono.VoiceCallManager
+
+    @dbus.service.method(VOICE, in_signature="ss", out_signature="o")
+    def Dial(self, number, hide_callerid):
+        if not number:
+            raise OFonoError("InvalidFormat", "empty number")
+        for c in self.calls_in("active"):
+            c.state_set("held")
+        call = self.call_add(number, "", "dialing")
+        later(self.opts.pickup / 2.0, self._call_alerting, call)
+        return call.path
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def Transfer(self):
+        for c in self.calls_in("active", "held"):
+            self.call_remove(c, "local")
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def SwapCalls(self):
+        active = self.calls_in("active")
+        held = self.calls_in("held")
+        for c in active:
+            c.state_set("held")
+        for c in held:
+            c.state_set("active")
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def ReleaseAndAnswer(self):
+        for c in self.calls_in("active"):
+            self.call_remove(c, "local")
+        self.HoldAndAnswer()
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def ReleaseAndSwap(self):
+        for c in self.calls_in("active"):
+            self.call_remove(c, "local")
+        for c in self.calls_in("held"):
+            c.state_set("active")
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def HoldAndAnswer(self):
+        waiting = self.calls_in("waiting", "incoming")
+        if waiting:
+            self.call_answer(waiting[0])
+        else:
+            self.SwapCalls()
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def HangupAll(self):
+        for c in list(self.calls):
+            self.call_remove(c, "local")
+
+    @dbus.service.method(VOICE, in_signature="o", out_signature="ao")
+    def PrivateChat(self, path):
+        call = self.call_find(path)
+        if not call.props["Multiparty"]:
+            raise OFonoError("InvalidArguments", "not in a multiparty")
+        call.set("Multiparty", dbus.Boolean(False))
+        rest = [c for c in self.calls if c.props["Multiparty"]]
+        for c in rest:
+            c.state_set("held")
+        call.state_set("active")
+        return dbus.Array([c.path for c in rest], signature="o")
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="ao")
+    def CreateMultiparty(self):
+        joined = self.calls_in("active", "held")
+        if len(joined) < 2:
+            raise OFonoError("NotAvailable", "needs an active and a held call")
+        for c in joined:
+            c.set("Multiparty", dbus.Boolean(True))
+            c.state_set("active")
+        return dbus.Array([c.path for c in joined], signature="o")
+
+    @dbus.service.method(VOICE, in_signature="", out_signature="")
+    def HangupMultiparty(self):
+        for c in [c for c in self.calls if c.props["Multiparty"]]:
+            self.call_remove(c, "local")
+
+    @dbus.service.method(VOICE, in_signature="s", out_signature="",
+                         async_callbacks=("reply", "error"))
+    def SendTones(self, tones, reply, error):
+        if not self.calls_in("active"):
+            error(OFonoError("Failed", "no active call"))
+            return
+        stats.add("tones", len(tones))
+        self.tones.append(str(tones))
+        self.tones_in_flight += 1
+        self.tones_in_flight_max = max(self.tones_in_flight_max,
+                                       self.tones_in_flight)
+        # oFono plays them after the ones it has, replies once played
+        now = time.time()
+        self.tones_until = (max(now, self.tones_until) +
+                            self.opts.tone * len(tones))
+
+        def played():
+            self.tones_in_flight -= 1
+            reply()
+        later(self.tones_until - now, played)
+
+    @dbus.service.method(VOICE, in_signature="",
+                         out_signature="a(oa{sv})")
+    def GetCalls(self):
+        return dbus.Array([(c.path, props_dict(c.props))
+                           for c in self.calls], signature="(oa{sv})")
+
+    @dbus.service.signal(VOICE, signature="oa{sv}")
+    def CallAdded(self, path, props):
+        pass
+
+    @dbus.service.signal(VOICE, signature="o")
+    def CallRemoved(self, path):
+        pass
+
+    @dbus.service.signal(VOICE, signature="sv")
+    @named("PropertyChanged")
+    def VoicePropertyChanged(self, name, value):
+        pass
+
+    # org.ofono.MessageManager
+
+    @dbus.service.method(MSG, in_signature="ss", out_signature="o")
+    def SendMessage(self, to, text):
+        if not to:
+            raise OFonoError("InvalidFormat", "empty number")
+        path = "%s/message_%08x" % (self.path, self.next_serial())
+        msg = Message(self, path, to, text)
+        self.messages.append(msg)
+        self.MessageAdded(path, props_dict(msg.props))
+        later(self.opts.sms_delay, self._message_done, msg)
+        return path
+
+    @dbus.service.method(MSG, in_signature="", out_signature="a(oa{sv})")
+    def GetMessages(self):
+        return dbus.Array([(m.path, props_dict(m.props))
+                           for m in self.messages], signature="(oa{sv})")
+
+    @dbus.service.signal(MSG, signature="sa{sv}")
+    def IncomingMessage(self, text, info):
+        pass
+
+    @dbus.service.signal(MSG, signature="sa{sv}")
+    def ImmediateMessage(self, text, info):
+        pass
+
+    @dbus.service.signal(MSG, signature="oa{sv}")
+    def MessageAdded(self, path, props):
+        pass
+
+    @dbus.service.signal(MSG, signature="o")
+    def MessageRemoved(self, path):
+        pass
+
+    @dbus.service.signal(MSG, signature="sv")
+    @named("PropertyChanged")
+    def MsgPropertyChanged(self, name, value):
+        pass
+
+    # org.ofono.CallVolume
+
+    @dbus.service.signal(VOLUME, signature="sv")
+    @named("PropertyChanged")
+    def VolumePropertyChanged(self, name, value):
+        pass
+
+    # org.ofono.SupplementaryServices
+
+    @dbus.service.method(USSD, in_signature="s", out_signature="sv")
+    def Initiate(self, command):
+        if not command.startswith(("*", "#")):
+            raise OFonoError("NotRecognized", command)
+        self.set(USSD, "State", dbus.String("user-response"))
+        return ("USSD", dbus.String("Mock menu for %s:\n1. yes\n2. no"
+                                    % command, variant_level=1))
+
+    @dbus.service.method(USSD, in_signature="s", out_signature="s")
+    def Respond(self, reply):
+        if self.props[USSD]["State"] != "user-response":
+            raise OFonoError("NotActive", "no request to respond to")
+        self.set(USSD, "State", dbus.String("idle"))
+        return "Mock got %s" % reply
+
+    @dbus.service.signal(USSD, signature="s")
+    def NotificationReceived(self, message):
+        pass
+
+    @dbus.service.signal(USSD, signature="s")
+    def RequestReceived(self, message):
+        pass
+
+    @dbus.service.signal(USSD, signature="sv")
+    @named("PropertyChanged")
+    def UssdPropertyChanged(self, name, value):
+        pass
+
+
+class Manager(dbus.service.Object):
+    """org.ofono.Manager and the mock controls, both at /."""
+
+    def __init__(self, bus, opts):
+        dbus.service.Object.__init__(self, bus, "/")
+        self.bus = bus
+        self.opts = opts
+        self.modems = []
+        self.storm_value = 0
+        for i in range(opts.modems):
+            self.modems.append(Modem(bus, "/mock_%d" % i, i, opts))
+
+    def modem(self):
+        return self.modems[0]
+
+    def modems_add(self, count):
+        for i in range(len(self.modems), len(self.modems) + count):
+            m = Modem(self.bus, "/mock_%d" % i, i, self.opts)
+            self.modems.append(m)
+            self.ModemAdded(m.path, m.properties())
+            stats.add("modems")
+
+    def storm(self, count):
+        """PropertyChanged of calls if any, of the volume otherwise,
+        the kind of signal that a flaky HFP link sends in bursts.
+        """
+        calls = [c for m in self.modems for c in m.calls]
+        for i in range(count):
+            m = self.modems[i % len(self.modems)]
+            self.storm_value = (self.storm_value + 1) % 100
+            if calls:
+                c = calls[i % len(calls)]
+                c.set("Name", c.props["Name"])
+            elif i % 2:
+                m.set(VOLUME, "SpeakerVolume", dbus.Byte(self.storm_value))
+            else:
+                m.set(VOLUME, "MicrophoneVolume",
+                      dbus.Byte(self.storm_value))
+
+    def answer(self):
+        for m in self.modems:
+            calls = m.calls_in("incoming")
+            if calls:
+                m.call_answer(calls[-1])
+                return
+
+    def hangup(self):
+        for m in self.modems:
+            if m.calls:
+                m.call_remove(m.calls[0], "remote")
+                return
+
+    @dbus.service.method(MANAGER, in_signature="",
+                         out_signature="a(oa{sv})")
+    def GetModems(self):
+        return dbus.Array([(m.path, m.properties()) for m in self.modems],
+                          signature="(oa{sv})")
+
+    @dbus.service.signal(MANAGER, signature="oa{sv}")
+    def ModemAdded(self, path, props):
+        pass
+
+    @dbus.service.signal(MANAGER, signature="o")
+    def ModemRemoved(self, path):
+        pass
+
+    @dbus.service.method(MOCK, in_signature="ss", out_signature="o")
+    def IncomingCall(self, number, name):
+        return self.modem().incoming_call(number, name).path
+
+    @dbus.service.method(MOCK, in_signature="", out_signature="")
+    def AnswerCall(self):
+        self.answer()
+
+    @dbus.service.method(MOCK, in_signature="", out_signature="")
+    def HangupCall(self):
+        self.hangup()
+
+    @dbus.service.method(MOCK, in_signature="ss", out_signature="")
+    def IncomingMessage(self, sender, text):
+        self.modem().incoming_message(sender, text)
+
+    @dbus.service.method(MOCK, in_signature="u", out_signature="")
+    def Storm(self, count):
+        self.storm(count)
+
+    # signals are all sent before the reply of these
+    @dbus.service.method(MOCK, in_signature="u", out_signature="")
+    def AddModems(self, count):
+        self.modems_add(count)
+
+    @dbus.service.method(MOCK, in_signature="u", out_signature="")
+    def IncomingMessages(self, count):
+        m = self.modem()
+        for i in range(count):
+            m.incoming_message(number(i), "Mock message %d" % i)
+
+    @dbus.service.method(MOCK, in_signature="d", out_signature="")
+    def SetToneTime(self, seconds):
+        self.opts.tone = seconds
+
+    @dbus.service.method(MOCK, in_signature="", out_signature="su")
+    def TakeTones(self):
+        """Tones of each SendTones to the first modem since the last
+        time, space separated, and the most of them in flight at once.
+        """
+        m = self.modem()
+        tones = " ".join(m.tones)
+        in_flight = m.tones_in_flight_max
+        m.tones = []
+        m.tones_in_flight_max = m.tones_in_flight
+        return (tones, dbus.UInt32(in_flight))
+
+    @dbus.service.method(MOCK, in_signature="", out_signature="a{su}")
+    def GetStats(self):
+        return dbus.Dictionary(stats.counters, signature="su")
+
+    @dbus.service.method(MOCK, in_signature="", out_signature="")
+    def Quit(self):
+        later(0, loop.quit)
+
+
+class Generator(object):
+    """Calls func rate times a second, up to count times if count."""
+
+    def __init__(self, rate, count, func):
+        self.rate = rate
+        self.count = count
+        self.func = func
+        self.done = 0
+        self.start = time.time()
+        if rate > 0:
+            mainloop.timeout_add(TICK, self.tick)
+
+    def tick(self):
+        due = int((time.time() - self.start) * self.rate) - self.done
+        if self.count:
+            due = min(due, self.count - self.done)
+        for i in range(due):
+            self.func(self.done)
+            self.done += 1
+        return not self.count or self.done < self.count
+
+
+def script_run(manager, path):
+    """Schedules the commands of a script file."""
+    for n, line in enumerate(open(path)):
+        words = line.split()
+        if not words or words[0].startswith("#"):
+            continue
+        try:
+            at = float(words[0])
+            cmd, args = words[1], words[2:]
+        except (ValueError, IndexError):
+            raise SystemExit("%s:%d: expected <seconds> <command>"
+                             % (path, n + 1))
+
+        m = manager.modem()
+        if cmd == "call" and args:
+            later(at, m.incoming_call, args[0], " ".join(args[1:]))
+        elif cmd == "answer":
+            later(at, manager.answer)
+        elif cmd == "hangup":
+            later(at, manager.hangup)
+        elif cmd == "sms" and args:
+            later(at, m.incoming_message, args[0], " ".join(args[1:]))
+        elif cmd == "storm" and args:
+            later(at, manager.storm, int(args[0]))
+        elif cmd == "quit":
+            later(at, loop.quit)
+        else:
+            raise SystemExit("%s:%d: unknown command %s"
+                             % (path, n + 1, cmd))
+
+
+def number(i):
+    return "555%07d" % (i % 10000000)
+
+
+parser = optparse.OptionParser(usage="%prog [options]",
+                               description="Mock oFono service.")
+parser.add_option("--session", action="store_true",
+                  help="use the session bus, default is the system bus "
+                  "as oFono (export DBUS_SYSTEM_BUS_ADDRESS for a "
+                  "private one)")
+parser.add_option("--modems", type="int", default=1)
+parser.add_option("--modem-type", default="hfp",
+                  help="Type of the modems [%default]")
+parser.add_option("--call-rate", type="float", default=0,
+                  help="incoming calls per second")
+parser.add_option("--calls", type="int", default=0,
+                  help="stop after these calls, 0 for no limit")
+parser.add_option("--ring", type="float", default=30,
+                  help="seconds before the caller gives up [%default]")
+parser.add_option("--talk", type="float", default=0,
+                  help="seconds before an answered call is hung up by "
+                  "the remote side, 0 never")
+parser.add_option("--pickup", type="float", default=2,
+                  help="seconds before a dialed call is answered "
+                  "[%default]")
+parser.add_option("--tone", type="float", default=0.1,
+                  help="seconds to play each DTMF tone [%default]")
+parser.add_option("--storm-rate", type="float", default=0,
+                  help="PropertyChanged signals per second")
+parser.add_option("--sms-rate", type="float", default=0,
+                  help="incoming SMS per second")
+parser.add_option("--sms", type="int", default=0,
+                  help="stop after these SMS, 0 for no limit")
+parser.add_option("--sms-delay", type="float", default=0.5,
+                  help="seconds to send a message [%default]")
+parser.add_option("--sms-fail", type="float", default=0,
+                  help="fraction of sent messages that fail")
+parser.add_option("--duration", type="float", default=0,
+                  help="quit after these seconds, 0 never")
+parser.add_option("--script", help="file with timed commands")
+parser.add_option("--seed", type="int", help="random seed")
+
+opts, args = parser.parse_args()
+if opts.modems < 1:
+    parser.error("--modems must be at least 1")
+random.seed(opts.seed)
+
+dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
+if opts.session:
+    bus = dbus.SessionBus()
+else:
+    bus = dbus.SystemBus()
+
+name = dbus.service.BusName(OFONO, bus, do_not_queue=True)
+manager = Manager(bus, opts)
+loop = mainloop.MainLoop()
+
+Generator(opts.call_rate, opts.calls,
+          lambda i: manager.modems[i % opts.modems].incoming_call(number(i)))
+Generator(opts.storm_rate, 0, lambda i: manager.storm(1))
+Generator(opts.sms_rate, opts.sms,
+          lambda i: manager.modems[i % opts.modems].incoming_message(
+              number(i), "Mock message %d" % i))
+if opts.script:
+    script_run(manager, opts.script)
+if opts.duration > 0:
+    later(opts.duration, loop.quit)
+
+print("Mock oFono with %d modem(s) on %s" %
+      (opts.modems, bus.get_unique_name()), file=sys.stderr)
+try:
+    loop.run()
+except KeyboardInterrupt:
+    pass
+stats.dump()
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# Runs a command against the mock oFono on a private D-Bus, so nothing
+# of the machine's buses or modems is touched. Options before "--" go
+# to ofono-efl-mock-ofono.py, for example:
+#
+#       ofono-efl-mock-session.sh --call-rate 0.2 --talk 5 -- dialer/dialer
+#
+# Without a command it waits until the mock quits or is interrupted,
+# printing the bus address to connect to.
+
+MOCK=${MOCK:-`dirname "$0"`/ofono-efl-mock-ofono.py}
+if [ -z "$PYTHON" ]; then
+    PYTHON=python3
+    command -v $PYTHON >/dev/null 2>&1 || PYTHON=python
+fi
+
+MOCK_ARGS=
+while [ $# -gt 0 ]; do
+    if [ "$1" = "--" ]; then
+        shift
+        break
+    fi
+    MOCK_ARGS="$MOCK_ARGS $1"
+    shift
+done
+
+eval `dbus-launch --sh-syntax` || exit 1
+# utils/ofono.c looks for oFono on the system bus, the rest on session
+DBUS_SYSTEM_BUS_ADDRESS=$DBUS_SESSION_BUS_ADDRESS
+export DBUS_SESSION_BUS_ADDRESS DBUS_SYSTEM_BUS_ADDRESS
+
+MOCK_PID=
+cleanup() {
+    [ -n "$MOCK_PID" ] && kill $MOCK_PID 2>/dev/null && wait $MOCK_PID
+    kill $DBUS_SESSION_BUS_PID 2>/dev/null
+}
+trap cleanup EXIT
+trap 'exit 130' INT TERM
+
+$PYTHON "$MOCK" $MOCK_ARGS &
+MOCK_PID=$!
+
+# wait for it to own org.ofono
+i=0
+until dbus-send --print-reply --dest=org.freedesktop.DBus / \
+        org.freedesktop.DBus.NameHasOwner string:org.ofono 2>/dev/null |
+        grep -q "boolean true"; do
+    i=$((i + 1))
+    if [ $i -gt 50 ] || ! kill -0 $MOCK_PID 2>/dev/null; then
+        echo "mock oFono did not start" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+if [ $# -eq 0 ]; then
+    echo "DBUS_SESSION_BUS_ADDRESS='$DBUS_SESSION_BUS_ADDRESS'"
+    echo "DBUS_SYSTEM_BUS_ADDRESS='$DBUS_SYSTEM_BUS_ADDRESS'"
+    wait $MOCK_PID
+    MOCK_PID=
+    exit 0
+fi
+
+"$@"
@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+# Scrolls the history, contacts and messages overview lists filled with
+# synthetic data, see utils/scroll-bench.h. Run from the build directory:
+#
+#       ofono-efl-scroll-bench.sh [records] [report]
+#
+# The data goes to a temporary XDG_CONFIG_HOME, written by the storage
+# benchmark and the contacts importer, and the programs load it as
+# usual. The programs must be configured with --enable-scroll-bench. They run on the buffer engine against the mock oFono, so no
+# display or modem is needed; ENGINE=x11 under Xvfb works as well.
+# STEP is the pixels scrolled per frame.
+
+RECORDS=${1:-10000}
+REPORT=${2:-scroll-bench.txt}
+case "$REPORT" in
+    /*) ;;
+    *) REPORT=`pwd`/$REPORT ;;
+esac
+ENGINE=${ENGINE:-buffer}
+STEP=${STEP:-32}
+SCRIPTS=`dirname "$0"`
+THEME=`pwd`/data/themes/default.edj
+
+for p in tools/ofono-efl-storage-bench tools/ofono-efl-contacts-import \
+        dialer/dialer messages/messages; do
+    if [ ! -x "$p" ]; then
+        echo "$p not built" >&2
+        exit 1
+    fi
+done
+
+TMP=`mktemp -d /tmp/ofono-efl-scroll-XXXXXX` || exit 1
+trap 'rm -rf "$TMP"' EXIT
+trap 'exit 130' INT TERM
+
+CFG=$TMP/config/lemolo
+mkdir -p "$CFG/messages" || exit 1
+
+THREADS=$((RECORDS / 10))
+[ $THREADS -gt 0 ] || THREADS=1
+
+tools/ofono-efl-storage-bench --store history --records $RECORDS \
+    --appends 0 --dir "$CFG" --no-header > /dev/null || exit 1
+tools/ofono-efl-storage-bench --store messages --records $RECORDS \
+    --threads $THREADS --appends 0 --dir "$CFG/messages" \
+    --no-header > /dev/null || exit 1
+
+# first, last, work, home, mobile
+awk -v n=$RECORDS 'BEGIN {
+    for (i = 0; i < n; i++)
+        printf("First%07d, Last%07d, 555%07d, 556%07d, 557%07d\n",
+               i, n - i, i, i, i);
+}' > "$TMP/contacts.csv"
+tools/ofono-efl-contacts-import -o "$CFG" "$TMP/contacts.csv" \
+    > /dev/null || exit 1
+
+rm -f "$REPORT"
+XDG_CONFIG_HOME=$TMP/config
+ELM_ENGINE=$ENGINE
+OFONO_EFL_SCROLL_BENCH=$REPORT
+OFONO_EFL_SCROLL_BENCH_STEP=$STEP
+export XDG_CONFIG_HOME ELM_ENGINE OFONO_EFL_SCROLL_BENCH \
+    OFONO_EFL_SCROLL_BENCH_STEP
+
+for p in dialer/dialer messages/messages; do
+    echo "$p: $RECORDS records" >> "$REPORT"
+    "$SCRIPTS/ofono-efl-mock-session.sh" --ring 0 -- \
+        $p --theme "$THEME" || exit 1
+done
+
+cat "$REPORT"
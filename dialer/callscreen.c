@@ -8,6 +8,11 @@
 #include "ofono.h"
 #include "util.h"
 #include "simple-popup.h"
+#include "trace.h"
+
+/* SendTones in flight, and how long to wait for more digits meanwhile */
+#define TONES_DEPTH 3
+#define TONES_COALESCE 0.08
 
 typedef struct _Callscreen
 {
@@ -28,10 +33,7 @@ typedef struct _Callscreen
 		Eina_List *list;
 	} calls;
 	Ecore_Timer *elapsed_updater;
-	struct {
-		Eina_Strbuf *todo;
-		OFono_Pending *pending;
-	} tones;
+	OFono_Tones_Queue *tones;
 	struct {
 		const void *call;
 		const char *number;
@@ -811,22 +813,12 @@ done:
 	_call_disconnected_done(ctx, reason);
 }
 
-static void _tones_send_reply(void *data, OFono_Error err)
+static void _tones_send_reply(void *data __UNUSED__, const char *tones,
+				OFono_Error err)
 {
-	Callscreen *ctx = data;
-
 	if (err)
-		ERR("Failed to send tones: %d", err);
-
-	ctx->tones.pending = NULL;
-	if (eina_strbuf_length_get(ctx->tones.todo) > 0) {
-		const char *tones = eina_strbuf_string_get(ctx->tones.todo);
-
-		DBG("Send pending tones: %s", tones);
-		ctx->tones.pending = ofono_tones_send(
-			tones, _tones_send_reply, ctx);
-		eina_strbuf_reset(ctx->tones.todo);
-	}
+		ERR("Failed to send tones %s: %s", tones,
+			ofono_error_message_get(err));
 }
 
 static void _on_pressed(void *data, Evas_Object *obj __UNUSED__,
@@ -877,11 +869,7 @@ static void _on_clicked(void *data, Evas_Object *obj __UNUSED__,
 		dtmf = "#";
 
 	if (dtmf) {
-		if (!ctx->tones.pending)
-			ctx->tones.pending = ofono_tones_send(
-				dtmf, _tones_send_reply, ctx);
-		else
-			eina_strbuf_append_char(ctx->tones.todo, dtmf[0]);
+		ofono_tones_queue_push(ctx->tones, dtmf);
 		return;
 	}
 
@@ -1001,6 +989,7 @@ static void _call_added(void *data, OFono_Call *c)
 	}
 
 	gui_call_enter();
+	trace_mark(ofono_call_path_get(c), "dialer-callscreen");
 }
 
 static void _call_removed(void *data, OFono_Call *c)
@@ -1286,9 +1275,17 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 	ofono_call_disconnected_cb_del(callback_node_call_disconnected);
 	ofono_modem_changed_cb_del(callback_node_modem_changed);
 
-	eina_strbuf_free(ctx->tones.todo);
-	if (ctx->tones.pending)
-		ofono_pending_cancel(ctx->tones.pending);
+	if (ctx->tones) {
+		OFono_Tones_Queue_Stats stats;
+
+		ofono_tones_queue_stats_get(ctx->tones, &stats);
+		if (stats.queued)
+			INF("tones: %u sent in %u calls, %u failed, "
+				"latency avg %0.3fs max %0.3fs", stats.sent,
+				stats.calls, stats.failed, stats.latency_avg,
+				stats.latency_max);
+		ofono_tones_queue_free(ctx->tones);
+	}
 
 	if (ctx->elapsed_updater)
 		ecore_timer_del(ctx->elapsed_updater);
@@ -1309,7 +1306,8 @@ Evas_Object *callscreen_add(Evas_Object *parent)
 
 	ctx = calloc(1, sizeof(Callscreen));
 	ctx->self = obj;
-	ctx->tones.todo = eina_strbuf_new();
+	ctx->tones = ofono_tones_queue_new(TONES_DEPTH, TONES_COALESCE,
+						_tones_send_reply, ctx);
 
 	evas_object_data_set(obj, "callscreen.ctx", ctx);
 
@@ -1347,16 +1345,20 @@ Evas_Object *callscreen_add(Evas_Object *parent)
 	elm_object_part_content_set(obj, "elm.swallow.multiparty-details",
 					ctx->multiparty.sc);
 
-	callback_node_call_added = ofono_call_added_cb_add(_call_added, ctx);
+	/* the screen follows the call before anything else */
+	callback_node_call_added = ofono_call_added_cb_priority_add(
+		_call_added, ctx, OFONO_CALLBACK_PRIORITY_REALTIME);
 
-	callback_node_call_removed =
-		ofono_call_removed_cb_add(_call_removed, ctx);
+	callback_node_call_removed = ofono_call_removed_cb_priority_add(
+		_call_removed, ctx, OFONO_CALLBACK_PRIORITY_REALTIME);
 
-	callback_node_call_changed =
-		ofono_call_changed_cb_add(_call_changed, ctx);
+	callback_node_call_changed = ofono_call_changed_cb_priority_add(
+		_call_changed, ctx, OFONO_CALLBACK_PRIORITY_REALTIME);
 
 	callback_node_call_disconnected =
-		ofono_call_disconnected_cb_add(_call_disconnected, ctx);
+		ofono_call_disconnected_cb_priority_add(
+			_call_disconnected, ctx,
+			OFONO_CALLBACK_PRIORITY_REALTIME);
 
 	callback_node_modem_changed =
 		ofono_modem_changed_cb_add(_ofono_changed, ctx);
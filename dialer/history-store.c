@@ -0,0 +1,240 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <Eet.h>
+#include <Ecore_File.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "history-store.h"
+
+#ifndef EET_COMPRESSION_DEFAULT
+#define EET_COMPRESSION_DEFAULT 1
+#endif
+
+#define HISTORY_ENTRY "history"
+
+typedef struct _History_List {
+	Eina_List *list;
+} History_List;
+
+struct _History_Store {
+	char *path, *bkp;
+	Eet_Data_Descriptor *edd;
+	Eet_Data_Descriptor *edd_list;
+	History_List *calls;
+	size_t record_size;
+	Eina_Free_Cb record_free;
+	Eina_Bool dirty;
+};
+
+static void _history_call_free(void *data)
+{
+	History_Call *call = data;
+
+	eina_stringshare_del(call->line_id);
+	eina_stringshare_del(call->name);
+	free(call);
+}
+
+static void _history_store_descriptor_init(History_Store *store)
+{
+	Eet_Data_Descriptor_Class eddc;
+
+	/* eet checks the names on read, these are the ones of the files
+	 * written before the store moved out of history.c
+	 */
+	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, History_Call);
+	eddc.name = "Call_Info";
+	/* eet allocates whole records, the caller's part zeroed */
+	eddc.size = store->record_size;
+	store->edd = eet_data_descriptor_stream_new(&eddc);
+
+	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, History_List);
+	eddc.name = "Call_Info_List";
+	store->edd_list = eet_data_descriptor_stream_new(&eddc);
+
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd, History_Call,
+					"completed", completed, EET_T_UCHAR);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd, History_Call,
+					"incoming", incoming, EET_T_UCHAR);
+
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd, History_Call,
+					"start_time", start_time, EET_T_LONG_LONG);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd, History_Call,
+					"end_time", end_time, EET_T_LONG_LONG);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd, History_Call,
+					"line_id", line_id, EET_T_STRING);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd, History_Call,
+					"name", name, EET_T_STRING);
+
+	EET_DATA_DESCRIPTOR_ADD_LIST(store->edd_list, History_List, "list",
+					list, store->edd);
+}
+
+static History_List *_history_store_file_read(History_Store *store,
+						const char *path)
+{
+	History_List *calls = NULL;
+	Eet_File *efile;
+
+	efile = eet_open(path, EET_FILE_MODE_READ);
+	if (efile) {
+		calls = eet_data_read(efile, store->edd_list, HISTORY_ENTRY);
+		eet_close(efile);
+	}
+
+	return calls;
+}
+
+History_Store *history_store_new(const char *path, size_t record_size,
+					Eina_Free_Cb record_free)
+{
+	History_Store *store;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(path, NULL);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(record_size < sizeof(History_Call),
+					NULL);
+
+	store = calloc(1, sizeof(History_Store));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, NULL);
+
+	store->path = strdup(path);
+	EINA_SAFETY_ON_NULL_GOTO(store->path, err_path);
+
+	if (asprintf(&store->bkp, "%s.bkp", path) < 0)
+		goto err_bkp;
+
+	eet_init();
+	ecore_file_init();
+
+	store->record_size = record_size;
+	store->record_free = record_free ? record_free : _history_call_free;
+	_history_store_descriptor_init(store);
+
+	store->calls = _history_store_file_read(store, store->path);
+	if (!store->calls)
+		store->calls = _history_store_file_read(store, store->bkp);
+	if (!store->calls)
+		store->calls = calloc(1, sizeof(History_List));
+	EINA_SAFETY_ON_NULL_GOTO(store->calls, err_read);
+
+	DBG("read %u calls from %s", eina_list_count(store->calls->list),
+		store->path);
+	return store;
+
+err_read:
+	eet_data_descriptor_free(store->edd);
+	eet_data_descriptor_free(store->edd_list);
+	ecore_file_shutdown();
+	eet_shutdown();
+	free(store->bkp);
+err_bkp:
+	free(store->path);
+err_path:
+	free(store);
+	return NULL;
+}
+
+void history_store_free(History_Store *store)
+{
+	History_Call *call;
+
+	EINA_SAFETY_ON_NULL_RETURN(store);
+
+	if (store->dirty)
+		history_store_save(store);
+
+	EINA_LIST_FREE(store->calls->list, call)
+		store->record_free(call);
+	free(store->calls);
+
+	eet_data_descriptor_free(store->edd);
+	eet_data_descriptor_free(store->edd_list);
+	free(store->path);
+	free(store->bkp);
+	free(store);
+	ecore_file_shutdown();
+	eet_shutdown();
+}
+
+const Eina_List *history_store_calls_get(const History_Store *store)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, NULL);
+	return store->calls->list;
+}
+
+History_Call *history_store_call_add(History_Store *store)
+{
+	History_Call *call;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, NULL);
+
+	call = calloc(1, store->record_size);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(call, NULL);
+
+	store->calls->list = eina_list_prepend(store->calls->list, call);
+	store->dirty = EINA_TRUE;
+	return call;
+}
+
+void history_store_call_del(History_Store *store, History_Call *call)
+{
+	EINA_SAFETY_ON_NULL_RETURN(store);
+	EINA_SAFETY_ON_NULL_RETURN(call);
+
+	store->calls->list = eina_list_remove(store->calls->list, call);
+	store->dirty = EINA_TRUE;
+	store->record_free(call);
+}
+
+void history_store_clear(History_Store *store)
+{
+	History_Call *call;
+
+	EINA_SAFETY_ON_NULL_RETURN(store);
+
+	EINA_LIST_FREE(store->calls->list, call)
+		store->record_free(call);
+	store->dirty = EINA_TRUE;
+}
+
+void history_store_dirty_set(History_Store *store)
+{
+	EINA_SAFETY_ON_NULL_RETURN(store);
+	store->dirty = EINA_TRUE;
+}
+
+Eina_Bool history_store_dirty_get(const History_Store *store)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	return store->dirty;
+}
+
+Eina_Bool history_store_save(History_Store *store)
+{
+	Eet_File *efile;
+	Eina_Bool ret;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	DBG("save history (%u calls, dirty: %d) to %s",
+		eina_list_count(store->calls->list), store->dirty,
+		store->path);
+
+	ecore_file_unlink(store->bkp);
+	ecore_file_mv(store->path, store->bkp);
+	efile = eet_open(store->path, EET_FILE_MODE_WRITE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(efile, EINA_FALSE);
+	ret = eet_data_write(efile, store->edd_list, HISTORY_ENTRY,
+				store->calls, EET_COMPRESSION_DEFAULT) > 0;
+	if (!ret)
+		ERR("Could not write the history log file");
+
+	eet_close(efile);
+	if (ret)
+		store->dirty = EINA_FALSE;
+	return ret;
+}
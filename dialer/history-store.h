@@ -0,0 +1,50 @@
+#ifndef _EFL_OFONO_HISTORY_STORE_H__
+#define _EFL_OFONO_HISTORY_STORE_H__ 1
+
+/*
+ * Call history file, without any UI. The list of calls is a single eet
+ * entry rewritten on every save, the previous file is kept as a backup
+ * and read if the file is broken.
+ *
+ * Records are History_Call or a larger structure starting with it, only
+ * the History_Call part is saved, the rest starts zeroed.
+ */
+
+typedef struct _History_Call {
+	long long start_time;
+	long long end_time;
+	const char *line_id; /* stringshare */
+	const char *name; /* stringshare */
+	Eina_Bool completed;
+	Eina_Bool incoming;
+} History_Call;
+
+typedef struct _History_Store History_Store;
+
+/* record_free frees records the store drops, line_id and name included,
+ * NULL if records are plain History_Call.
+ */
+History_Store *history_store_new(const char *path, size_t record_size,
+					Eina_Free_Cb record_free);
+
+/* saves if there are unsaved changes */
+void history_store_free(History_Store *store);
+
+/* newest first */
+const Eina_List *history_store_calls_get(const History_Store *store);
+
+/* zeroed, before all others */
+History_Call *history_store_call_add(History_Store *store);
+
+void history_store_call_del(History_Store *store, History_Call *call);
+
+void history_store_clear(History_Store *store);
+
+/* records changed in place must be flagged */
+void history_store_dirty_set(History_Store *store);
+
+Eina_Bool history_store_dirty_get(const History_Store *store);
+
+Eina_Bool history_store_save(History_Store *store);
+
+#endif
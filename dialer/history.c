@@ -2,7 +2,6 @@
 #include "config.h"
 #endif
 #include <Elementary.h>
-#include <Eet.h>
 #include <Eina.h>
 #include <time.h>
 #include <limits.h>
@@ -13,23 +12,11 @@
 #include "util.h"
 #include "gui.h"
 #include "simple-popup.h"
-
-#ifndef EET_COMPRESSION_DEFAULT
-#define EET_COMPRESSION_DEFAULT 1
-#endif
-
-#define HISTORY_ENTRY "history"
-
-typedef struct _Call_Info_List {
-	Eina_List *list;
-	Eina_Bool dirty;
-} Call_Info_List;
+#include "history-store.h"
+#include "scroll-bench.h"
 
 typedef struct _History {
-	char *path, *bkp;
-	Eet_Data_Descriptor *edd;
-	Eet_Data_Descriptor *edd_list;
-	Call_Info_List *calls;
+	History_Store *store;
 	Elm_Genlist_Item_Class *itc;
 	Evas_Object *self;
 	Evas_Object *clear_popup;
@@ -39,20 +26,15 @@ typedef struct _History {
 } History;
 
 typedef struct _Call_Info {
-	long long start_time;
-	long long end_time;
-	long long creation_time; /* not in edd */
-	const char *line_id;
-	const char *name;
-	Eina_Bool completed;
-	Eina_Bool incoming;
-	const OFono_Call *call; /* not in edd */
+	History_Call base; /* saved, must be first */
+	long long creation_time; /* not saved */
+	const OFono_Call *call; /* not saved */
 	History *history;
-	Elm_Object_Item *it_all; /*not in edd */
-	Elm_Object_Item *it_missed; /*not in edd */
-	const Contact_Info *contact; /* not in edd */
-	const char *contact_type; /* not in edd */
-	double contact_last; /* not in edd, last time it was searched */
+	Elm_Object_Item *it_all; /* not saved */
+	Elm_Object_Item *it_missed; /* not saved */
+	const Contact_Info *contact; /* not saved */
+	const char *contact_type; /* not saved */
+	double contact_last; /* not saved, last time it was searched */
 #define CONTACT_LAST_THRESHOLD 1.0
 } Call_Info;
 
@@ -88,7 +70,7 @@ static Eina_Bool _history_time_updater(void *data)
 	 *   uselessly update all the thousand items.
 	 */
 
-	if (!ctx->calls->list) {
+	if (!history_store_calls_get(ctx->store)) {
 		ctx->updater = NULL;
 		return EINA_FALSE;
 	}
@@ -100,9 +82,9 @@ static Eina_Bool _history_time_updater(void *data)
 	it = elm_genlist_first_item_get(ctx->genlist_all);
 	for (; it != NULL; it = elm_genlist_item_next_get(it)) {
 		const Call_Info *call_info = elm_object_item_data_get(it);
-		long long t = call_info->end_time;
+		long long t = call_info->base.end_time;
 		if (EINA_UNLIKELY(t == 0)) {
-			t = call_info->start_time;
+			t = call_info->base.start_time;
 			if (EINA_UNLIKELY(t == 0))
 				t = call_info->creation_time;
 		}
@@ -114,9 +96,9 @@ static Eina_Bool _history_time_updater(void *data)
 	it = elm_genlist_first_item_get(ctx->genlist_missed);
 	for (; it != NULL; it = elm_genlist_item_next_get(it)) {
 		const Call_Info *call_info = elm_object_item_data_get(it);
-		long long t = call_info->end_time;
+		long long t = call_info->base.end_time;
 		if (EINA_UNLIKELY(t == 0)) {
-			t = call_info->start_time;
+			t = call_info->base.start_time;
 			if (EINA_UNLIKELY(t == 0))
 				t = call_info->creation_time;
 		}
@@ -156,7 +138,7 @@ static void _history_time_updater_start(History *history)
 		history->updater, win_focused, obj_visible);
 	if (history->updater)
 		return;
-	if (!history->calls->list)
+	if (!history_store_calls_get(history->store))
 		return;
 	if ((!win_focused) || (!obj_visible))
 		return;
@@ -173,21 +155,22 @@ static Call_Info *_history_call_info_search(const History *history,
 						const OFono_Call *call)
 {
 	Call_Info *call_info;
-	Eina_List *l;
+	const Eina_List *l;
 	long long t = ofono_call_full_start_time_get(call);
 	const char *line_id = ofono_call_line_id_get(call); /* stringshare */
 
-	EINA_LIST_FOREACH(history->calls->list, l, call_info) {
+	EINA_LIST_FOREACH(history_store_calls_get(history->store), l,
+				call_info) {
 		if (call_info->call == call)
 			return call_info;
 		else if (!call_info->call) {
-			if ((t > 0) && (call_info->start_time == t) &&
-				(line_id == call_info->line_id)) {
+			if ((t > 0) && (call_info->base.start_time == t) &&
+				(line_id == call_info->base.line_id)) {
 				DBG("associated existing log %p %s (%lld) with "
 					"call %p %s (%lld)",
 					call_info,
-					call_info->line_id,
-					call_info->start_time,
+					call_info->base.line_id,
+					call_info->base.start_time,
 					call, line_id, t);
 				call_info->call = call;
 				return call_info;
@@ -207,25 +190,25 @@ static Eina_Bool _history_call_info_update(Call_Info *call_info)
 
 	if (state == OFONO_CALL_STATE_INCOMING ||
 		state == OFONO_CALL_STATE_WAITING) {
-		if (!call_info->incoming) {
-			call_info->incoming = EINA_TRUE;
+		if (!call_info->base.incoming) {
+			call_info->base.incoming = EINA_TRUE;
 			return EINA_TRUE;
 		}
 	} else if (state == OFONO_CALL_STATE_DIALING ||
 			state == OFONO_CALL_STATE_ALERTING) {
-		if (!call_info->incoming) {
-			call_info->incoming = EINA_FALSE;
+		if (!call_info->base.incoming) {
+			call_info->base.incoming = EINA_FALSE;
 			return EINA_TRUE;
 		}
 	} else if (state == OFONO_CALL_STATE_ACTIVE ||
 			state == OFONO_CALL_STATE_HELD) {
-		if (!call_info->completed) {
-			call_info->start_time = ofono_call_full_start_time_get
+		if (!call_info->base.completed) {
+			call_info->base.start_time = ofono_call_full_start_time_get
 				(call_info->call);
-			if (call_info->start_time == 0)
-				call_info->start_time = call_info->creation_time;
+			if (call_info->base.start_time == 0)
+				call_info->base.start_time = call_info->creation_time;
 
-			call_info->completed = EINA_TRUE;
+			call_info->base.completed = EINA_TRUE;
 			return EINA_TRUE;
 		}
 	}
@@ -254,51 +237,27 @@ static void _history_call_changed(void *data, OFono_Call *call)
 	call_info = _history_call_info_search(history, call);
 	DBG("call=%p, id=%s, state=%d, completed=%d, incoming=%d, info=%p",
 		call, line_id, state,
-		call_info ? call_info->completed : EINA_FALSE,
-		call_info ? call_info->incoming : EINA_FALSE,
+		call_info ? call_info->base.completed : EINA_FALSE,
+		call_info ? call_info->base.incoming : EINA_FALSE,
 		call_info);
 
 	if (call_info)
 		goto end;
 
-	call_info = calloc(1, sizeof(Call_Info));
+	call_info = (Call_Info *)history_store_call_add(history->store);
 	EINA_SAFETY_ON_NULL_RETURN(call_info);
 
 	call_info->call = call;
-	call_info->start_time = ofono_call_full_start_time_get(call);
+	call_info->base.start_time = ofono_call_full_start_time_get(call);
 	call_info->creation_time = time(NULL);
-	if (call_info->start_time == 0)
-		call_info->start_time = call_info->creation_time;
-	call_info->line_id = eina_stringshare_add(line_id);
-	call_info->name = eina_stringshare_add(ofono_call_name_get(call));
-	history->calls->list =
-		eina_list_prepend(history->calls->list, call_info);
-	history->calls->dirty = EINA_TRUE;
+	if (call_info->base.start_time == 0)
+		call_info->base.start_time = call_info->creation_time;
+	call_info->base.line_id = eina_stringshare_add(line_id);
+	call_info->base.name = eina_stringshare_add(ofono_call_name_get(call));
 
 end:
 	if (_history_call_info_update(call_info))
-		history->calls->dirty = EINA_TRUE;
-}
-
-static void _history_call_log_save(History *history)
-{
-	Eet_File *efile;
-
-	EINA_SAFETY_ON_NULL_RETURN(history->calls);
-	DBG("save history (%u calls, dirty: %d) to %s",
-		eina_list_count(history->calls->list), history->calls->dirty,
-		history->path);
-
-	ecore_file_unlink(history->bkp);
-	ecore_file_mv(history->path, history->bkp);
-	efile = eet_open(history->path, EET_FILE_MODE_WRITE);
-	EINA_SAFETY_ON_NULL_RETURN(efile);
-	if (!(eet_data_write(efile,
-				history->edd_list, HISTORY_ENTRY,
-				history->calls, EET_COMPRESSION_DEFAULT)))
-		ERR("Could in the history log file");
-
-	eet_close(efile);
+		history_store_dirty_set(history->store);
 }
 
 static void _history_call_removed(void *data, OFono_Call *call)
@@ -314,19 +273,19 @@ static void _history_call_removed(void *data, OFono_Call *call)
 	DBG("call=%p, id=%s, info=%p", call, line_id, call_info);
 	EINA_SAFETY_ON_NULL_RETURN(call_info);
 
-	if (call_info->start_time == 0)
-		call_info->start_time = call_info->creation_time;
+	if (call_info->base.start_time == 0)
+		call_info->base.start_time = call_info->creation_time;
 
-	start = call_info->start_time;
+	start = call_info->base.start_time;
 	tm = ctime(&start);
 
-	call_info->end_time = time(NULL);
+	call_info->base.end_time = time(NULL);
 	call_info->call = NULL;
 
-	if (call_info->completed)
+	if (call_info->base.completed)
 		INF("Call end:  %s at %s", line_id, tm);
 	else {
-		if (!call_info->incoming)
+		if (!call_info->base.incoming)
 			INF("Not answered: %s at %s", line_id, tm);
 		else {
 			INF("Missed: %s at %s", line_id, tm);
@@ -339,7 +298,7 @@ static void _history_call_removed(void *data, OFono_Call *call)
 						call_info, NULL,
 						ELM_GENLIST_ITEM_NONE,
 						_on_item_clicked,
-						call_info->line_id);
+						call_info->base.line_id);
 				elm_genlist_item_show
 					(it, ELM_GENLIST_ITEM_SCROLLTO_IN);
 				call_info->it_missed = it;
@@ -349,8 +308,8 @@ static void _history_call_removed(void *data, OFono_Call *call)
 		}
 	}
 
-	history->calls->dirty = EINA_TRUE;
-	_history_call_log_save(history);
+	history_store_dirty_set(history->store);
+	history_store_save(history->store);
 
 	if (call_info->it_all)
 		elm_genlist_item_update(call_info->it_all);
@@ -360,7 +319,7 @@ static void _history_call_removed(void *data, OFono_Call *call)
 						call_info, NULL,
 						ELM_GENLIST_ITEM_NONE,
 						_on_item_clicked,
-						call_info->line_id);
+						call_info->base.line_id);
 		elm_genlist_item_show(it, ELM_GENLIST_ITEM_SCROLLTO_IN);
 		call_info->it_all = it;
 		call_info->history = history;
@@ -380,7 +339,7 @@ static void _on_contact_changed(void *data, Contact_Info *contact)
 {
 	Call_Info *call_info = data;
 
-	if (contact_info_number_check(contact, call_info->line_id))
+	if (contact_info_number_check(contact, call_info->base.line_id))
 		goto update;
 
 	contact_info_on_del_callback_del(contact, _on_contact_del, call_info);
@@ -409,8 +368,8 @@ static void _call_info_free(Call_Info *call_info)
 							call_info);
 	}
 
-	eina_stringshare_del(call_info->line_id);
-	eina_stringshare_del(call_info->name);
+	eina_stringshare_del(call_info->base.line_id);
+	eina_stringshare_del(call_info->base.name);
 	free(call_info);
 }
 
@@ -418,27 +377,16 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 			Evas_Object *obj __UNUSED__, void *event __UNUSED__)
 {
 	History *history = data;
-	Call_Info *call_info;
 
 	if (history->updater)
 		ecore_poller_del(history->updater);
 
-	if (history->calls->dirty)
-		_history_call_log_save(history);
-
 	ofono_call_removed_cb_del(callback_node_call_removed);
 	ofono_call_changed_cb_del(callback_node_call_changed);
-	eet_data_descriptor_free(history->edd);
-	eet_data_descriptor_free(history->edd_list);
-	EINA_LIST_FREE(history->calls->list, call_info)
-		_call_info_free(call_info);
-	free(history->calls);
+	/* saves what is still dirty */
+	history_store_free(history->store);
 	elm_genlist_item_class_free(history->itc);
-	free(history->path);
-	free(history->bkp);
 	free(history);
-	ecore_file_shutdown();
-	eet_shutdown();
 }
 
 static void _on_hide(void *data, Evas *e __UNUSED__,
@@ -473,83 +421,31 @@ static void _on_win_focus_in(void *data, Evas *e __UNUSED__,
 	_history_time_updater_start(history);
 }
 
-static void _history_call_info_descriptor_init(Eet_Data_Descriptor **edd,
-						Eet_Data_Descriptor **edd_list)
-{
-	Eet_Data_Descriptor_Class eddc;
-
-	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Call_Info);
-	*edd = eet_data_descriptor_stream_new(&eddc);
-
-	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Call_Info_List);
-	*edd_list = eet_data_descriptor_stream_new(&eddc);
-
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd, Call_Info,
-					"completed", completed, EET_T_UCHAR);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd, Call_Info,
-					"incoming", incoming, EET_T_UCHAR);
-
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd, Call_Info,
-					"start_time", start_time, EET_T_LONG_LONG);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd, Call_Info,
-					"end_time", end_time, EET_T_LONG_LONG);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd, Call_Info,
-					"line_id", line_id, EET_T_STRING);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd, Call_Info,
-					"name", name, EET_T_STRING);
-
-	EET_DATA_DESCRIPTOR_ADD_LIST(*edd_list, Call_Info_List, "list", list,
-					*edd);
-}
-
-static void _history_call_log_read(History *history)
+static void _history_items_add(History *history)
 {
 	Call_Info *call_info;
-	Eina_List *l;
-	Eet_File *efile;
-	Call_Info_List *calls = NULL;
+	const Eina_List *l;
 	Elm_Object_Item *it;
 
-	efile = eet_open(history->path, EET_FILE_MODE_READ);
-
-	if (efile) {
-		calls = eet_data_read(efile, history->edd_list, HISTORY_ENTRY);
-		eet_close(efile);
-	}
-
-	if (!calls) {
-		efile = eet_open(history->bkp, EET_FILE_MODE_READ);
-		if (efile) {
-			calls = eet_data_read(efile, history->edd_list,
-						HISTORY_ENTRY);
-			eet_close(efile);
-		}
-	}
-
-	if (!calls)
-		calls = calloc(1, sizeof(Call_Info_List));
-
-	history->calls = calls;
-	EINA_SAFETY_ON_NULL_RETURN(history->calls);
-
-	EINA_LIST_FOREACH(history->calls->list, l, call_info) {
+	EINA_LIST_FOREACH(history_store_calls_get(history->store), l,
+				call_info) {
 		it = elm_genlist_item_append(history->genlist_all,
 						history->itc,
 						call_info, NULL,
 						ELM_GENLIST_ITEM_NONE,
 						_on_item_clicked,
-						call_info->line_id);
+						call_info->base.line_id);
 		call_info->it_all = it;
 		call_info->history = history;
 
-		if (call_info->completed)
+		if (call_info->base.completed)
 			continue;
 
 		it = elm_genlist_item_append(history->genlist_missed,
 						history->itc, call_info, NULL,
 						ELM_GENLIST_ITEM_NONE,
 						_on_item_clicked,
-						call_info->line_id);
+						call_info->base.line_id);
 		call_info->it_missed = it;
 		call_info->history = history;
 	}
@@ -575,26 +471,23 @@ static void _history_call_info_del(Call_Info *call_info)
 	if (call_info->it_missed)
 		elm_object_item_del(call_info->it_missed);
 
-	ctx->calls->list = eina_list_remove(ctx->calls->list, call_info);
-	ctx->calls->dirty = EINA_TRUE;
-	_history_call_log_save(ctx);
+	/* frees call_info */
+	history_store_call_del(ctx->store, &call_info->base);
+	history_store_save(ctx->store);
 
-	if ((!ctx->calls->list) && (ctx->updater)) {
+	if ((!history_store_calls_get(ctx->store)) && (ctx->updater)) {
 		ecore_poller_del(ctx->updater);
 		ctx->updater = NULL;
 	}
-
-	_call_info_free(call_info);
 }
 
 static void _history_clear_do(void *data, Evas_Object *obj __UNUSED__,
 				void *event_info __UNUSED__)
 {
 	History *ctx = data;
-	Call_Info *call_info;
 
 	DBG("ctx=%p, deleting %u entries",
-		ctx, eina_list_count(ctx->calls->list));
+		ctx, eina_list_count(history_store_calls_get(ctx->store)));
 
 	evas_object_del(ctx->clear_popup);
 	ctx->clear_popup = NULL;
@@ -602,11 +495,8 @@ static void _history_clear_do(void *data, Evas_Object *obj __UNUSED__,
 	elm_genlist_clear(ctx->genlist_all);
 	elm_genlist_clear(ctx->genlist_missed);
 
-	EINA_LIST_FREE(ctx->calls->list, call_info)
-		_call_info_free(call_info);
-
-	ctx->calls->dirty = EINA_TRUE;
-	_history_call_log_save(ctx);
+	history_store_clear(ctx->store);
+	history_store_save(ctx->store);
 
 	if (ctx->updater) {
 		ecore_poller_del(ctx->updater);
@@ -661,7 +551,7 @@ static char *_item_label_get(void *data, Evas_Object *obj __UNUSED__,
 		double diff = now - call_info->contact_last;
 		if (diff > CONTACT_LAST_THRESHOLD) {
 			Contact_Info *contact = gui_contact_search(
-				call_info->line_id, &(call_info->contact_type));
+				call_info->base.line_id, &(call_info->contact_type));
 
 			call_info->contact_last = now;
 			call_info->contact = contact;
@@ -677,14 +567,14 @@ static char *_item_label_get(void *data, Evas_Object *obj __UNUSED__,
 
 	if (!strcmp(part, "name")) {
 		if (!call_info->contact)
-			return strdup(call_info->line_id);
+			return strdup(call_info->base.line_id);
 		return strdup(contact_info_full_name_get(call_info->contact));
 	}
 
 	if (!strcmp(part, "time")) {
-		if ((call_info->completed) && (call_info->end_time))
-			return date_format(call_info->end_time);
-		return date_format(call_info->start_time);
+		if ((call_info->base.completed) && (call_info->base.end_time))
+			return date_format(call_info->base.end_time);
+		return date_format(call_info->base.start_time);
 	}
 
 	if (!strcmp(part, "type")) {
@@ -704,13 +594,13 @@ static Eina_Bool _item_state_get(void *data, Evas_Object *obj __UNUSED__,
 	Call_Info *call_info = data;
 
 	if (!strcmp(part, "missed"))
-		return !call_info->completed;
+		return !call_info->base.completed;
 	else if (!strcmp(part, "completed"))
-		return call_info->completed;
+		return call_info->base.completed;
 	else if (!strcmp(part, "outgoing"))
-		return !call_info->incoming;
+		return !call_info->base.incoming;
 	else if (!strcmp(part, "incoming"))
-		return call_info->incoming;
+		return call_info->base.incoming;
 
 	ERR("Unexpected state part: %s", part);
 	return EINA_FALSE;
@@ -819,8 +709,6 @@ Evas_Object *history_add(Evas_Object *parent)
 	Elm_Genlist_Item_Class *itc;
 	Evas_Object *obj, *genlist_all, *genlist_missed;
 
-	eet_init();
-	ecore_file_init();
 	history = calloc(1, sizeof(History));
 	EINA_SAFETY_ON_NULL_RETURN_VAL(history, NULL);
 
@@ -883,18 +771,14 @@ Evas_Object *history_add(Evas_Object *parent)
 	if (r < 0)
 		goto err_item_class;
 
-	history->path = path;
-	r = asprintf(&path,  "%s/%s/history.eet.bkp", config_path,
-			PACKAGE_NAME);
-
-	if (r < 0)
-		goto err_path;
-
-	history->bkp = path;
-
-	_history_call_info_descriptor_init(&history->edd, &history->edd_list);
-	_history_call_log_read(history);
-	EINA_SAFETY_ON_NULL_GOTO(history->calls, err_log_read);
+	/* the backup is history.eet.bkp */
+	history->store = history_store_new(path, sizeof(Call_Info),
+						EINA_FREE_CB(_call_info_free));
+	free(path);
+	EINA_SAFETY_ON_NULL_GOTO(history->store, err_item_class);
+	_history_items_add(history);
+	scroll_bench_genlist_add(genlist_all, "history-all");
+	scroll_bench_genlist_add(genlist_missed, "history-missed");
 	evas_object_event_callback_add(obj, EVAS_CALLBACK_DEL, _on_del,
 					history);
 	evas_object_event_callback_add(obj, EVAS_CALLBACK_HIDE, _on_hide,
@@ -908,26 +792,19 @@ Evas_Object *history_add(Evas_Object *parent)
 	evas_event_callback_add(e, EVAS_CALLBACK_CANVAS_FOCUS_IN,
 				_on_win_focus_in, history);
 
-	callback_node_call_changed =
-		ofono_call_changed_cb_add(_history_call_changed, history);
-	callback_node_call_removed =
-		ofono_call_removed_cb_add(_history_call_removed, history);
+	/* not deferred, it needs every state the call goes through */
+	callback_node_call_changed = ofono_call_changed_cb_add(
+		_history_call_changed, history);
+	callback_node_call_removed = ofono_call_removed_cb_add(
+		_history_call_removed, history);
 
 	return obj;
 
-err_log_read:
-	free(history->bkp);
-	eet_data_descriptor_free(history->edd);
-	eet_data_descriptor_free(history->edd_list);
-err_path:
-	free(history->path);
 err_item_class:
 	elm_genlist_item_class_free(itc);
 err_object_new:
 	free(obj);
 err_layout:
 	free(history);
-	ecore_file_shutdown();
-	eet_shutdown();
 	return NULL;
 }
@@ -2,10 +2,12 @@
 #include "config.h"
 #endif
 #include <Elementary.h>
+#include <limits.h>
 
 #include "log.h"
 #include "gui.h"
 #include "ofono.h"
+#include "trace.h"
 
 static E_DBus_Connection *bus_conn = NULL;
 static E_DBus_Object *bus_obj = NULL;
@@ -129,6 +131,66 @@ static DBusMessage *_rc_answer_call(E_DBus_Object *obj __UNUSED__,
 	return dbus_message_new_method_return(msg);
 }
 
+/* slowest first, see OFONO_CB_PROFILE_ENV, empty if profiling is off */
+static DBusMessage *_rc_callback_stats_get(E_DBus_Object *obj __UNUSED__,
+						DBusMessage *msg)
+{
+	DBusMessage *ret;
+	DBusMessageIter iter, array, st;
+	OFono_Callback_Stat *stat;
+	Eina_List *stats;
+	dbus_uint32_t max;
+	double total_ms, max_ms;
+
+	if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_UINT32, &max,
+					DBUS_TYPE_INVALID)) {
+		return dbus_message_new_error(msg,
+					"org.tizen.dialer.error.InvalidArgs",
+					"Expected the number of stats");
+	}
+
+	ret = dbus_message_new_method_return(msg);
+	EINA_SAFETY_ON_NULL_GOTO(ret, err_ret);
+
+	dbus_message_iter_init_append(ret, &iter);
+	if (!dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY,
+						"(ssudd)", &array))
+		goto err_args;
+
+	/* 0 is all of them */
+	stats = ofono_callback_stats_get(max ? max : UINT_MAX);
+	EINA_LIST_FREE(stats, stat) {
+		total_ms = stat->total * 1000.0;
+		max_ms = stat->max * 1000.0;
+		dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT,
+							NULL, &st);
+		dbus_message_iter_append_basic(&st, DBUS_TYPE_STRING,
+						&stat->list);
+		dbus_message_iter_append_basic(&st, DBUS_TYPE_STRING,
+						&stat->owner);
+		dbus_message_iter_append_basic(&st, DBUS_TYPE_UINT32,
+						&stat->calls);
+		dbus_message_iter_append_basic(&st, DBUS_TYPE_DOUBLE,
+						&total_ms);
+		dbus_message_iter_append_basic(&st, DBUS_TYPE_DOUBLE,
+						&max_ms);
+		dbus_message_iter_close_container(&array, &st);
+	}
+
+	if (!dbus_message_iter_close_container(&iter, &array))
+		goto err_args;
+
+	return ret;
+
+err_args:
+	dbus_message_unref(ret);
+
+err_ret:
+	return dbus_message_new_error(msg,
+					"org.tizen.dialer.error.Error",
+					"Could not create a reply");
+}
+
 static void _rc_signal_reply(void *data __UNUSED__,
 					DBusMessage *msg __UNUSED__,
 					DBusError *err)
@@ -145,11 +207,13 @@ static void _rc_signal_reply(void *data __UNUSED__,
 static void _new_call_sig_emit(OFono_Call *call)
 {
 	DBusMessage *msg;
-	const char *line_id, *name = "", *type = "", *img = "";
+	const char *line_id, *name = "", *type = "", *img = "", *path;
 	Contact_Info *c_info;
 
+	path = ofono_call_path_get(call);
 	line_id = ofono_call_line_id_get(call);
 	c_info = gui_contact_search(line_id, &type);
+	trace_mark(path, "dialer-contact");
 
 	if (c_info) {
 		name = contact_info_full_name_get(c_info);
@@ -161,16 +225,19 @@ static void _new_call_sig_emit(OFono_Call *call)
 	msg = dbus_message_new_signal(RC_PATH, RC_IFACE, RC_SIG_CALL_ADDED);
 	EINA_SAFETY_ON_NULL_RETURN(msg);
 
+	/* path is last so older listeners still get what they expect */
 	if (!dbus_message_append_args(msg, DBUS_TYPE_STRING, &img,
 					DBUS_TYPE_STRING, &line_id,
 					DBUS_TYPE_STRING, &name,
 					DBUS_TYPE_STRING, &type,
+					DBUS_TYPE_STRING, &path,
 					DBUS_TYPE_INVALID)) {
 		ERR("Could not append msg args.");
 		goto err_args;
 	}
 
 	e_dbus_message_send(bus_conn, msg, _rc_signal_reply, -1, NULL);
+	trace_mark(path, "dialer-signal");
 err_args:
 	dbus_message_unref(msg);
 }
@@ -179,7 +246,7 @@ static DBusMessage *_rc_waiting_call_get(E_DBus_Object *obj __UNUSED__,
 						DBusMessage *msg)
 {
 	DBusMessage *ret;
-	const char *line_id, *name = "", *type = "", *img = "";
+	const char *line_id, *name = "", *type = "", *img = "", *path;
 	Contact_Info *c_info;
 
 
@@ -189,6 +256,7 @@ static DBusMessage *_rc_waiting_call_get(E_DBus_Object *obj __UNUSED__,
 					"No calls available");
 	}
 
+	path = ofono_call_path_get(waiting);
 	line_id = ofono_call_line_id_get(waiting);
 	c_info = gui_contact_search(line_id, &type);
 
@@ -206,6 +274,7 @@ static DBusMessage *_rc_waiting_call_get(E_DBus_Object *obj __UNUSED__,
 					DBUS_TYPE_STRING, &line_id,
 					DBUS_TYPE_STRING, &name,
 					DBUS_TYPE_STRING, &type,
+					DBUS_TYPE_STRING, &path,
 					DBUS_TYPE_INVALID)) {
 		ERR("Could not append msg args.");
 		goto err_args;
@@ -239,11 +308,12 @@ static void _rc_object_register(void)
 	IF_ADD("Dial", "sb", "", _rc_dial);
 	IF_ADD("HangupCall", "", "", _rc_hangup_call);
 	IF_ADD("AnswerCall", "", "", _rc_answer_call);
-	IF_ADD("GetAvailableCall", "", "ssss", _rc_waiting_call_get);
+	IF_ADD("GetAvailableCall", "", "sssss", _rc_waiting_call_get);
+	IF_ADD("GetCallbackStats", "u", "a(ssudd)", _rc_callback_stats_get);
 #undef IF_ADD
 
 	e_dbus_interface_signal_add(bus_iface, RC_SIG_CALL_ADDED,
-					"ssss");
+					"sssss");
 	e_dbus_interface_signal_add(bus_iface, RC_SIG_CALL_REMOVED,
 					"");
 }
@@ -382,9 +452,13 @@ Eina_Bool rc_init(const char *service)
 	modem_changed_node = ofono_modem_changed_cb_add(_modem_changed_cb,
 							NULL);
 
-	call_added = ofono_call_added_cb_add(_rc_call_added_cb, NULL);
-	call_removed = ofono_call_removed_cb_add(_rc_call_removed_cb, NULL);
-	call_changed = ofono_call_changed_cb_add(_rc_call_changed_cb, NULL);
+	/* the answer daemon shows its screen on these signals */
+	call_added = ofono_call_added_cb_priority_add(_rc_call_added_cb, NULL,
+					OFONO_CALLBACK_PRIORITY_REALTIME);
+	call_removed = ofono_call_removed_cb_priority_add(_rc_call_removed_cb,
+					NULL, OFONO_CALLBACK_PRIORITY_REALTIME);
+	call_changed = ofono_call_changed_cb_priority_add(_rc_call_changed_cb,
+					NULL, OFONO_CALLBACK_PRIORITY_REALTIME);
 
 	return EINA_TRUE;
 }
@@ -10,6 +10,12 @@
 #include "gui.h"
 #include "overview.h"
 #include "ofono.h"
+#include "segment.h"
+
+/* older messages fetched when scrolled to the top */
+#define COMPOSE_PAGE 30
+/* messages handed to oFono at once when sending to many */
+#define COMPOSE_SEND_WINDOW 4
 
 typedef struct _Compose
 {
@@ -23,10 +29,16 @@ typedef struct _Compose
 	Elm_Genlist_Item_Class *itc_c_name;
 	Eina_Bool composing;
 	Eina_List *current_thread;
+	Eina_Bool older; /* current_thread may not start at the first message */
 	const char *number;
 	Eina_List *composing_numbers;
 	Ecore_Poller *updater;
 	double last_update;
+	Eina_List *incoming; /* not in the genlist yet */
+	Ecore_Idler *incoming_idler;
+	SMS_Segments segments;
+	Eina_Strbuf *counted; /* markup already in segments */
+	OFono_SMS_Queue *send_queue;
 } Compose;
 
 typedef struct _Contact_Genlist {
@@ -74,6 +86,22 @@ static void _message_from_file_delete(Compose *compose, Message *msg,
 	message_del(msg);
 }
 
+/* queued messages belong to the thread being left, or were saved before
+ * the one opened was read, see compose_messages_set()
+ */
+static void _compose_incoming_drop(Compose *compose)
+{
+	Message *msg;
+
+	if (compose->incoming_idler) {
+		ecore_idler_del(compose->incoming_idler);
+		compose->incoming_idler = NULL;
+	}
+
+	EINA_LIST_FREE(compose->incoming, msg)
+		message_del(msg);
+}
+
 static void _on_del(void *data, Evas *e __UNUSED__,
 			Evas_Object *obj __UNUSED__, void *event __UNUSED__)
 {
@@ -83,6 +111,7 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 
 	ofono_incoming_sms_cb_del(incoming_sms);
 	ofono_sent_sms_changed_cb_del(sent_sms);
+	_compose_incoming_drop(compose);
 	elm_genlist_item_class_free(compose->itc_inc);
 	elm_genlist_item_class_free(compose->itc_out);
 	elm_genlist_item_class_free(compose->itc_c_name);
@@ -92,6 +121,9 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 	EINA_LIST_FREE(compose->composing_numbers, number)
 		eina_stringshare_del(number);
 
+	ofono_sms_queue_free(compose->send_queue);
+	if (compose->counted)
+		eina_strbuf_free(compose->counted);
 	eina_stringshare_del(compose->number);
 	free(compose);
 }
@@ -110,6 +142,7 @@ static void _compose_exit(Compose *compose)
 	elm_genlist_clear(compose->genlist);
 	elm_genlist_clear(compose->genlist_contacts);
 
+	_compose_incoming_drop(compose);
 	EINA_LIST_FREE(compose->current_thread, msg)
 		message_del(msg);
 
@@ -156,16 +189,35 @@ static void _on_layout_clicked(void *data, Evas_Object *o,
 		ERR("Unkown emission: %s", emission);
 }
 
-static void _send_sms_reply(void *data __UNUSED__, OFono_Error error,
+static void _send_queue_cb(void *data, void *item_data __UNUSED__,
+				const char *number,
+				OFono_SMS_Queue_State state, OFono_Error error,
 				OFono_Sent_SMS *sms)
 {
-	if (error != OFONO_ERROR_NONE) {
-		ERR("Error when trying to send a new message");
+	Compose *compose = data;
+	OFono_SMS_Queue_Stats stats;
+
+	switch (state) {
+	case OFONO_SMS_QUEUE_STATE_SENT:
+		DBG("SMS Sent to: %s, message: %s", number,
+			ofono_sent_sms_message_get(sms));
+		break;
+	case OFONO_SMS_QUEUE_STATE_FAILED:
+		ERR("Error when trying to send a new message to %s: %s",
+			number, ofono_error_message_get(error));
+		break;
+	default:
 		return;
 	}
 
-	DBG("SMS Sent to: %s, message: %s", ofono_sent_sms_destination_get(sms),
-		ofono_sent_sms_message_get(sms));
+	ofono_sms_queue_stats_get(compose->send_queue, &stats);
+	if ((stats.waiting) || (stats.sending))
+		return;
+
+	INF("SMS queue done: %u sent, %u failed, %u retries, %0.1f SMS/s, "
+		"latency avg %0.2fs max %0.2fs", stats.sent, stats.failed,
+		stats.retries, stats.rate, stats.latency_avg,
+		stats.latency_max);
 }
 
 static void _send_sms(Compose *compose)
@@ -192,7 +244,7 @@ static void _send_sms(Compose *compose)
 
 	msg_utf = elm_entry_markup_to_utf8(msg_content);
 
-	msg = message_new(time(NULL), msg_utf,
+	msg = message_new(0, time(NULL), msg_utf,
 				EINA_FALSE, OFONO_SENT_SMS_STATE_PENDING);
 	EINA_SAFETY_ON_NULL_RETURN(msg);
 	message_data_set(msg, compose);
@@ -210,7 +262,8 @@ static void _send_sms(Compose *compose)
 	_compose_timer_updater_start(compose);
 
 	if (!compose->composing) {
-		ofono_sms_send(compose->number, msg_utf, _send_sms_reply, NULL);
+		ofono_sms_queue_push(compose->send_queue, compose->number,
+					msg_utf, NULL);
 		DBG("New Message to: %s content: %s", compose->number, msg_utf);
 		c_info = gui_contact_search(compose->number, NULL);
 
@@ -233,7 +286,8 @@ static void _send_sms(Compose *compose)
 		EINA_SAFETY_ON_NULL_GOTO(items, exit);
 
 		EINA_LIST_FOREACH(compose->composing_numbers, l, to) {
-			ofono_sms_send(to, msg_utf, _send_sms_reply, NULL);
+			ofono_sms_queue_push(compose->send_queue, to, msg_utf,
+						NULL);
 			DBG("New Message to: %s content: %s", to, msg_utf);
 			it = eina_list_nth(items, i);
 			name = elm_object_item_part_text_get(it, NULL);
@@ -346,31 +400,27 @@ static Eina_Bool _item_state_get(void *data, Evas_Object *obj __UNUSED__,
 	return EINA_FALSE;
 }
 
-static void _sms_size_calc(const char *str, int *size, int *max)
+/* typing only appends to the markup, count just what was added then */
+static void _sms_segments_update(Compose *compose, const char *msg)
 {
-	Eina_Bool all_isprint = EINA_TRUE;
-	const char *s;
-
-        for (s = str; *s != '\0'; s++) {
-                if (!isprint(*s)) {
-                        all_isprint = EINA_FALSE;
-                        break;
-                }
-        }
+	const char *counted = eina_strbuf_string_get(compose->counted);
+	size_t len = strlen(msg), n;
+	size_t done = eina_strbuf_length_get(compose->counted);
+	Eina_Bool ucs2 = sms_segments_ucs2_get(&compose->segments);
+
+	if ((done > len) || (memcmp(counted, msg, done) != 0)) {
+		sms_segments_reset(&compose->segments);
+		eina_strbuf_reset(compose->counted);
+		done = 0;
+	}
 
-	*size = strlen(str);
+	n = sms_segments_markup_append(&compose->segments, msg + done,
+					len - done);
+	eina_strbuf_append_length(compose->counted, msg + done, n);
 
-        if (all_isprint) {
-                if (*size <= 160)
-                        *max = 160;
-		else
-			*max = ((*size / 153) + 1) * 153;
-        } else {
-                if (*size <= 70)
-                        *max = 70;
-		else
-			*max = ((*size / 67) + 1) * 67;
-        }
+	if ((!ucs2) && sms_segments_ucs2_get(&compose->segments))
+		DBG("U+%04X at %u needs UCS-2", compose->segments.ucs2_first,
+			compose->segments.ucs2_first_pos);
 }
 
 static void _on_text_changed(void *data, Evas_Object *obj,
@@ -379,7 +429,6 @@ static void _on_text_changed(void *data, Evas_Object *obj,
 	Compose *compose = data;
 	const char *msg = elm_object_part_text_get(obj, NULL);
 	Evas_Object *ed;
-	char *msg_utf8;
 	int size, max;
 	char buf[PATH_MAX];
 	Edje_Message_Int_Set *ed_msg;
@@ -387,13 +436,18 @@ static void _on_text_changed(void *data, Evas_Object *obj,
 	if (!msg)
 		return;
 
-	msg_utf8 = elm_entry_markup_to_utf8(msg);
-	_sms_size_calc(msg_utf8, &size, &max);
+	if (!compose->counted) {
+		compose->counted = eina_strbuf_new();
+		EINA_SAFETY_ON_NULL_RETURN(compose->counted);
+	}
+
+	_sms_segments_update(compose, msg);
+	size = sms_segments_size_get(&compose->segments);
+	max = sms_segments_max_get(&compose->segments);
 	snprintf(buf,sizeof(buf), "%d", size);
 	elm_object_part_text_set(compose->layout, "elm.text.size", buf);
 	snprintf(buf,sizeof(buf), "%d", max);
 	elm_object_part_text_set(compose->layout, "elm.text.max_size", buf);
-	free(msg_utf8);
 
 	ed_msg = alloca(sizeof(Edje_Message_Float_Set) + sizeof(int));
 	ed_msg->count = 2;
@@ -403,13 +457,36 @@ static void _on_text_changed(void *data, Evas_Object *obj,
 	edje_object_message_send(ed, EDJE_MESSAGE_INT_SET, 1, ed_msg);
 }
 
+static Eina_Bool _incoming_sms_flush(void *data)
+{
+	Compose *compose = data;
+	Elm_Object_Item *it = NULL;
+	Message *msg;
+
+	compose->incoming_idler = NULL;
+
+	EINA_LIST_FREE(compose->incoming, msg) {
+		it = elm_genlist_item_append(compose->genlist,
+						compose->itc_inc, msg, NULL,
+						ELM_GENLIST_ITEM_NONE, NULL,
+						NULL);
+		message_object_item_set(msg, it);
+		compose->current_thread =
+			eina_list_append(compose->current_thread, msg);
+	}
+
+	if (it)
+		elm_genlist_item_show(it, ELM_GENLIST_ITEM_SCROLLTO_TOP);
+	_compose_timer_updater_start(compose);
+	return ECORE_CALLBACK_CANCEL;
+}
+
 static void _incoming_sms_cb(void *data, unsigned int sms_class,
 				time_t timestamp, const char *sender,
 				const char *message)
 {
 	Compose *compose = data;
 	Message *msg;
-	Elm_Object_Item *it;
 
 	/* Users can only send class 1. This is OFono/GSM detail */
 	if (sms_class != 1)
@@ -418,20 +495,16 @@ static void _incoming_sms_cb(void *data, unsigned int sms_class,
 	if (compose->number && strcmp(compose->number, sender) != 0)
 		return;
 
-	msg = message_new(timestamp, message, EINA_FALSE,
+	msg = message_new(0, timestamp, message, EINA_FALSE,
 				OFONO_SENT_SMS_STATE_SENT);
 
 	EINA_SAFETY_ON_NULL_RETURN(msg);
 	message_data_set(msg, compose);
-	it = elm_genlist_item_append(compose->genlist, compose->itc_inc, msg,
-					NULL, ELM_GENLIST_ITEM_NONE, NULL,
-					NULL);
-	elm_genlist_item_show(it, ELM_GENLIST_ITEM_SCROLLTO_TOP);
-	message_object_item_set(msg, it);
-	compose->current_thread =
-		eina_list_append(compose->current_thread, msg);
 
-	_compose_timer_updater_start(compose);
+	compose->incoming = eina_list_append(compose->incoming, msg);
+	if (!compose->incoming_idler)
+		compose->incoming_idler = ecore_idler_add(_incoming_sms_flush,
+								compose);
 }
 
 static Eina_Bool _compose_time_updater(void *data)
@@ -507,6 +580,64 @@ static void _compose_time_updater_stop(Compose *compose)
 	compose->updater = NULL;
 }
 
+static Elm_Object_Item *_compose_message_item_add(Compose *compose,
+							Message *msg,
+							Eina_Bool prepend)
+{
+	Elm_Genlist_Item_Class *itc;
+	Elm_Object_Item *it;
+
+	if (message_outgoing_get(msg))
+		itc = compose->itc_out;
+	else
+		itc = compose->itc_inc;
+
+	message_data_set(msg, compose);
+	if (prepend)
+		it = elm_genlist_item_prepend(compose->genlist, itc, msg, NULL,
+						ELM_GENLIST_ITEM_NONE, NULL,
+						NULL);
+	else
+		it = elm_genlist_item_append(compose->genlist, itc, msg, NULL,
+						ELM_GENLIST_ITEM_NONE, NULL,
+						NULL);
+	message_object_item_set(msg, it);
+	message_ref(msg);
+	return it;
+}
+
+static void _on_genlist_edge_top(void *data, Evas_Object *obj __UNUSED__,
+					void *event_info __UNUSED__)
+{
+	Compose *compose = data;
+	Elm_Object_Item *first;
+	Eina_List *list, *l;
+	Message *msg;
+
+	if ((compose->composing) || (!compose->older))
+		return;
+
+	msg = eina_list_data_get(compose->current_thread);
+	EINA_SAFETY_ON_NULL_RETURN(msg);
+
+	list = gui_messages_older_get(compose->number, msg, COMPOSE_PAGE);
+	if (!list) {
+		compose->older = EINA_FALSE;
+		return;
+	}
+
+	first = elm_genlist_first_item_get(compose->genlist);
+	EINA_LIST_REVERSE_FOREACH(list, l, msg)
+		_compose_message_item_add(compose, msg, EINA_TRUE);
+
+	/* keep what was on screen there */
+	if (first)
+		elm_genlist_item_show(first, ELM_GENLIST_ITEM_SCROLLTO_TOP);
+
+	compose->current_thread = eina_list_merge(list,
+						compose->current_thread);
+}
+
 static void _on_show(void *data, Evas *e __UNUSED__,
 			Evas_Object *obj __UNUSED__, void *event __UNUSED__)
 {
@@ -564,7 +695,7 @@ static void _on_resend_clicked(void *data, Evas_Object *obj __UNUSED__,
 	EINA_SAFETY_ON_NULL_RETURN(number);
 
 	INF("%s %s", number, content);
-	ofono_sms_send(number, content, _send_sms_reply, NULL);
+	ofono_sms_queue_push(compose->send_queue, number, content, NULL);
 }
 
 static Evas_Object *_item_content_get(void *data, Evas_Object *obj,
@@ -848,6 +979,8 @@ Evas_Object *compose_add(Evas_Object *parent)
 	elm_genlist_mode_set(genlist, ELM_LIST_COMPRESS);
 	elm_object_style_set(genlist, "compose");
 	elm_object_part_content_set(obj, "elm.swallow.genlist", genlist);
+	evas_object_smart_callback_add(genlist, "edge,top",
+					_on_genlist_edge_top, compose);
 	compose->genlist = genlist;
 
 	genlist = elm_genlist_add(obj);
@@ -902,6 +1035,10 @@ Evas_Object *compose_add(Evas_Object *parent)
 	compose->itc_c_name->func.state_get = NULL;
 	compose->itc_c_name->func.del = _item_c_genlist_del;
 
+	compose->send_queue = ofono_sms_queue_new(COMPOSE_SEND_WINDOW,
+							_send_queue_cb, compose);
+	EINA_SAFETY_ON_NULL_GOTO(compose->send_queue, err_queue);
+
 	elm_object_part_text_set(compose->layout, "elm.text.name",
 					"New Message");
 	elm_object_signal_emit(compose->layout, "hide,genlist", "gui");
@@ -924,6 +1061,8 @@ Evas_Object *compose_add(Evas_Object *parent)
 
 	return obj;
 
+err_queue:
+	elm_genlist_item_class_free(compose->itc_c_name);
 err_names:
 	elm_genlist_item_class_free(compose->itc_out);
 err_itc_out:
@@ -959,7 +1098,6 @@ void compose_messages_set(Evas_Object *obj, Eina_List *list, const char *number)
 	Compose *compose;
 	Message *msg;
 	Eina_List *l;
-	Elm_Genlist_Item_Class *itc;
 	Elm_Object_Item *it = NULL;
 	Contact_Info *c_info;
 
@@ -969,26 +1107,16 @@ void compose_messages_set(Evas_Object *obj, Eina_List *list, const char *number)
 
 	eina_stringshare_replace(&(compose->number), number);
 
+	_compose_incoming_drop(compose);
 	elm_genlist_clear(compose->genlist);
 
-	EINA_LIST_FOREACH(list, l, msg) {
-		Eina_Bool outgoing = message_outgoing_get(msg);
-
-		if (outgoing)
-			itc = compose->itc_out;
-		else
-			itc = compose->itc_inc;
-		message_data_set(msg, compose);
-		it = elm_genlist_item_append(compose->genlist, itc, msg, NULL,
-						ELM_GENLIST_ITEM_NONE, NULL,
-						NULL);
-		message_object_item_set(msg, it);
-		message_ref(msg);
-	}
+	EINA_LIST_FOREACH(list, l, msg)
+		it = _compose_message_item_add(compose, msg, EINA_FALSE);
 	if (it)
 		elm_genlist_item_show(it, ELM_GENLIST_ITEM_SCROLLTO_IN);
 
 	compose->current_thread = list;
+	compose->older = !!list;
 	elm_object_signal_emit(compose->layout, "show,genlist", "gui");
 
 	c_info = gui_contact_search(number, NULL);
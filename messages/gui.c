@@ -52,6 +52,12 @@ void gui_compose_messages_set(Eina_List *list, const char *number)
 	compose_messages_set(cs, list, number);
 }
 
+Eina_List *gui_messages_older_get(const char *number, const Message *msg,
+					unsigned int count)
+{
+	return overview_messages_older_get(ov, number, msg, count);
+}
+
 Contact_Info *gui_contact_search(const char *number, const char **type)
 {
 	return contact_search(contacts, number, type);
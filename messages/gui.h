@@ -21,6 +21,9 @@ Contact_Info *gui_contact_search(const char *number, const char **type);
 
 void gui_compose_messages_set(Eina_List *list, const char *number);
 
+Eina_List *gui_messages_older_get(const char *number, const Message *msg,
+					unsigned int count);
+
 void gui_message_from_file_delete(Message *msg, const char *contact);
 
 void gui_overview_genlist_update(Message *msg, const char *contact);
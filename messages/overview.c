@@ -13,8 +13,14 @@
 #include "util.h"
 #include "gui.h"
 #include "contacts-ofono-efl.h"
+#include "store.h"
+#include "scroll-bench.h"
 
 #define ALL_MESSAGES "all_messages"
+/* messages shown when a conversation is opened */
+#define CONVERSATION_PAGE 30
+/* seconds the outbox waits for oFono to finish sends we do not know */
+#define OUTBOX_WAIT_MAX 60.0
 
 #ifndef EET_COMPRESSION_DEFAULT
 #define EET_COMPRESSION_DEFAULT 1
@@ -37,6 +43,7 @@ struct _Message
 	unsigned char state;
 	long long time;
 	const char *phone; /* phone number -  not in eet */
+	unsigned long long id; /* not in eet, 0 if never saved */
 	int refcount; /* not in eet */
 	void *data; /* not in eet */
 	Elm_Object_Item *it; /* not in eet */
@@ -46,10 +53,10 @@ typedef struct _Overview
 {
 	Eet_Data_Descriptor *edd_msg_info;
 	Eet_Data_Descriptor *edd_msg_list;
-	Eet_Data_Descriptor *edd_msg;
-	Eet_Data_Descriptor *edd_c_msg;
 	Messages_List *messages;
-	/* Pending conversations, not saved in eet yet */
+	Eina_Hash *senders; /* sender -> Message_Info in messages */
+	Message_Store *store;
+	/* Pending conversations, not saved in the store yet */
 	Messages_List *p_conversations;
 	Evas_Object *layout, *genlist;
 	char *msg_path, *base_dir, *msg_bkp;
@@ -57,6 +64,13 @@ typedef struct _Overview
 	double last_update;
 	Elm_Genlist_Item_Class *itc;
 	Eina_Hash *pending_sms;
+	/* Incoming SMS not shown yet, handled together when idle */
+	Eina_List *incoming;
+	Ecore_Idler *incoming_idler;
+	/* Outbox, sends left pending in the store by a previous run */
+	Eina_Bool outbox_online; /* modem can send messages */
+	Eina_Bool outbox_check; /* not reconciled with oFono yet */
+	Ecore_Timer *outbox_timer; /* stops waiting for oFono */
 } Overview;
 
 /* Messages showed in the main screen */
@@ -67,17 +81,21 @@ typedef struct _Message_Info
 	int count;
 	Overview *ov; /*not in eet */
 	Elm_Object_Item *it; /* not in eet */
+	Eina_List *node; /* not in eet, in ov->messages->list */
+	Eina_Bool batched; /* not in eet */
 } Message_Info;
 
 static OFono_Callback_List_Incoming_SMS_Node *incoming_sms = NULL;
 static OFono_Callback_List_Sent_SMS_Node *sent_sms = NULL;
+static OFono_Callback_List_Modem_Node *modem_changed = NULL;
 
 static void _overview_messages_save(Overview *ov);
 static Message_Info *_message_info_search(Overview *ov, const char *sender);
 static void _message_info_del(Message_Info *m_info);
 static void _overview_messages_save(Overview *ov);
-static void _conversation_eet_update_save(Overview *ov, Message *msg);
+static void _conversation_save(Overview *ov, Message *msg);
 static void _message_free(Message *msg);
+static void _incoming_sms_queue_drain(Overview *ov);
 
 void message_ref(Message *msg)
 {
@@ -162,81 +180,34 @@ void message_data_set(Message *msg, void *data)
 	msg->data = data;
 }
 
-static Eina_Bool _message_is_equal(Message *m1, Message *m2)
-{
-	if (strcmp(m1->content, m2->content) != 0)
-		return EINA_FALSE;
-
-	if (m1->outgoing != m2->outgoing)
-		return EINA_FALSE;
-
-	if (m1->state != m2->state)
-		return EINA_FALSE;
-
-	if (m1->time != m2->time)
-		return EINA_FALSE;
-
-	return EINA_TRUE;
-}
-
 void overview_message_from_file_delete(Evas_Object *obj, Message *msg,
 					const char *contact)
 {
-	Eet_File *efile;
 	Overview *ov;
-	char buf[PATH_MAX], bkp[PATH_MAX];
-	Messages_List *messages = NULL;
-	Eina_List *l;
-	Message *msg_aux;
+	Message_Info *m_info;
+	int left;
 
 	EINA_SAFETY_ON_NULL_RETURN(obj);
 	ov = evas_object_data_get(obj, "overview.ctx");
 	EINA_SAFETY_ON_NULL_RETURN(ov);
 	EINA_SAFETY_ON_NULL_RETURN(msg);
 
-	snprintf(buf, sizeof(buf), "%s/%s.eet", ov->base_dir, contact);
-	snprintf(bkp, sizeof(bkp), "%s/%s.eet.bkp", ov->base_dir, contact);
-
-	efile = eet_open(buf, EET_FILE_MODE_READ_WRITE);
-
-	if (efile) {
-		messages = eet_data_read(efile, ov->edd_c_msg, ALL_MESSAGES);
-	}
-
-	if (!messages) {
-		efile = eet_open(bkp, EET_FILE_MODE_READ_WRITE);
-		if (efile) {
-			messages = eet_data_read(efile, ov->edd_c_msg,
-							ALL_MESSAGES);
-		}
-	}
-
-	if (!messages)
+	if (msg->id)
+		left = message_store_message_id_del(ov->store, contact,
+							msg->time, msg->id);
+	else
+		left = message_store_message_del(ov->store, contact,
+							msg->time, msg->content,
+							msg->outgoing,
+							msg->state);
+	if (left < 0)
 		return;
 
-	EINA_LIST_FOREACH(messages->list, l, msg_aux) {
-		if (_message_is_equal(msg, msg_aux)) {
-			_message_free(msg_aux);
-			messages->list = eina_list_remove_list(messages->list,
-								l);
-			break;
-		}
-	}
-	Message_Info *m_info = _message_info_search(ov, contact);
+	m_info = _message_info_search(ov, contact);
 	EINA_SAFETY_ON_NULL_RETURN(m_info);
 	m_info->count--;
-	if (messages->list && eina_list_count(messages->list) != 0) {
-		eet_data_write(efile, ov->edd_c_msg, ALL_MESSAGES, messages,
-				EET_COMPRESSION_DEFAULT);
-		eet_close(efile);
-	} else {
-		eet_close(efile);
+	if (left == 0)
 		_message_info_del(m_info);
-	}
-
-	EINA_LIST_FREE(messages->list, msg_aux)
-		_message_free(msg_aux);
-	free(messages);
 }
 
 unsigned char message_state_get(const Message *msg)
@@ -272,17 +243,8 @@ long long message_time_get(const Message *msg)
 
 static Message_Info *_message_info_search(Overview *ov, const char *sender)
 {
-	Eina_List *l;
-	Message_Info *m_info;
-
-	EINA_SAFETY_ON_NULL_RETURN_VAL(ov->messages, NULL);
-
-	EINA_LIST_FOREACH(ov->messages->list, l, m_info) {
-		if (strcmp(sender, m_info->sender) == 0)
-			return m_info;
-	}
-
-	return NULL;
+	EINA_SAFETY_ON_NULL_RETURN_VAL(sender, NULL);
+	return eina_hash_find(ov->senders, sender);
 }
 
 static void _message_free(Message *msg)
@@ -312,15 +274,6 @@ static void _message_info_free(Message_Info *m_info)
 	free(m_info);
 }
 
-static void _messages_file_delete(char *dir, const char *sender)
-{
-	char path[PATH_MAX];
-	snprintf(path, sizeof(path), "%s/%s.eet", dir, sender);
-	ecore_file_unlink(path);
-	snprintf(path, sizeof(path), "%s/%s.eet.bkp", dir, sender);
-	ecore_file_unlink(path);
-}
-
 static void _message_info_del(Message_Info *m_info)
 {
 	Overview *ctx = m_info->ov;
@@ -331,7 +284,9 @@ static void _message_info_del(Message_Info *m_info)
 
 	elm_object_item_del(m_info->it);
 
-	ctx->messages->list = eina_list_remove(ctx->messages->list, m_info);
+	eina_hash_del(ctx->senders, m_info->sender, m_info);
+	ctx->messages->list = eina_list_remove_list(ctx->messages->list,
+							m_info->node);
 	ctx->messages->dirty = EINA_TRUE;
 
 	/* Remove unsaved SMSs */
@@ -344,7 +299,7 @@ static void _message_info_del(Message_Info *m_info)
 		}
 	}
 
-	_messages_file_delete(ctx->base_dir, m_info->sender);
+	message_store_thread_del(ctx->store, m_info->sender);
 	_overview_messages_save(ctx);
 
 	if ((!ctx->messages->list) && (ctx->updater)) {
@@ -364,6 +319,10 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 
 	ofono_incoming_sms_cb_del(incoming_sms);
 	ofono_sent_sms_changed_cb_del(sent_sms);
+	ofono_modem_changed_cb_del(modem_changed);
+
+	if (ov->outbox_timer)
+		ecore_timer_del(ov->outbox_timer);
 
 	if (ov->messages->save_poller)
 		ecore_poller_del(ov->messages->save_poller);
@@ -371,6 +330,10 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 	if (ov->p_conversations->save_poller)
 		ecore_poller_del(ov->p_conversations->save_poller);
 
+	if (ov->incoming_idler)
+		ecore_idler_del(ov->incoming_idler);
+	_incoming_sms_queue_drain(ov);
+
 	if (ov->messages->dirty)
 		_overview_messages_save_do(ov);
 
@@ -380,19 +343,21 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 		EINA_LIST_FREE(ov->p_conversations->list, msg)
 			message_del(msg);
 	} else {
+		message_store_begin(ov->store);
 		EINA_LIST_FREE(ov->p_conversations->list, msg) {
-			_conversation_eet_update_save(ov, msg);
+			_conversation_save(ov, msg);
 			message_del(msg);
 		}
+		message_store_commit(ov->store);
 	}
+	message_store_free(ov->store);
 
+	eina_hash_free(ov->senders);
 	EINA_LIST_FREE(ov->messages->list, m_info)
 		_message_info_free(m_info);
 
 	eet_data_descriptor_free(ov->edd_msg_info);
 	eet_data_descriptor_free(ov->edd_msg_list);
-	eet_data_descriptor_free(ov->edd_msg);
-	eet_data_descriptor_free(ov->edd_c_msg);
 
 	elm_genlist_item_class_free(ov->itc);
 	free(ov->messages);
@@ -407,12 +372,9 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 }
 
 static void _eet_descriptors_init(Eet_Data_Descriptor **messages,
-					Eet_Data_Descriptor **msg_info,
-					Eet_Data_Descriptor **edd_msg,
-					Eet_Data_Descriptor **edd_c_msg)
+					Eet_Data_Descriptor **msg_info)
 {
 	Eet_Data_Descriptor_Class eddc;
-	Eet_Data_Descriptor_Class eddcM;
 
 	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Message_Info);
 	*msg_info = eet_data_descriptor_stream_new(&eddc);
@@ -420,21 +382,6 @@ static void _eet_descriptors_init(Eet_Data_Descriptor **messages,
 	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Messages_List);
 	*messages = eet_data_descriptor_stream_new(&eddc);
 
-	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddcM, Message);
-	*edd_msg = eet_data_descriptor_stream_new(&eddcM);
-
-	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddcM, Messages_List);
-	*edd_c_msg = eet_data_descriptor_stream_new(&eddcM);
-
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd_msg, Message,
-					"content", content, EET_T_STRING);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd_msg, Message,
-					"time", time, EET_T_LONG_LONG);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd_msg, Message,
-					"outgoing", outgoing, EET_T_UCHAR);
-	EET_DATA_DESCRIPTOR_ADD_BASIC(*edd_msg, Message,
-					"state", state, EET_T_UCHAR);
-
 	EET_DATA_DESCRIPTOR_ADD_BASIC(*msg_info, Message_Info,
 					"sender", sender, EET_T_STRING);
 	EET_DATA_DESCRIPTOR_ADD_BASIC(*msg_info, Message_Info,
@@ -446,10 +393,6 @@ static void _eet_descriptors_init(Eet_Data_Descriptor **messages,
 
 	EET_DATA_DESCRIPTOR_ADD_LIST(*messages, Messages_List, "list", list,
 					*msg_info);
-
-	EET_DATA_DESCRIPTOR_ADD_LIST(*edd_c_msg, Messages_List, "list", list,
-					*edd_msg);
-
 }
 
 static void _overview_messages_save(Overview *ov)
@@ -461,44 +404,99 @@ static void _overview_messages_save(Overview *ov)
 							ov);
 }
 
+/* messages read from the store have no refcount, compose takes it */
+static Eina_Bool _conversation_message_add(void *data,
+						unsigned long long id,
+						long long time,
+						const char *content,
+						Eina_Bool outgoing,
+						unsigned char state)
+{
+	Eina_List **list = data;
+	Message *msg;
+
+	msg = calloc(1, sizeof(Message));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(msg, EINA_FALSE);
+	msg->content = eina_stringshare_add(content);
+	msg->id = id;
+	msg->time = time;
+	msg->outgoing = outgoing;
+	msg->state = state;
+
+	*list = eina_list_append(*list, msg);
+	return EINA_TRUE;
+}
+
+/* Messages still queued, for the overview or the store, are saved now
+ * so the conversation read back has them. Saving is by id, so the
+ * pollers saving them again later changes nothing.
+ */
+static void _conversations_flush(Overview *ov)
+{
+	Eina_List *l;
+	Message *msg;
+
+	message_store_begin(ov->store);
+	EINA_LIST_FOREACH(ov->incoming, l, msg)
+		_conversation_save(ov, msg);
+	EINA_LIST_FOREACH(ov->p_conversations->list, l, msg)
+		_conversation_save(ov, msg);
+	if (!message_store_commit(ov->store))
+		ERR("Could not save the conversations");
+}
+
 static void _on_item_clicked(void *data, Evas_Object *obj __UNUSED__,
 				void *event_info)
 {
 	Message_Info *m_info = data;
 	Elm_Object_Item *it = event_info;
-	char buf[PATH_MAX], bkp[PATH_MAX];
 	Overview *ov = m_info->ov;
-	Eet_File *efile;
-	Messages_List *messages = NULL;
+	Eina_List *list = NULL;
+	unsigned int count, first;
 
 	elm_genlist_item_selected_set(it, EINA_FALSE);
+	_conversations_flush(ov);
+
+	/* only the newest page, compose asks for older ones on scroll */
+	count = message_store_thread_count_get(ov->store, m_info->sender);
+	first = count > CONVERSATION_PAGE ? count - CONVERSATION_PAGE : 0;
+
+	if (message_store_thread_range_foreach(ov->store, m_info->sender,
+						first, count - first,
+						_conversation_message_add,
+						&list)) {
+		/* Compose will free the list for me */
+		gui_compose_messages_set(list, m_info->sender);
+		gui_compose_enter();
+	} else
+		INF("Could not read the messages list!");
+}
 
-	snprintf(buf, sizeof(buf), "%s/%s.eet", ov->base_dir, m_info->sender);
-	snprintf(bkp, sizeof(bkp), "%s/%s.eet.bkp", ov->base_dir,
-			m_info->sender);
+Eina_List *overview_messages_older_get(Evas_Object *obj, const char *contact,
+					const Message *msg, unsigned int count)
+{
+	Overview *ov;
+	Eina_List *list = NULL;
+	unsigned int end, first;
 
-	efile = eet_open(buf, EET_FILE_MODE_READ);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(obj, NULL);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(contact, NULL);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(msg, NULL);
 
-	if (efile) {
-		messages = eet_data_read(efile, ov->edd_c_msg, ALL_MESSAGES);
-		eet_close(efile);
-	}
+	ov = evas_object_data_get(obj, "overview.ctx");
+	EINA_SAFETY_ON_NULL_RETURN_VAL(ov, NULL);
 
-	if (!messages) {
-		efile = eet_open(bkp, EET_FILE_MODE_READ);
-		if (efile) {
-			messages = eet_data_read(efile, ov->edd_c_msg,
-							ALL_MESSAGES);
-			eet_close(efile);
-		}
-	}
-	if (messages) {
-		gui_compose_messages_set(messages->list, m_info->sender);
-		gui_compose_enter();
-		/* Compose will free the messages->list for me */
-		free(messages);
-	} else
+	end = message_store_thread_message_position_get(ov->store, contact,
+							msg->time, msg->id);
+	first = end > count ? end - count : 0;
+
+	if (!message_store_thread_range_foreach(ov->store, contact, first,
+						end - first,
+						_conversation_message_add,
+						&list))
 		INF("Could not read the messages list!");
+
+	return list;
 }
 
 static void _overview_messages_read(Overview *ov)
@@ -538,6 +536,8 @@ static void _overview_messages_read(Overview *ov)
 						_on_item_clicked, m_info);
 		m_info->ov = ov;
 		m_info->it = it;
+		m_info->node = l;
+		eina_hash_direct_add(ov->senders, m_info->sender, m_info);
 	}
 }
 
@@ -614,82 +614,15 @@ static void _overview_time_updater_stop(Overview *ov)
 	ov->updater = NULL;
 }
 
-static Message *_message_list_search(Eina_List *list, Message *msg)
+static void _conversation_save(Overview *ov, Message *msg)
 {
-	Eina_List *l;
-	Message *m;
-
-	EINA_LIST_FOREACH(list, l, m) {
-		if ((m->content == msg->content &&
-			m->time == msg->time) ||
-			(msg->content == m->content && m->state != msg->state))
-			return m;
-	}
-
-	return NULL;
+	if (!message_store_message_save(ov->store, msg->phone, msg->id,
+					msg->time, msg->content,
+					msg->outgoing, msg->state))
+		ERR("Could not save the message to %s", msg->phone);
 }
 
-static void _conversation_eet_update_save(Overview *ov, Message *msg)
-{
-
-	Eet_File *efile;
-	char buf[PATH_MAX], bkp[PATH_MAX];
-	Messages_List *messages = NULL;
-	Message *msg_aux;
-
-	snprintf(buf, sizeof(buf), "%s/%s.eet", ov->base_dir, msg->phone);
-	snprintf(bkp, sizeof(bkp), "%s/%s.eet.bkp", ov->base_dir, msg->phone);
-
-	efile = eet_open(buf, EET_FILE_MODE_READ);
-
-	if (efile) {
-		messages = eet_data_read(efile, ov->edd_c_msg, ALL_MESSAGES);
-		eet_close(efile);
-	}
-
-	if (!messages) {
-		efile = eet_open(bkp, EET_FILE_MODE_READ);
-		if (efile) {
-			messages = eet_data_read(efile, ov->edd_c_msg,
-							ALL_MESSAGES);
-			eet_close(efile);
-		}
-	}
-
-	/* New file */
-	if (!messages) {
-		messages = calloc(1, sizeof(Messages_List));
-		EINA_SAFETY_ON_NULL_RETURN(messages);
-	}
-
-	msg_aux = _message_list_search(messages->list, msg);
-
-	if (!msg_aux) {
-		messages->list = eina_list_append(messages->list, msg);
-		msg->refcount++;
-	} else
-		msg_aux->state = msg->state;
-
-	ecore_file_unlink(bkp);
-	ecore_file_mv(buf, bkp);
-
-	efile = eet_open(buf, EET_FILE_MODE_WRITE);
-	EINA_SAFETY_ON_NULL_RETURN(efile);
-
-	eet_data_write(efile, ov->edd_c_msg, ALL_MESSAGES, messages,
-			EET_COMPRESSION_DEFAULT);
-
-	eet_close(efile);
-	EINA_LIST_FREE(messages->list, msg_aux) {
-		if (msg_aux == msg)
-			message_del(msg);
-		else /* messages read from eet have no refcount */
-			_message_free(msg_aux);
-	}
-	free(messages);
-}
-
-static Eina_Bool _conversation_eet_update_do(void *data)
+static Eina_Bool _conversation_update_do(void *data)
 {
 	Overview *ov = data;
 	Message *msg;
@@ -697,73 +630,93 @@ static Eina_Bool _conversation_eet_update_do(void *data)
 	ov->p_conversations->dirty = EINA_FALSE;
 	ov->p_conversations->save_poller = NULL;
 
+	/* a single write for everything pending */
+	message_store_begin(ov->store);
 	EINA_LIST_FREE(ov->p_conversations->list, msg) {
-		_conversation_eet_update_save(ov, msg);
+		_conversation_save(ov, msg);
 		message_del(msg);
 	}
+	if (!message_store_commit(ov->store))
+		ERR("Could not save the conversations");
 	ov->p_conversations->list = NULL;
 	return ECORE_CALLBACK_DONE;
 }
 
-static void _conversation_eet_update(Overview *ov)
+static void _conversation_update(Overview *ov)
 {
 	if (ov->p_conversations->save_poller)
 		return;
 
 	ov->p_conversations->save_poller = ecore_poller_add(ECORE_POLLER_CORE,
 								32,
-								_conversation_eet_update_do,
+								_conversation_update_do,
 								ov);
 }
 
-static void _message_info_genlist_update(Overview *ov, time_t timestamp,
+/* moves the conversation to the top of ov->messages, not of the genlist */
+static Message_Info *_message_info_touch(Overview *ov, time_t timestamp,
 						const char *sender,
 						const char *message)
 {
 	Message_Info *m_info;
-	Elm_Object_Item *it;
 
 	m_info = _message_info_search(ov, sender);
 
 	if (!m_info) {
 		m_info = calloc(1, sizeof(Message_Info));
-		EINA_SAFETY_ON_NULL_RETURN(m_info);
+		EINA_SAFETY_ON_NULL_RETURN_VAL(m_info, NULL);
 		m_info->sender = eina_stringshare_add(sender);
 		ov->messages->list = eina_list_prepend(ov->messages->list,
 							m_info);
+		m_info->node = ov->messages->list;
 		m_info->ov = ov;
-	} else {
-		ov->messages->list = eina_list_remove(ov->messages->list,
-							m_info);
-		ov->messages->list = eina_list_prepend(ov->messages->list,
-							m_info);
-		if (m_info->it)
-			elm_object_item_del(m_info->it);
-	}
+		eina_hash_direct_add(ov->senders, m_info->sender, m_info);
+	} else
+		ov->messages->list = eina_list_promote_list(ov->messages->list,
+								m_info->node);
 
 	m_info->count++;
 	m_info->time = timestamp;
 	eina_stringshare_replace(&m_info->last_msg, message);
 	ov->messages->dirty = EINA_TRUE;
+	return m_info;
+}
+
+static void _message_info_item_raise(Overview *ov, Message_Info *m_info)
+{
+	if (m_info->it)
+		elm_object_item_del(m_info->it);
 
-	it = elm_genlist_item_prepend(ov->genlist,
-					ov->itc, m_info, NULL,
-					ELM_GENLIST_ITEM_NONE,
-					_on_item_clicked, m_info);
-	m_info->it = it;
+	m_info->it = elm_genlist_item_prepend(ov->genlist,
+						ov->itc, m_info, NULL,
+						ELM_GENLIST_ITEM_NONE,
+						_on_item_clicked, m_info);
+}
 
+static void _message_info_genlist_update(Overview *ov, time_t timestamp,
+						const char *sender,
+						const char *message)
+{
+	Message_Info *m_info;
+
+	m_info = _message_info_touch(ov, timestamp, sender, message);
+	EINA_SAFETY_ON_NULL_RETURN(m_info);
+
+	_message_info_item_raise(ov, m_info);
 	elm_genlist_item_show(m_info->it, ELM_GENLIST_ITEM_SCROLLTO_TOP);
 	_overview_timer_updater_start(ov);
 	_overview_messages_save(ov);
 }
 
-Message *message_new(time_t timestamp, const char *content,
-			Eina_Bool outgoing, OFono_Sent_SMS_State state)
+Message *message_new(unsigned long long id, time_t timestamp,
+			const char *content, Eina_Bool outgoing,
+			OFono_Sent_SMS_State state)
 {
 	Message *msg;
 
 	msg = calloc(1, sizeof(Message));
 	EINA_SAFETY_ON_NULL_RETURN_VAL(msg, NULL);
+	msg->id = id;
 	msg->time = timestamp;
 	msg->outgoing = outgoing;
 	msg->content = eina_stringshare_add(content);
@@ -772,6 +725,61 @@ Message *message_new(time_t timestamp, const char *content,
 	return msg;
 }
 
+static void _incoming_sms_queue_drain(Overview *ov)
+{
+	Message *msg;
+
+	EINA_LIST_FREE(ov->incoming, msg) {
+		_message_info_touch(ov, msg->time, msg->phone, msg->content);
+		ov->p_conversations->list =
+			eina_list_append(ov->p_conversations->list, msg);
+		ov->p_conversations->dirty = EINA_TRUE;
+	}
+}
+
+static Eina_Bool _incoming_sms_flush(void *data)
+{
+	Overview *ov = data;
+	Message_Info *m_info;
+	Eina_List *l;
+	Message *msg;
+	unsigned int n = 0;
+
+	ov->incoming_idler = NULL;
+
+	EINA_LIST_FREE(ov->incoming, msg) {
+		m_info = _message_info_touch(ov, msg->time, msg->phone,
+						msg->content);
+		if ((m_info) && (!m_info->batched)) {
+			m_info->batched = EINA_TRUE;
+			n++;
+		}
+		ov->p_conversations->list =
+			eina_list_append(ov->p_conversations->list, msg);
+	}
+
+	/* The touched conversations are now the first n of the list, each
+	 * gets a single new genlist item.
+	 */
+	l = eina_list_nth_list(ov->messages->list, n - 1);
+	for (; n > 0; n--, l = eina_list_prev(l)) {
+		m_info = eina_list_data_get(l);
+		m_info->batched = EINA_FALSE;
+		_message_info_item_raise(ov, m_info);
+	}
+
+	m_info = eina_list_data_get(ov->messages->list);
+	if ((m_info) && (m_info->it))
+		elm_genlist_item_show(m_info->it,
+					ELM_GENLIST_ITEM_SCROLLTO_TOP);
+
+	_overview_timer_updater_start(ov);
+	_overview_messages_save(ov);
+	ov->p_conversations->dirty = EINA_TRUE;
+	_conversation_update(ov);
+	return ECORE_CALLBACK_CANCEL;
+}
+
 static void _incoming_sms_cb(void *data, unsigned int sms_class,
 				time_t timestamp, const char *sender,
 				const char *message)
@@ -783,17 +791,15 @@ static void _incoming_sms_cb(void *data, unsigned int sms_class,
 	if (sms_class != 1)
 		return;
 
-	msg = message_new(timestamp, message, EINA_FALSE,
-				OFONO_SENT_SMS_STATE_SENT);
+	msg = message_new(message_store_message_id_new(ov->store), timestamp,
+				message, EINA_FALSE, OFONO_SENT_SMS_STATE_SENT);
 	EINA_SAFETY_ON_NULL_RETURN(msg);
 	msg->phone = eina_stringshare_add(sender);
 
-	_message_info_genlist_update(ov, timestamp, sender, message);
-
-	ov->p_conversations->list = eina_list_append(ov->p_conversations->list,
-							msg);
-	ov->p_conversations->dirty = EINA_TRUE;
-	_conversation_eet_update(ov);
+	/* a modem flushing its queue delivers many at once */
+	ov->incoming = eina_list_append(ov->incoming, msg);
+	if (!ov->incoming_idler)
+		ov->incoming_idler = ecore_idler_add(_incoming_sms_flush, ov);
 }
 
 static void _on_show(void *data, Evas *e __UNUSED__,
@@ -968,6 +974,133 @@ static void _on_layout_clicked(void *data, Evas_Object *o,
 		ERR("Unkown emission: %s", emission);
 }
 
+static Eina_Bool _outbox_live_add(const Eina_Hash *hash __UNUSED__,
+					const void *key __UNUSED__,
+					void *data, void *fdata)
+{
+	Message *msg = data;
+	Eina_Hash *live = fdata;
+
+	if (msg->id)
+		eina_hash_add(live, &msg->id, msg);
+	return EINA_TRUE;
+}
+
+typedef struct _Outbox_Scan
+{
+	Eina_Hash *live;
+	Eina_List *orphans;
+} Outbox_Scan;
+
+static Eina_Bool _outbox_orphan_add(void *data, const char *phone,
+					unsigned long long id, long long time,
+					const char *content, Eina_Bool outgoing)
+{
+	Outbox_Scan *scan = data;
+	Message *msg;
+
+	if ((!outgoing) || (eina_hash_find(scan->live, &id)))
+		return EINA_TRUE;
+
+	msg = message_new(id, time, content, EINA_TRUE,
+				OFONO_SENT_SMS_STATE_PENDING);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(msg, EINA_FALSE);
+	msg->phone = eina_stringshare_add(phone);
+	scan->orphans = eina_list_append(scan->orphans, msg);
+	return EINA_TRUE;
+}
+
+static void _outbox_message_failed(Overview *ov, Message *msg)
+{
+	msg->state = OFONO_SENT_SMS_STATE_FAILED;
+	if (!message_store_message_state_set(ov->store, msg->phone, msg->time,
+						msg->id, msg->state))
+		ERR("Could not save the state of the message to %s",
+			msg->phone);
+}
+
+/* Messages saved as pending that no sent SMS of this run accounts for
+ * were left by a previous one. They were most likely sent, so sending
+ * them again could duplicate them: they are marked as failed and the
+ * user may send them again. oFono may still be sending them if it
+ * outlived us, so this waits until it has nothing pending that we do
+ * not know about, or until OUTBOX_WAIT_MAX if forced.
+ */
+static void _outbox_reconcile(Overview *ov, Eina_Bool force)
+{
+	Outbox_Scan scan;
+	Message *msg;
+
+	if ((!force) && (!ofono_sent_sms_fetched_get())) {
+		DBG("oFono messages not known yet, waiting");
+		return;
+	}
+
+	if ((!force) && (ofono_sent_sms_pending_count_get() >
+			(unsigned int)eina_hash_population(ov->pending_sms))) {
+		DBG("oFono is sending messages we do not know, waiting");
+		return;
+	}
+	ov->outbox_check = EINA_FALSE;
+	if (ov->outbox_timer) {
+		ecore_timer_del(ov->outbox_timer);
+		ov->outbox_timer = NULL;
+	}
+
+	scan.live = eina_hash_int64_new(NULL);
+	EINA_SAFETY_ON_NULL_RETURN(scan.live);
+	scan.orphans = NULL;
+	eina_hash_foreach(ov->pending_sms, _outbox_live_add, scan.live);
+	message_store_state_foreach(ov->store, OFONO_SENT_SMS_STATE_PENDING,
+					_outbox_orphan_add, &scan);
+	eina_hash_free(scan.live);
+
+	message_store_begin(ov->store);
+	EINA_LIST_FREE(scan.orphans, msg) {
+		INF("Message to %s left pending since %lld, failed",
+			msg->phone, msg->time);
+		_outbox_message_failed(ov, msg);
+		message_del(msg);
+	}
+	if (!message_store_commit(ov->store))
+		ERR("Could not save the outbox");
+}
+
+static Eina_Bool _outbox_timeout(void *data)
+{
+	Overview *ov = data;
+
+	WRN("oFono still sends messages we do not know, not waiting more");
+	ov->outbox_timer = NULL;
+	_outbox_reconcile(ov, EINA_TRUE);
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _outbox_modem_changed(void *data)
+{
+	Overview *ov = data;
+
+	if ((!ofono_voice_is_online()) ||
+		(!(ofono_modem_api_get() & OFONO_API_MSG))) {
+		ov->outbox_online = EINA_FALSE;
+		return;
+	}
+
+	if (ov->outbox_online) {
+		/* the messages of oFono may have just been fetched */
+		if (ov->outbox_check)
+			_outbox_reconcile(ov, EINA_FALSE);
+		return;
+	}
+
+	ov->outbox_online = EINA_TRUE;
+	ov->outbox_check = EINA_TRUE;
+	if (!ov->outbox_timer)
+		ov->outbox_timer = ecore_timer_add(OUTBOX_WAIT_MAX,
+							_outbox_timeout, ov);
+	_outbox_reconcile(ov, EINA_FALSE);
+}
+
 static void _sent_sms_cb(void *data, OFono_Error error, OFono_Sent_SMS *sms)
 {
 	Overview *ov = data;
@@ -975,6 +1108,7 @@ static void _sent_sms_cb(void *data, OFono_Error error, OFono_Sent_SMS *sms)
 	OFono_Sent_SMS_State state;
 	time_t timestamp;
 	const char *dest, *message;
+	Eina_Bool known;
 
 	if (error != OFONO_ERROR_NONE) {
 		ERR("OFono error - Sending a SMS");
@@ -985,24 +1119,36 @@ static void _sent_sms_cb(void *data, OFono_Error error, OFono_Sent_SMS *sms)
 	dest = ofono_sent_sms_destination_get(sms);
 	message = ofono_sent_sms_message_get(sms);
 	msg = eina_hash_find(ov->pending_sms, sms);
+	known = !!msg;
 	timestamp = ofono_sent_sms_timestamp_get(sms);
 
 	DBG("SMS Sent to: %s, message: %s, time: %ld", dest, message,
 		timestamp);
+
+	/* sent by someone else, nothing to show */
+	if (!dest) {
+		if (ov->outbox_check)
+			_outbox_reconcile(ov, EINA_FALSE);
+		return;
+	}
 	/* New SMS */
 	if (!msg) {
-		msg = message_new(timestamp, message, EINA_TRUE, state);
+		msg = message_new(message_store_message_id_new(ov->store),
+					timestamp, message, EINA_TRUE, state);
 		EINA_SAFETY_ON_NULL_RETURN(msg);
 		msg->phone = eina_stringshare_add(dest);
 
 		_message_info_genlist_update(ov, timestamp, dest, message);
-	} else
+	} else {
 		msg->state = state;
+		/* saves it if still waiting for the poller, by id anyway */
+		_conversation_save(ov, msg);
+	}
 
 	if (state == OFONO_SENT_SMS_STATE_FAILED ||
 		state == OFONO_SENT_SMS_STATE_SENT)
 		eina_hash_del_by_key(ov->pending_sms, sms);
-	else if (state == OFONO_SENT_SMS_STATE_PENDING) {
+	else if ((state == OFONO_SENT_SMS_STATE_PENDING) && (!known)) {
 		msg->refcount++;
 		eina_hash_add(ov->pending_sms, sms, msg);
 		ov->p_conversations->list = eina_list_append(ov->p_conversations->list,
@@ -1012,7 +1158,10 @@ static void _sent_sms_cb(void *data, OFono_Error error, OFono_Sent_SMS *sms)
 		ov->p_conversations->dirty = EINA_TRUE;
 	}
 
-	_conversation_eet_update(ov);
+	_conversation_update(ov);
+
+	if (ov->outbox_check)
+		_outbox_reconcile(ov, EINA_FALSE);
 }
 
 Evas_Object *overview_add(Evas_Object *parent)
@@ -1063,6 +1212,7 @@ Evas_Object *overview_add(Evas_Object *parent)
 	itc->decorate_all_item_style = "messages-overview-delete";
 	itc->decorate_item_style = "messages-overview-delete";
 	ov->genlist = genlist;
+	scroll_bench_genlist_add(genlist, "overview");
 	ov->itc = itc;
 
 	evas_object_smart_callback_add(genlist, "drag,start,right",
@@ -1113,8 +1263,13 @@ Evas_Object *overview_add(Evas_Object *parent)
 	if (r < 0)
 		goto err_bkp;
 
-	_eet_descriptors_init(&ov->edd_msg_list, &ov->edd_msg_info,
-				&ov->edd_msg, &ov->edd_c_msg);
+	ov->store = message_store_new(ov->base_dir);
+	EINA_SAFETY_ON_NULL_GOTO(ov->store, err_store);
+
+	ov->senders = eina_hash_string_superfast_new(NULL);
+	EINA_SAFETY_ON_NULL_GOTO(ov->senders, err_senders);
+
+	_eet_descriptors_init(&ov->edd_msg_list, &ov->edd_msg_info);
 	_overview_messages_read(ov);
 
 	ov->pending_sms = eina_hash_pointer_new(EINA_FREE_CB(message_del));
@@ -1122,11 +1277,17 @@ Evas_Object *overview_add(Evas_Object *parent)
 
 	incoming_sms = ofono_incoming_sms_cb_add(_incoming_sms_cb, ov);
 	sent_sms = ofono_sent_sms_changed_cb_add(_sent_sms_cb, ov);
+	modem_changed = ofono_modem_changed_cb_add(_outbox_modem_changed, ov);
+	_outbox_modem_changed(ov);
 	elm_object_signal_emit(ov->layout, "toggle,on,view", "gui");
 
 	return obj;
 
 err_hash:
+	eina_hash_free(ov->senders);
+err_senders:
+	message_store_free(ov->store);
+err_store:
 	free(ov->msg_bkp);
 err_bkp:
 	free(ov->msg_path);
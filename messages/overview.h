@@ -27,6 +27,12 @@ void message_object_item_set(Message *msg, Elm_Object_Item *it);
 void overview_genlist_update(Evas_Object *obj, Message *msg,const char *contact);
 void overview_all_contact_messages_clear(Evas_Object *obj, const char *contact);
 
-Message *message_new(time_t timestamp, const char *content,
-			Eina_Bool outgoing, OFono_Sent_SMS_State state);
+/* up to count messages stored before msg, oldest first */
+Eina_List *overview_messages_older_get(Evas_Object *obj, const char *contact,
+					const Message *msg, unsigned int count);
+
+/* id is 0 for messages only shown, not saved */
+Message *message_new(unsigned long long id, time_t timestamp,
+			const char *content, Eina_Bool outgoing,
+			OFono_Sent_SMS_State state);
 #endif
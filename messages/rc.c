@@ -14,9 +14,31 @@ static E_DBus_Interface *bus_iface = NULL;
 #define RC_IFACE "org.tizen.messages.Control"
 #define RC_PATH "/"
 
+/* messages of a batch handed to oFono at once */
+#define RC_SEND_WINDOW 4
+
+typedef struct _RC_Batch_Item
+{
+	const char *number;
+	const char *message;
+} RC_Batch_Item;
+
+typedef struct _RC_Batch
+{
+	unsigned int id;
+	unsigned int total;
+	unsigned int sent;
+	unsigned int failed;
+	Eina_List *waiting; /* RC_Batch_Item, until the modem is online */
+} RC_Batch;
+
 static const char *rc_service = NULL;
 static OFono_Callback_List_Modem_Node *modem_changed_node = NULL;
-static DBusMessage *pending_send = NULL;
+static Eina_List *pending_sends = NULL; /* Send calls while offline */
+static Eina_List *batches = NULL;
+static OFono_SMS_Queue *send_queue = NULL;
+static Ecore_Idler *batches_idler = NULL;
+static unsigned int next_batch_id = 1;
 
 static void _send_message(const char *number, const char *message,
 				Eina_Bool do_auto)
@@ -26,16 +48,138 @@ static void _send_message(const char *number, const char *message,
 	gui_send(number, message, do_auto);
 }
 
-static void _modem_changed_cb(void *data __UNUSED__)
+static void _rc_signal_send(const char *name, int first_type, ...)
+{
+	DBusMessage *msg;
+	va_list ap;
+
+	if (!bus_obj)
+		return;
+
+	msg = dbus_message_new_signal(RC_PATH, RC_IFACE, name);
+	EINA_SAFETY_ON_NULL_RETURN(msg);
+
+	va_start(ap, first_type);
+	if (dbus_message_append_args_valist(msg, first_type, ap))
+		e_dbus_message_send(bus_conn, msg, NULL, -1, NULL);
+	else
+		ERR("Could not build signal %s", name);
+	va_end(ap);
+
+	dbus_message_unref(msg);
+}
+
+static void _batch_free(RC_Batch *batch)
+{
+	RC_Batch_Item *item;
+
+	EINA_LIST_FREE(batch->waiting, item) {
+		eina_stringshare_del(item->number);
+		eina_stringshare_del(item->message);
+		free(item);
+	}
+	free(batch);
+}
+
+static void _batch_done_check(RC_Batch *batch)
+{
+	if ((batch->waiting) || (batch->sent + batch->failed < batch->total))
+		return;
+
+	INF("batch %u done: %u sent, %u failed", batch->id, batch->sent,
+		batch->failed);
+	_rc_signal_send("BatchDone", DBUS_TYPE_UINT32, &batch->id,
+			DBUS_TYPE_UINT32, &batch->sent,
+			DBUS_TYPE_UINT32, &batch->failed, DBUS_TYPE_INVALID);
+
+	batches = eina_list_remove(batches, batch);
+	_batch_free(batch);
+}
+
+/* err_msg is NULL if sent, the caller checks if the batch is done */
+static void _batch_progress(RC_Batch *batch, const char *number,
+				const char *err_msg)
+{
+	dbus_bool_t sent = !err_msg;
+
+	if (sent) {
+		batch->sent++;
+		err_msg = "";
+	} else {
+		batch->failed++;
+		ERR("batch %u: could not send to %s: %s", batch->id, number,
+			err_msg);
+	}
+
+	_rc_signal_send("BatchProgress", DBUS_TYPE_UINT32, &batch->id,
+			DBUS_TYPE_STRING, &number, DBUS_TYPE_BOOLEAN, &sent,
+			DBUS_TYPE_STRING, &err_msg, DBUS_TYPE_INVALID);
+}
+
+static void _send_queue_cb(void *data __UNUSED__, void *item_data,
+				const char *number,
+				OFono_SMS_Queue_State state, OFono_Error error,
+				OFono_Sent_SMS *sms __UNUSED__)
+{
+	RC_Batch *batch = item_data;
+
+	if (state == OFONO_SMS_QUEUE_STATE_SENT)
+		_batch_progress(batch, number, NULL);
+	else if (state == OFONO_SMS_QUEUE_STATE_FAILED)
+		_batch_progress(batch, number, ofono_error_message_get(error));
+	else
+		return;
+
+	_batch_done_check(batch);
+}
+
+static void _batch_push(RC_Batch *batch)
+{
+	RC_Batch_Item *item;
+
+	/* batch->waiting is only empty after the last push, so failures
+	 * reported right away do not finish the batch under us.
+	 */
+	EINA_LIST_FREE(batch->waiting, item) {
+		if (!ofono_sms_queue_push(send_queue, item->number,
+						item->message, batch))
+			_batch_progress(batch, item->number,
+					"Could not queue the message");
+		eina_stringshare_del(item->number);
+		eina_stringshare_del(item->message);
+		free(item);
+	}
+	_batch_done_check(batch);
+}
+
+static void _batches_push(void)
+{
+	RC_Batch *batch;
+	Eina_List *l, *l_next;
+
+	if (!ofono_voice_is_online())
+		return;
+
+	EINA_LIST_FOREACH_SAFE(batches, l, l_next, batch) {
+		if (batch->waiting)
+			_batch_push(batch);
+	}
+}
+
+static Eina_Bool _batches_idler_cb(void *data __UNUSED__)
+{
+	batches_idler = NULL;
+	_batches_push();
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _pending_send_process(DBusMessage *pending_send)
 {
 	DBusError err;
 	const char *number, *message;
 	dbus_bool_t do_auto;
 	DBusMessage *reply;
 
-	if (!ofono_voice_is_online() || !pending_send)
-		return;
-
 	dbus_error_init(&err);
 	dbus_message_get_args(pending_send, &err,
 				DBUS_TYPE_STRING, &number,
@@ -55,7 +199,19 @@ reply_send:
 	e_dbus_message_send(bus_conn, reply, NULL, -1, NULL);
 	dbus_message_unref(pending_send);
 	dbus_message_unref(reply);
-	pending_send = NULL;
+}
+
+static void _modem_changed_cb(void *data __UNUSED__)
+{
+	DBusMessage *pending_send;
+
+	if (!ofono_voice_is_online())
+		return;
+
+	EINA_LIST_FREE(pending_sends, pending_send)
+		_pending_send_process(pending_send);
+
+	_batches_push();
 }
 
 static DBusMessage *
@@ -74,9 +230,8 @@ _rc_send(E_DBus_Object *obj __UNUSED__, DBusMessage *msg)
 	const char *number, *message;
 
 	if (!ofono_voice_is_online()) {
-		if (pending_send)
-			dbus_message_unref(pending_send);
-		pending_send = dbus_message_ref(msg);
+		pending_sends = eina_list_append(pending_sends,
+							dbus_message_ref(msg));
 		return NULL;
 	}
 
@@ -93,6 +248,66 @@ _rc_send(E_DBus_Object *obj __UNUSED__, DBusMessage *msg)
 	return dbus_message_new_method_return(msg);
 }
 
+static DBusMessage *
+_rc_send_batch(E_DBus_Object *obj __UNUSED__, DBusMessage *msg)
+{
+	DBusMessageIter iter, array, entry;
+	const char *number, *message;
+	RC_Batch_Item *item;
+	RC_Batch *batch;
+	DBusMessage *reply;
+
+	if ((strcmp(dbus_message_get_signature(msg), "a(ss)") != 0) ||
+		(!dbus_message_iter_init(msg, &iter)))
+		return dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+						"Expected a(ss)");
+
+	batch = calloc(1, sizeof(RC_Batch));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(batch, NULL);
+
+	dbus_message_iter_recurse(&iter, &array);
+	for (; dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT;
+			dbus_message_iter_next(&array)) {
+		dbus_message_iter_recurse(&array, &entry);
+		dbus_message_iter_get_basic(&entry, &number);
+		dbus_message_iter_next(&entry);
+		dbus_message_iter_get_basic(&entry, &message);
+
+		item = calloc(1, sizeof(RC_Batch_Item));
+		EINA_SAFETY_ON_NULL_GOTO(item, err_item);
+		item->number = eina_stringshare_add(number);
+		item->message = eina_stringshare_add(message);
+		batch->waiting = eina_list_append(batch->waiting, item);
+		batch->total++;
+	}
+
+	if (!batch->total) {
+		_batch_free(batch);
+		return dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+						"Empty batch");
+	}
+
+	reply = dbus_message_new_method_return(msg);
+	EINA_SAFETY_ON_NULL_GOTO(reply, err_item);
+
+	batch->id = next_batch_id++;
+	dbus_message_append_args(reply, DBUS_TYPE_UINT32, &batch->id,
+					DBUS_TYPE_INVALID);
+	batches = eina_list_append(batches, batch);
+	INF("batch %u: %u messages", batch->id, batch->total);
+
+	/* after the reply, so the caller knows the id of its signals */
+	if (!batches_idler)
+		batches_idler = ecore_idler_add(_batches_idler_cb, NULL);
+
+	return reply;
+
+err_item:
+	_batch_free(batch);
+	return dbus_message_new_error(msg, DBUS_ERROR_NO_MEMORY,
+					"Could not queue the batch");
+}
+
 static void _rc_object_register(void)
 {
 	bus_obj = e_dbus_object_add(bus_conn, RC_PATH, NULL);
@@ -108,7 +323,11 @@ static void _rc_object_register(void)
 
 	IF_ADD("Activate", "", "", _rc_activate);
 	IF_ADD("Send", "ssb", "", _rc_send);
+	IF_ADD("SendBatch", "a(ss)", "u", _rc_send_batch);
 #undef IF_ADD
+
+	e_dbus_interface_signal_add(bus_iface, "BatchProgress", "usbs");
+	e_dbus_interface_signal_add(bus_iface, "BatchDone", "uuu");
 }
 
 static void _rc_activate_existing_reply(void *data __UNUSED__,
@@ -190,6 +409,12 @@ Eina_Bool rc_init(const char *service)
 	e_dbus_request_name(bus_conn, rc_service, DBUS_NAME_FLAG_DO_NOT_QUEUE,
 				_rc_request_name_reply, NULL);
 
+	send_queue = ofono_sms_queue_new(RC_SEND_WINDOW, _send_queue_cb, NULL);
+	if (!send_queue) {
+		CRITICAL("Could not create the send queue");
+		return EINA_FALSE;
+	}
+
 	modem_changed_node = ofono_modem_changed_cb_add(_modem_changed_cb,
 							NULL);
 
@@ -198,6 +423,9 @@ Eina_Bool rc_init(const char *service)
 
 void rc_shutdown(void)
 {
+	DBusMessage *pending_send;
+	RC_Batch *batch;
+
 	if (bus_obj)
 		e_dbus_object_free(bus_obj);
 	if (bus_iface)
@@ -205,8 +433,15 @@ void rc_shutdown(void)
 
 	ofono_modem_changed_cb_del(modem_changed_node);
 
-	if (pending_send)
+	EINA_LIST_FREE(pending_sends, pending_send)
 		dbus_message_unref(pending_send);
 
+	if (batches_idler)
+		ecore_idler_del(batches_idler);
+	if (send_queue)
+		ofono_sms_queue_free(send_queue);
+	EINA_LIST_FREE(batches, batch)
+		_batch_free(batch);
+
 	bus_conn = NULL;
 }
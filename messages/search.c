@@ -0,0 +1,643 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wctype.h>
+
+#include "log.h"
+#include "search.h"
+
+#define INDEX_MAGIC "OEMIDX1"
+#define INDEX_WORD_MAX 64 /* bytes, longer words are cut */
+
+typedef struct _Index_Posting {
+	uint64_t id;
+	int64_t time;
+	uint32_t phone; /* position in Message_Index.phones */
+} Index_Posting;
+
+typedef struct _Index_Word {
+	const char *word;
+	Eina_Inarray *postings; /* Index_Posting, by id */
+} Index_Word;
+
+struct _Message_Index {
+	Eina_Hash *words; /* word -> Index_Word */
+	Eina_Inarray *sorted; /* Index_Word *, by word */
+	Eina_Inarray *phones; /* const char * */
+	Eina_Hash *phone_ids; /* phone -> position in phones + 1 */
+};
+
+typedef void (*Index_Word_Cb)(void *data, const char *word);
+
+typedef struct _Index_Update {
+	Message_Index *idx;
+	Index_Posting posting;
+} Index_Update;
+
+typedef struct _Index_Query {
+	const Message_Index *idx;
+	Eina_Inarray *hits; /* Index_Posting, by id */
+	Eina_Bool first;
+} Index_Query;
+
+static size_t _utf8_put(char *buf, Eina_Unicode cp)
+{
+	if (cp < 0x80) {
+		buf[0] = cp;
+		return 1;
+	} else if (cp < 0x800) {
+		buf[0] = 0xc0 | (cp >> 6);
+		buf[1] = 0x80 | (cp & 0x3f);
+		return 2;
+	} else if (cp < 0x10000) {
+		buf[0] = 0xe0 | (cp >> 12);
+		buf[1] = 0x80 | ((cp >> 6) & 0x3f);
+		buf[2] = 0x80 | (cp & 0x3f);
+		return 3;
+	}
+
+	buf[0] = 0xf0 | (cp >> 18);
+	buf[1] = 0x80 | ((cp >> 12) & 0x3f);
+	buf[2] = 0x80 | ((cp >> 6) & 0x3f);
+	buf[3] = 0x80 | (cp & 0x3f);
+	return 4;
+}
+
+/* case folded runs of letters and digits */
+static void _words_foreach(const char *text, Index_Word_Cb cb, void *data)
+{
+	char word[INDEX_WORD_MAX + 1], buf[4];
+	Eina_Unicode cp;
+	size_t len = 0, n;
+	int i = 0;
+
+	do {
+		cp = eina_unicode_utf8_get_next(text, &i);
+		if ((cp) && (iswalnum(cp))) {
+			n = _utf8_put(buf, towlower(cp));
+			if (len + n <= INDEX_WORD_MAX) {
+				memcpy(word + len, buf, n);
+				len += n;
+			}
+			continue;
+		}
+
+		if (len) {
+			word[len] = '\0';
+			cb(data, word);
+			len = 0;
+		}
+	} while (cp);
+}
+
+static unsigned int _word_position(const Eina_Inarray *sorted,
+					const char *word)
+{
+	unsigned int lo = 0, hi = eina_inarray_count(sorted);
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		Index_Word **w = eina_inarray_nth(sorted, mid);
+		if (strcmp((*w)->word, word) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static unsigned int _posting_position(const Eina_Inarray *postings,
+					uint64_t id)
+{
+	unsigned int lo = 0, hi = eina_inarray_count(postings);
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		const Index_Posting *p = eina_inarray_nth(postings, mid);
+		if (p->id < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void _index_word_free(void *data)
+{
+	Index_Word *w = data;
+
+	eina_inarray_free(w->postings);
+	eina_stringshare_del(w->word);
+	free(w);
+}
+
+static Index_Word *_index_word_new(Message_Index *idx, const char *word,
+					unsigned int position)
+{
+	Index_Word *w;
+
+	w = calloc(1, sizeof(Index_Word));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(w, NULL);
+
+	w->postings = eina_inarray_new(sizeof(Index_Posting), 0);
+	EINA_SAFETY_ON_NULL_GOTO(w->postings, err);
+
+	w->word = eina_stringshare_add(word);
+	eina_hash_direct_add(idx->words, w->word, w);
+	eina_inarray_insert_at(idx->sorted, position, &w);
+	return w;
+
+err:
+	free(w);
+	return NULL;
+}
+
+static uint32_t _index_phone_get(Message_Index *idx, const char *phone)
+{
+	uintptr_t pos = (uintptr_t)eina_hash_find(idx->phone_ids, phone);
+
+	if (pos)
+		return pos - 1;
+
+	phone = eina_stringshare_add(phone);
+	pos = eina_inarray_push(idx->phones, &phone) + 1;
+	eina_hash_direct_add(idx->phone_ids, phone, (void *)pos);
+	return pos - 1;
+}
+
+static void _index_word_add(void *data, const char *word)
+{
+	Index_Update *ctx = data;
+	const Index_Posting *p;
+	Index_Word *w;
+	unsigned int pos;
+
+	w = eina_hash_find(ctx->idx->words, word);
+	if (!w) {
+		pos = _word_position(ctx->idx->sorted, word);
+		w = _index_word_new(ctx->idx, word, pos);
+		if (!w)
+			return;
+	}
+
+	pos = _posting_position(w->postings, ctx->posting.id);
+	if (pos < eina_inarray_count(w->postings)) {
+		p = eina_inarray_nth(w->postings, pos);
+		/* word repeated in the message */
+		if (p->id == ctx->posting.id)
+			return;
+	}
+
+	eina_inarray_insert_at(w->postings, pos, &ctx->posting);
+}
+
+static void _index_word_remove(void *data, const char *word)
+{
+	Index_Update *ctx = data;
+	const Index_Posting *p;
+	Index_Word *w;
+	unsigned int pos;
+
+	w = eina_hash_find(ctx->idx->words, word);
+	if (!w)
+		return;
+
+	pos = _posting_position(w->postings, ctx->posting.id);
+	if (pos == eina_inarray_count(w->postings))
+		return;
+
+	p = eina_inarray_nth(w->postings, pos);
+	if (p->id != ctx->posting.id)
+		return;
+
+	eina_inarray_remove_at(w->postings, pos);
+	if (eina_inarray_count(w->postings) > 0)
+		return;
+
+	eina_inarray_remove_at(ctx->idx->sorted,
+				_word_position(ctx->idx->sorted, w->word));
+	eina_hash_del_by_key(ctx->idx->words, w->word);
+}
+
+Message_Index *message_index_new(void)
+{
+	Message_Index *idx;
+
+	idx = calloc(1, sizeof(Message_Index));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(idx, NULL);
+
+	idx->words = eina_hash_string_superfast_new(_index_word_free);
+	EINA_SAFETY_ON_NULL_GOTO(idx->words, err_words);
+
+	idx->sorted = eina_inarray_new(sizeof(Index_Word *), 0);
+	EINA_SAFETY_ON_NULL_GOTO(idx->sorted, err_sorted);
+
+	idx->phones = eina_inarray_new(sizeof(const char *), 0);
+	EINA_SAFETY_ON_NULL_GOTO(idx->phones, err_phones);
+
+	idx->phone_ids = eina_hash_string_superfast_new(NULL);
+	EINA_SAFETY_ON_NULL_GOTO(idx->phone_ids, err_phone_ids);
+
+	return idx;
+
+err_phone_ids:
+	eina_inarray_free(idx->phones);
+err_phones:
+	eina_inarray_free(idx->sorted);
+err_sorted:
+	eina_hash_free(idx->words);
+err_words:
+	free(idx);
+	return NULL;
+}
+
+void message_index_clear(Message_Index *idx)
+{
+	const char **phone;
+
+	EINA_SAFETY_ON_NULL_RETURN(idx);
+
+	eina_inarray_flush(idx->sorted);
+	eina_hash_free_buckets(idx->words);
+	eina_hash_free_buckets(idx->phone_ids);
+
+	EINA_INARRAY_FOREACH(idx->phones, phone)
+		eina_stringshare_del(*phone);
+	eina_inarray_flush(idx->phones);
+}
+
+void message_index_free(Message_Index *idx)
+{
+	EINA_SAFETY_ON_NULL_RETURN(idx);
+
+	message_index_clear(idx);
+	eina_hash_free(idx->phone_ids);
+	eina_inarray_free(idx->phones);
+	eina_inarray_free(idx->sorted);
+	eina_hash_free(idx->words);
+	free(idx);
+}
+
+void message_index_add(Message_Index *idx, const char *phone,
+			unsigned long long id, long long time,
+			const char *content)
+{
+	Index_Update ctx;
+
+	EINA_SAFETY_ON_NULL_RETURN(idx);
+	EINA_SAFETY_ON_NULL_RETURN(phone);
+	EINA_SAFETY_ON_NULL_RETURN(content);
+
+	ctx.idx = idx;
+	ctx.posting.id = id;
+	ctx.posting.time = time;
+	ctx.posting.phone = _index_phone_get(idx, phone);
+	_words_foreach(content, _index_word_add, &ctx);
+}
+
+void message_index_del(Message_Index *idx, unsigned long long id,
+			const char *content)
+{
+	Index_Update ctx;
+
+	EINA_SAFETY_ON_NULL_RETURN(idx);
+	EINA_SAFETY_ON_NULL_RETURN(content);
+
+	ctx.idx = idx;
+	ctx.posting.id = id;
+	_words_foreach(content, _index_word_remove, &ctx);
+}
+
+static int _posting_id_cmp(const void *a, const void *b)
+{
+	const Index_Posting *pa = a, *pb = b;
+
+	if (pa->id < pb->id)
+		return -1;
+	return pa->id > pb->id;
+}
+
+static int _posting_recent_cmp(const void *a, const void *b)
+{
+	const Index_Posting *pa = a, *pb = b;
+
+	if (pa->time != pb->time)
+		return pa->time < pb->time ? 1 : -1;
+	return _posting_id_cmp(b, a);
+}
+
+/* messages with a word starting with prefix, by id */
+static Eina_Inarray *_query_prefix(const Message_Index *idx, const char *prefix)
+{
+	Eina_Inarray *all, *unique;
+	const Index_Posting *p, *last = NULL;
+	unsigned int pos, n = eina_inarray_count(idx->sorted);
+	size_t len = strlen(prefix);
+
+	all = eina_inarray_new(sizeof(Index_Posting), 64);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(all, NULL);
+
+	for (pos = _word_position(idx->sorted, prefix); pos < n; pos++) {
+		Index_Word **w = eina_inarray_nth(idx->sorted, pos);
+		if (strncmp((*w)->word, prefix, len) != 0)
+			break;
+		EINA_INARRAY_FOREACH((*w)->postings, p)
+			eina_inarray_push(all, p);
+	}
+
+	eina_inarray_sort(all, _posting_id_cmp);
+
+	unique = eina_inarray_new(sizeof(Index_Posting), 64);
+	EINA_SAFETY_ON_NULL_GOTO(unique, end);
+
+	EINA_INARRAY_FOREACH(all, p) {
+		if ((!last) || (last->id != p->id))
+			eina_inarray_push(unique, p);
+		last = p;
+	}
+
+end:
+	eina_inarray_free(all);
+	return unique;
+}
+
+static void _query_word(void *data, const char *word)
+{
+	Index_Query *q = data;
+	Eina_Inarray *found, *both;
+	unsigned int i = 0, j = 0, n, m;
+
+	if ((!q->first) && (!q->hits))
+		return;
+
+	found = _query_prefix(q->idx, word);
+	if ((q->first) || (!found)) {
+		q->first = EINA_FALSE;
+		q->hits = found;
+		return;
+	}
+
+	/* both are sorted by id */
+	both = eina_inarray_new(sizeof(Index_Posting), 64);
+	n = eina_inarray_count(q->hits);
+	m = eina_inarray_count(found);
+	while ((both) && (i < n) && (j < m)) {
+		const Index_Posting *a = eina_inarray_nth(q->hits, i);
+		const Index_Posting *b = eina_inarray_nth(found, j);
+
+		if (a->id < b->id)
+			i++;
+		else if (a->id > b->id)
+			j++;
+		else {
+			eina_inarray_push(both, a);
+			i++;
+			j++;
+		}
+	}
+
+	eina_inarray_free(found);
+	eina_inarray_free(q->hits);
+	q->hits = both;
+}
+
+void message_index_query(const Message_Index *idx, const char *query,
+				unsigned int max, Message_Index_Hit_Cb cb,
+				const void *data)
+{
+	const Index_Posting *p;
+	Index_Query q;
+
+	EINA_SAFETY_ON_NULL_RETURN(idx);
+	EINA_SAFETY_ON_NULL_RETURN(query);
+	EINA_SAFETY_ON_NULL_RETURN(cb);
+
+	q.idx = idx;
+	q.hits = NULL;
+	q.first = EINA_TRUE;
+	_words_foreach(query, _query_word, &q);
+
+	if (!q.hits)
+		return;
+
+	eina_inarray_sort(q.hits, _posting_recent_cmp);
+	EINA_INARRAY_FOREACH(q.hits, p) {
+		const char **phone = eina_inarray_nth(idx->phones, p->phone);
+
+		if (max-- == 0)
+			break;
+		if (!cb((void *)data, *phone, p->id, p->time))
+			break;
+	}
+
+	eina_inarray_free(q.hits);
+}
+
+/* FNV-1a */
+static uint32_t _checksum(uint32_t h, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		h = (h ^ p[i]) * 16777619U;
+	return h;
+}
+
+static Eina_Bool _index_write(FILE *fp, uint32_t *sum, const void *buf,
+				size_t len)
+{
+	*sum = _checksum(*sum, buf, len);
+	return fwrite(buf, 1, len, fp) == len;
+}
+
+/* magic, signature, phone count, word count, phones, then each word with
+ * its postings, and a checksum of all that.
+ */
+Eina_Bool message_index_save(const Message_Index *idx, const char *path,
+				unsigned long long signature)
+{
+	char tmp[PATH_MAX];
+	uint32_t sum = 2166136261U, count;
+	uint64_t sig = signature;
+	Index_Word **w;
+	const char **phone;
+	Eina_Bool ok;
+	FILE *fp;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(idx, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(path, EINA_FALSE);
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	fp = fopen(tmp, "wb");
+	if (!fp) {
+		ERR("could not open %s: %s", tmp, strerror(errno));
+		return EINA_FALSE;
+	}
+
+	ok = _index_write(fp, &sum, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	ok &= _index_write(fp, &sum, &sig, sizeof(sig));
+	count = eina_inarray_count(idx->phones);
+	ok &= _index_write(fp, &sum, &count, sizeof(count));
+	count = eina_inarray_count(idx->sorted);
+	ok &= _index_write(fp, &sum, &count, sizeof(count));
+
+	EINA_INARRAY_FOREACH(idx->phones, phone)
+		ok &= _index_write(fp, &sum, *phone, strlen(*phone) + 1);
+
+	EINA_INARRAY_FOREACH(idx->sorted, w) {
+		const Index_Posting *p;
+
+		ok &= _index_write(fp, &sum, (*w)->word,
+					strlen((*w)->word) + 1);
+		count = eina_inarray_count((*w)->postings);
+		ok &= _index_write(fp, &sum, &count, sizeof(count));
+		EINA_INARRAY_FOREACH((*w)->postings, p) {
+			ok &= _index_write(fp, &sum, &p->id, sizeof(p->id));
+			ok &= _index_write(fp, &sum, &p->time,
+						sizeof(p->time));
+			ok &= _index_write(fp, &sum, &p->phone,
+						sizeof(p->phone));
+		}
+		if (!ok)
+			break;
+	}
+
+	ok &= fwrite(&sum, sizeof(sum), 1, fp) == 1;
+	ok &= fclose(fp) == 0;
+
+	if ((!ok) || (rename(tmp, path) < 0)) {
+		ERR("could not write %s", path);
+		unlink(tmp);
+		return EINA_FALSE;
+	}
+
+	return EINA_TRUE;
+}
+
+static Eina_Bool _index_read(const char **p, const char *end, void *buf,
+				size_t len)
+{
+	if ((size_t)(end - *p) < len)
+		return EINA_FALSE;
+	memcpy(buf, *p, len);
+	*p += len;
+	return EINA_TRUE;
+}
+
+static const char *_index_read_string(const char **p, const char *end)
+{
+	const char *s = *p, *nul = memchr(s, '\0', end - s);
+
+	if (!nul)
+		return NULL;
+	*p = nul + 1;
+	return s;
+}
+
+static Eina_Bool _index_parse(Message_Index *idx, const char *map,
+				size_t size, unsigned long long signature)
+{
+	const char *p = map, *end = map + size - sizeof(uint32_t);
+	uint32_t sum, phones, words, i, j;
+	char magic[sizeof(INDEX_MAGIC)];
+	uint64_t sig;
+
+	memcpy(&sum, end, sizeof(sum));
+	if (sum != _checksum(2166136261U, map, end - map))
+		return EINA_FALSE;
+
+	if ((!_index_read(&p, end, magic, sizeof(magic))) ||
+		(memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0) ||
+		(!_index_read(&p, end, &sig, sizeof(sig))) ||
+		(sig != signature) ||
+		(!_index_read(&p, end, &phones, sizeof(phones))) ||
+		(!_index_read(&p, end, &words, sizeof(words))))
+		return EINA_FALSE;
+
+	for (i = 0; i < phones; i++) {
+		const char *phone = _index_read_string(&p, end);
+		if (!phone)
+			return EINA_FALSE;
+		_index_phone_get(idx, phone);
+	}
+	if (eina_inarray_count(idx->phones) != phones)
+		return EINA_FALSE;
+
+	for (i = 0; i < words; i++) {
+		const char *word = _index_read_string(&p, end);
+		Index_Posting posting;
+		Index_Word *w;
+		uint32_t count;
+
+		/* written in order, so always appended */
+		if ((!word) || (eina_hash_find(idx->words, word)) ||
+			(!_index_read(&p, end, &count, sizeof(count))))
+			return EINA_FALSE;
+		if (_word_position(idx->sorted, word) !=
+			eina_inarray_count(idx->sorted))
+			return EINA_FALSE;
+
+		w = _index_word_new(idx, word, eina_inarray_count(idx->sorted));
+		if (!w)
+			return EINA_FALSE;
+
+		for (j = 0; j < count; j++) {
+			if ((!_index_read(&p, end, &posting.id,
+						sizeof(posting.id))) ||
+				(!_index_read(&p, end, &posting.time,
+						sizeof(posting.time))) ||
+				(!_index_read(&p, end, &posting.phone,
+						sizeof(posting.phone))) ||
+				(posting.phone >= phones))
+				return EINA_FALSE;
+			eina_inarray_push(w->postings, &posting);
+		}
+	}
+
+	return p == end;
+}
+
+Eina_Bool message_index_load(Message_Index *idx, const char *path,
+				unsigned long long signature)
+{
+	Eina_File *file;
+	const char *map;
+	size_t size;
+	Eina_Bool ok = EINA_FALSE;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(idx, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(path, EINA_FALSE);
+
+	message_index_clear(idx);
+
+	file = eina_file_open(path, EINA_FALSE);
+	if (!file)
+		return EINA_FALSE;
+
+	size = eina_file_size_get(file);
+	map = eina_file_map_all(file, EINA_FILE_SEQUENTIAL);
+	if ((map) && (size >= sizeof(INDEX_MAGIC) + sizeof(uint32_t)))
+		ok = _index_parse(idx, map, size, signature);
+
+	if (map)
+		eina_file_map_free(file, (void *)map);
+	eina_file_close(file);
+
+	if (!ok) {
+		DBG("%s is stale or broken", path);
+		message_index_clear(idx);
+	}
+
+	return ok;
+}
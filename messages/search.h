@@ -0,0 +1,43 @@
+#ifndef _EFL_OFONO_SEARCH_H__
+#define _EFL_OFONO_SEARCH_H__ 1
+
+/*
+ * Inverted index of the message content, for search as you type.
+ *
+ * Words are split on anything but letters and digits and case folded,
+ * each word of a query matches the words starting with it and a hit
+ * must match all words of the query.
+ */
+
+typedef struct _Message_Index Message_Index;
+
+typedef Eina_Bool (*Message_Index_Hit_Cb)(void *data, const char *phone,
+						unsigned long long id,
+						long long time);
+
+Message_Index *message_index_new(void);
+void message_index_free(Message_Index *idx);
+void message_index_clear(Message_Index *idx);
+
+void message_index_add(Message_Index *idx, const char *phone,
+			unsigned long long id, long long time,
+			const char *content);
+
+/* content must be the one the message was added with */
+void message_index_del(Message_Index *idx, unsigned long long id,
+			const char *content);
+
+/* newest first, stops after max hits or if cb returns EINA_FALSE */
+void message_index_query(const Message_Index *idx, const char *query,
+				unsigned int max, Message_Index_Hit_Cb cb,
+				const void *data);
+
+/* signature identifies what the index was built from, load fails and
+ * leaves idx empty if the file is for another one.
+ */
+Eina_Bool message_index_save(const Message_Index *idx, const char *path,
+				unsigned long long signature);
+Eina_Bool message_index_load(Message_Index *idx, const char *path,
+				unsigned long long signature);
+
+#endif
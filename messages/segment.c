@@ -0,0 +1,321 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "segment.h"
+
+#define SEPTETS_SINGLE 160
+#define SEPTETS_PART 153
+#define UNITS_SINGLE 70
+#define UNITS_PART 67
+#define ENTITY_MAX 12
+
+/* septets of the ASCII characters in GSM 03.38, 0 if not there */
+static const unsigned char _gsm_ascii[128] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 2, 1, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 1,
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 0
+};
+
+/* the rest of the default alphabet, sorted */
+static const Eina_Unicode _gsm_other[] = {
+	0x00a1, 0x00a3, 0x00a4, 0x00a5, 0x00a7, 0x00bf, 0x00c4, 0x00c5,
+	0x00c6, 0x00c7, 0x00c9, 0x00d1, 0x00d6, 0x00d8, 0x00dc, 0x00df,
+	0x00e0, 0x00e4, 0x00e5, 0x00e6, 0x00e8, 0x00e9, 0x00ec, 0x00f1,
+	0x00f2, 0x00f6, 0x00f8, 0x00f9, 0x00fc, 0x0393, 0x0394, 0x0398,
+	0x039b, 0x039e, 0x03a0, 0x03a3, 0x03a6, 0x03a8, 0x03a9
+};
+
+#define GSM_EURO 0x20ac /* only one of the extension table not in ASCII */
+
+static int _unicode_cmp(const void *a, const void *b)
+{
+	const Eina_Unicode *ua = a, *ub = b;
+
+	if (*ua < *ub)
+		return -1;
+	return *ua > *ub;
+}
+
+static unsigned int _gsm_septets(Eina_Unicode c)
+{
+	if (c < 128)
+		return _gsm_ascii[c];
+	if (c == GSM_EURO)
+		return 2;
+	if (c > _gsm_other[EINA_C_ARRAY_LENGTH(_gsm_other) - 1])
+		return 0;
+	if (bsearch(&c, _gsm_other, EINA_C_ARRAY_LENGTH(_gsm_other),
+			sizeof(Eina_Unicode), _unicode_cmp))
+		return 1;
+	return 0;
+}
+
+static void _part_add(unsigned int *parts, unsigned int *fill,
+			unsigned int part_size, unsigned int size)
+{
+	if ((*parts == 0) || (*fill + size > part_size)) {
+		(*parts)++;
+		*fill = size;
+	} else
+		*fill += size;
+}
+
+void sms_segments_reset(SMS_Segments *s)
+{
+	EINA_SAFETY_ON_NULL_RETURN(s);
+	memset(s, 0, sizeof(SMS_Segments));
+}
+
+void sms_segments_char_add(SMS_Segments *s, Eina_Unicode c)
+{
+	unsigned int septets, units;
+
+	EINA_SAFETY_ON_NULL_RETURN(s);
+
+	septets = _gsm_septets(c);
+	if (septets) {
+		s->septets += septets;
+		_part_add(&s->septet_parts, &s->septet_fill, SEPTETS_PART,
+				septets);
+	} else {
+		if (!s->ucs2_chars) {
+			s->ucs2_first = c;
+			s->ucs2_first_pos = s->chars;
+		}
+		s->ucs2_chars++;
+	}
+
+	units = (c > 0xffff) ? 2 : 1;
+	s->units += units;
+	_part_add(&s->unit_parts, &s->unit_fill, UNITS_PART, units);
+
+	s->chars++;
+}
+
+/* 0 if the sequence is incomplete */
+static size_t _utf8_get(const char *str, size_t len, Eina_Unicode *c)
+{
+	const unsigned char *p = (const unsigned char *)str;
+	size_t n, i;
+
+	if (p[0] < 0x80) {
+		*c = p[0];
+		return 1;
+	} else if ((p[0] & 0xe0) == 0xc0) {
+		n = 2;
+		*c = p[0] & 0x1f;
+	} else if ((p[0] & 0xf0) == 0xe0) {
+		n = 3;
+		*c = p[0] & 0x0f;
+	} else if ((p[0] & 0xf8) == 0xf0) {
+		n = 4;
+		*c = p[0] & 0x07;
+	} else {
+		*c = 0xfffd;
+		return 1;
+	}
+
+	for (i = 1; i < n; i++) {
+		if (i == len)
+			return 0;
+		if ((p[i] & 0xc0) != 0x80) {
+			*c = 0xfffd;
+			return i;
+		}
+		*c = (*c << 6) | (p[i] & 0x3f);
+	}
+
+	return n;
+}
+
+size_t sms_segments_utf8_append(SMS_Segments *s, const char *str, size_t len)
+{
+	size_t i = 0, n;
+	Eina_Unicode c;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(s, 0);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(str, 0);
+
+	while ((i < len) && (str[i] != '\0')) {
+		n = _utf8_get(str + i, len - i, &c);
+		if (!n)
+			break;
+		sms_segments_char_add(s, c);
+		i += n;
+	}
+
+	return i;
+}
+
+static Eina_Bool _tag_is(const char *tag, size_t len, const char *name)
+{
+	size_t n = strlen(name);
+
+	if ((len > n) && (tag[len - 1] == '/'))
+		len--;
+	return (len == n) && (memcmp(tag, name, n) == 0);
+}
+
+/* same as evas does for elm_entry_markup_to_utf8() */
+static void _markup_tag_add(SMS_Segments *s, const char *tag, size_t len)
+{
+	while ((len > 0) && (*tag == ' ')) {
+		tag++;
+		len--;
+	}
+	while ((len > 0) && (tag[len - 1] == ' '))
+		len--;
+
+	if (_tag_is(tag, len, "br"))
+		sms_segments_char_add(s, '\n');
+	else if (_tag_is(tag, len, "ps"))
+		sms_segments_char_add(s, 0x2029);
+	else if (_tag_is(tag, len, "tab"))
+		sms_segments_char_add(s, '\t');
+}
+
+static Eina_Bool _markup_entity_add(SMS_Segments *s, const char *ent,
+					size_t len)
+{
+	static const struct {
+		const char *name;
+		Eina_Unicode c;
+	} entities[] = {
+		{ "amp", '&' },
+		{ "lt", '<' },
+		{ "gt", '>' },
+		{ "quot", '"' },
+		{ "apos", '\'' },
+		{ "nbsp", 0x00a0 }
+	};
+	unsigned int i;
+
+	if ((len > 1) && (ent[0] == '#')) {
+		char buf[ENTITY_MAX + 1], *end;
+		unsigned long c;
+
+		memcpy(buf, ent + 1, len - 1);
+		buf[len - 1] = '\0';
+		if ((buf[0] == 'x') || (buf[0] == 'X'))
+			c = strtoul(buf + 1, &end, 16);
+		else
+			c = strtoul(buf, &end, 10);
+		if ((*end != '\0') || (c > 0x10ffff))
+			return EINA_FALSE;
+		sms_segments_char_add(s, c);
+		return EINA_TRUE;
+	}
+
+	for (i = 0; i < EINA_C_ARRAY_LENGTH(entities); i++) {
+		if ((strlen(entities[i].name) == len) &&
+			(memcmp(entities[i].name, ent, len) == 0)) {
+			sms_segments_char_add(s, entities[i].c);
+			return EINA_TRUE;
+		}
+	}
+
+	return EINA_FALSE;
+}
+
+size_t sms_segments_markup_append(SMS_Segments *s, const char *markup,
+					size_t len)
+{
+	size_t i = 0, n;
+	const char *end;
+	Eina_Unicode c;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(s, 0);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(markup, 0);
+
+	while ((i < len) && (markup[i] != '\0')) {
+		if (markup[i] == '<') {
+			end = memchr(markup + i, '>', len - i);
+			if (!end)
+				break;
+			n = end - (markup + i) + 1;
+			_markup_tag_add(s, markup + i + 1, n - 2);
+			i += n;
+			continue;
+		}
+
+		if (markup[i] == '&') {
+			n = len - i;
+			if (n > ENTITY_MAX + 2)
+				n = ENTITY_MAX + 2;
+			end = memchr(markup + i, ';', n);
+			if (!end && (n < ENTITY_MAX + 2))
+				break;
+			if (end) {
+				n = end - (markup + i) + 1;
+				if (_markup_entity_add(s, markup + i + 1,
+							n - 2)) {
+					i += n;
+					continue;
+				}
+			}
+			/* not an entity, it is an ampersand */
+		}
+
+		n = _utf8_get(markup + i, len - i, &c);
+		if (!n)
+			break;
+		sms_segments_char_add(s, c);
+		i += n;
+	}
+
+	return i;
+}
+
+Eina_Bool sms_segments_ucs2_get(const SMS_Segments *s)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(s, EINA_FALSE);
+	return s->ucs2_chars > 0;
+}
+
+unsigned int sms_segments_size_get(const SMS_Segments *s)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(s, 0);
+
+	if (s->ucs2_chars)
+		return s->units;
+	return s->septets;
+}
+
+unsigned int sms_segments_count_get(const SMS_Segments *s)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(s, 0);
+
+	if (s->ucs2_chars) {
+		if (s->units <= UNITS_SINGLE)
+			return 1;
+		return s->unit_parts;
+	}
+
+	if (s->septets <= SEPTETS_SINGLE)
+		return 1;
+	return s->septet_parts;
+}
+
+unsigned int sms_segments_max_get(const SMS_Segments *s)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(s, 0);
+
+	if (s->ucs2_chars) {
+		if (s->units <= UNITS_SINGLE)
+			return UNITS_SINGLE;
+		return s->unit_parts * UNITS_PART;
+	}
+
+	if (s->septets <= SEPTETS_SINGLE)
+		return SEPTETS_SINGLE;
+	return s->septet_parts * SEPTETS_PART;
+}
@@ -0,0 +1,50 @@
+#ifndef _EFL_OFONO_SEGMENT_H__
+#define _EFL_OFONO_SEGMENT_H__ 1
+
+/*
+ * Size of a SMS as it will be sent: in septets of the GSM 7-bit default
+ * alphabet (characters of its extension table take two), or in UCS-2
+ * units if any character is not in the alphabet. Long messages are
+ * split in segments that lose room to the concatenation header and
+ * never split an escape or a surrogate pair.
+ *
+ * Text is added as it is typed, nothing is allocated.
+ */
+
+typedef struct _SMS_Segments {
+	unsigned int chars;
+	unsigned int septets; /* GSM 7-bit, escapes included */
+	unsigned int septet_parts; /* if split */
+	unsigned int septet_fill; /* of the last part */
+	unsigned int units; /* UCS-2 */
+	unsigned int unit_parts;
+	unsigned int unit_fill;
+	unsigned int ucs2_chars; /* not in the GSM 7-bit alphabet */
+	Eina_Unicode ucs2_first;
+	unsigned int ucs2_first_pos; /* in chars */
+} SMS_Segments;
+
+void sms_segments_reset(SMS_Segments *s);
+
+void sms_segments_char_add(SMS_Segments *s, Eina_Unicode c);
+
+/* both return the bytes used, an incomplete sequence at the end is left
+ * for the next call.
+ */
+size_t sms_segments_utf8_append(SMS_Segments *s, const char *str, size_t len);
+
+/* counts text of an entry as elm_entry_markup_to_utf8() would return it */
+size_t sms_segments_markup_append(SMS_Segments *s, const char *markup,
+					size_t len);
+
+Eina_Bool sms_segments_ucs2_get(const SMS_Segments *s);
+
+/* septets or UCS-2 units */
+unsigned int sms_segments_size_get(const SMS_Segments *s);
+
+/* size that fits in the segments needed */
+unsigned int sms_segments_max_get(const SMS_Segments *s);
+
+unsigned int sms_segments_count_get(const SMS_Segments *s);
+
+#endif
@@ -0,0 +1,1728 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <Eet.h>
+#include <Ecore.h>
+#include <Ecore_File.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "search.h"
+#include "store.h"
+
+#define STORE_FILE "messages.store"
+#define STORE_INDEX_FILE "messages.index"
+#define STORE_MAGIC "OEMSTO1"
+#define STORE_STATES 256
+#define STORE_COMPACT_MIN 65536
+#define STORE_EET_ENTRY "all_messages"
+
+typedef enum {
+	STORE_RECORD_MESSAGE = 1,
+	STORE_RECORD_STATE,
+	STORE_RECORD_DEL,
+	STORE_RECORD_THREAD,
+	STORE_RECORD_THREAD_DEL,
+	STORE_RECORD_COMMIT
+} Store_Record_Type;
+
+typedef struct _Store_Record {
+	uint32_t size; /* header and content */
+	uint32_t checksum;
+	uint8_t type;
+	uint8_t outgoing;
+	uint8_t state;
+	uint8_t pad;
+	uint32_t thread;
+	/* MESSAGE, STATE and DEL: id of the message. COMMIT: the next
+	 * free id.
+	 */
+	uint64_t id;
+	int64_t time; /* STATE and DEL: time of the message */
+} Store_Record;
+
+typedef struct _Store_Message {
+	uint32_t offset; /* of the MESSAGE record */
+	uint32_t size;
+	uint32_t hash; /* of the content */
+	unsigned char outgoing;
+	unsigned char state;
+	uint64_t id;
+	long long time;
+} Store_Message;
+
+typedef struct _Store_Thread {
+	uint32_t id;
+	uint32_t size; /* of the THREAD record */
+	const char *phone;
+	Eina_Inarray *msgs; /* Store_Message, by time */
+} Store_Thread;
+
+typedef struct _Store_State_Ref {
+	uint32_t offset; /* of the MESSAGE record */
+	Store_Thread *thread;
+} Store_State_Ref;
+
+struct _Message_Store {
+	char *dir;
+	char *path;
+	char *index_path;
+	int fd;
+	uint32_t size; /* committed bytes */
+	uint32_t dead; /* bytes of superseded records */
+	uint32_t next_thread;
+	uint64_t next_id; /* of messages */
+	Eina_Hash *threads; /* phone -> Store_Thread */
+	Eina_Inarray *states[STORE_STATES]; /* Store_State_Ref, by offset */
+	Eina_Binbuf *pending; /* records of the open transaction */
+	int transaction;
+	Eina_Bool failed;
+	Eina_File *file;
+	const char *map;
+	size_t map_size;
+	Ecore_Idler *compact_idler;
+	struct _Store_Compact *compact; /* running */
+	Ecore_Idler *index_idler;
+	Message_Index *index;
+	Eina_Bool indexing; /* changes go to the index */
+	Eet_Data_Descriptor *edd_msg;
+	Eet_Data_Descriptor *edd_list;
+};
+
+/* layout of the old <phone>.eet conversation files */
+typedef struct _Store_Eet_Message {
+	const char *content;
+	unsigned char outgoing;
+	unsigned char state;
+	long long time;
+} Store_Eet_Message;
+
+typedef struct _Store_Eet_List {
+	Eina_List *list;
+} Store_Eet_List;
+
+/* what a compaction writes, taken from the indexes before it starts */
+typedef struct _Store_Compact_Item {
+	Store_Record r;
+	uint32_t offset; /* MESSAGE: of the record in the old file */
+	const char *phone; /* THREAD */
+} Store_Compact_Item;
+
+typedef struct _Store_Compact {
+	Message_Store *store; /* NULL once the store is freed */
+	Ecore_Thread *thread;
+	char *tmp;
+	int fd; /* of the old file, read by the thread */
+	uint32_t size; /* committed bytes when it started */
+	uint64_t next_id;
+	Eina_Inarray *items; /* Store_Compact_Item */
+	Eina_Bool ok;
+} Store_Compact;
+
+typedef struct _Store_Search {
+	Message_Store *store;
+	Message_Store_State_Cb cb;
+	const void *data;
+} Store_Search;
+
+/* FNV-1a, the checksum field at offset 4 counts as zero */
+static uint32_t _checksum(const void *hdr, size_t hdr_size,
+				const char *content, size_t len)
+{
+	const unsigned char *p = hdr;
+	uint32_t h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < hdr_size; i++)
+		h = (h ^ ((i >= 4 && i < 8) ? 0 : p[i])) * 16777619U;
+
+	p = (const unsigned char *)content;
+	for (i = 0; i < len; i++)
+		h = (h ^ p[i]) * 16777619U;
+
+	return h;
+}
+
+static uint32_t _content_hash(const char *content)
+{
+	return _checksum(NULL, 0, content, strlen(content));
+}
+
+static void _record_init(Store_Record *r, Store_Record_Type type,
+				uint32_t thread, uint64_t id, long long time,
+				Eina_Bool outgoing, unsigned char state)
+{
+	memset(r, 0, sizeof(*r));
+	r->type = type;
+	r->thread = thread;
+	r->id = id;
+	r->time = time;
+	r->outgoing = !!outgoing;
+	r->state = state;
+}
+
+static void _record_seal(Store_Record *r, const char *content, size_t len)
+{
+	r->size = sizeof(*r) + len;
+	r->checksum = _checksum(r, sizeof(*r), content, len);
+}
+
+static Eina_Bool _record_valid(const void *hdr, size_t hdr_size,
+				uint32_t rsize, uint32_t checksum,
+				Eina_Bool has_string, const char *map,
+				size_t off, size_t size)
+{
+	const char *content = map + off + hdr_size;
+	size_t len;
+
+	if (rsize < hdr_size || rsize > size - off)
+		return EINA_FALSE;
+
+	len = rsize - hdr_size;
+	if (has_string && (len == 0 || content[len - 1] != '\0'))
+		return EINA_FALSE;
+
+	return checksum == _checksum(hdr, hdr_size, content, len);
+}
+
+static void _store_unmap(Message_Store *store)
+{
+	if (!store->file)
+		return;
+	if (store->map)
+		eina_file_map_free(store->file, (void *)store->map);
+	eina_file_close(store->file);
+	store->file = NULL;
+	store->map = NULL;
+	store->map_size = 0;
+}
+
+static Eina_Bool _store_map(Message_Store *store)
+{
+	if (store->map && store->map_size == store->size)
+		return EINA_TRUE;
+
+	_store_unmap(store);
+
+	store->file = eina_file_open(store->path, EINA_FALSE);
+	if (!store->file)
+		goto err;
+	if (eina_file_size_get(store->file) < store->size)
+		goto err;
+
+	store->map = eina_file_map_all(store->file, EINA_FILE_RANDOM);
+	if (!store->map)
+		goto err;
+
+	store->map_size = store->size;
+	return EINA_TRUE;
+
+err:
+	ERR("could not map %s", store->path);
+	_store_unmap(store);
+	return EINA_FALSE;
+}
+
+/* committed or in the open transaction */
+static const char *_store_record_get(Message_Store *store, uint32_t offset)
+{
+	size_t pos;
+
+	if (offset < store->size) {
+		if (!_store_map(store))
+			return NULL;
+		return store->map + offset;
+	}
+
+	pos = offset - store->size;
+	if (pos >= eina_binbuf_length_get(store->pending))
+		return NULL;
+	return (const char *)eina_binbuf_string_get(store->pending) + pos;
+}
+
+static const char *_store_content_get(Message_Store *store, uint32_t offset)
+{
+	const char *rec = _store_record_get(store, offset);
+
+	if (!rec)
+		return NULL;
+	return rec + sizeof(Store_Record);
+}
+
+/* returns the offset of the record or 0 */
+static uint32_t _store_record_add(Message_Store *store, Store_Record *r,
+					const char *content)
+{
+	size_t len = content ? strlen(content) + 1 : 0;
+	size_t offset = store->size + eina_binbuf_length_get(store->pending);
+
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(store->transaction <= 0, 0);
+
+	if (offset + sizeof(*r) + len > UINT32_MAX) {
+		ERR("%s is full", store->path);
+		goto err;
+	}
+
+	_record_seal(r, content, len);
+	if (!eina_binbuf_append_length(store->pending,
+					(const unsigned char *)r, sizeof(*r)))
+		goto err;
+	if (len && !eina_binbuf_append_length(store->pending,
+					(const unsigned char *)content, len))
+		goto err;
+
+	return offset;
+
+err:
+	store->failed = EINA_TRUE;
+	return 0;
+}
+
+static unsigned int _state_ref_position(const Eina_Inarray *refs,
+					uint32_t offset)
+{
+	unsigned int lo = 0, hi = eina_inarray_count(refs);
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		const Store_State_Ref *ref = eina_inarray_nth(refs, mid);
+		if (ref->offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static void _state_ref_add(Message_Store *store, Store_Thread *t,
+				const Store_Message *m)
+{
+	Eina_Inarray **refs = store->states + m->state;
+	Store_State_Ref ref;
+
+	if (!*refs) {
+		*refs = eina_inarray_new(sizeof(Store_State_Ref), 0);
+		EINA_SAFETY_ON_NULL_RETURN(*refs);
+	}
+
+	ref.offset = m->offset;
+	ref.thread = t;
+	eina_inarray_insert_at(*refs, _state_ref_position(*refs, m->offset),
+				&ref);
+}
+
+static void _state_ref_del(Message_Store *store, const Store_Message *m)
+{
+	Eina_Inarray *refs = store->states[m->state];
+	const Store_State_Ref *ref;
+	unsigned int i;
+
+	if (!refs)
+		return;
+
+	i = _state_ref_position(refs, m->offset);
+	if (i == eina_inarray_count(refs))
+		return;
+
+	ref = eina_inarray_nth(refs, i);
+	if (ref->offset == m->offset)
+		eina_inarray_remove_at(refs, i);
+}
+
+/* first message at or after (or only after, if after) time */
+static unsigned int _thread_time_position(const Store_Thread *t,
+						long long time, Eina_Bool after)
+{
+	unsigned int lo = 0, hi = eina_inarray_count(t->msgs);
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		const Store_Message *m = eina_inarray_nth(t->msgs, mid);
+		if (m->time < time || (after && m->time == time))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int _thread_message_find(const Store_Thread *t, long long time,
+				uint64_t id)
+{
+	unsigned int i = _thread_time_position(t, time, EINA_FALSE);
+
+	for (; i < eina_inarray_count(t->msgs); i++) {
+		const Store_Message *m = eina_inarray_nth(t->msgs, i);
+		if (m->time != time)
+			break;
+		if (m->id == id)
+			return i;
+	}
+
+	return -1;
+}
+
+static void _thread_message_insert(Message_Store *store, Store_Thread *t,
+					const Store_Message *m)
+{
+	unsigned int pos = _thread_time_position(t, m->time, EINA_TRUE);
+
+	eina_inarray_insert_at(t->msgs, pos, m);
+	_state_ref_add(store, t, m);
+}
+
+static void _store_index_del(Message_Store *store, const Store_Message *m)
+{
+	const char *content;
+
+	if (!store->indexing)
+		return;
+
+	content = _store_content_get(store, m->offset);
+	if (content)
+		message_index_del(store->index, m->id, content);
+}
+
+static void _thread_message_remove_at(Message_Store *store, Store_Thread *t,
+					unsigned int i)
+{
+	Store_Message *m = eina_inarray_nth(t->msgs, i);
+
+	_store_index_del(store, m);
+	store->dead += m->size;
+	_state_ref_del(store, m);
+	eina_inarray_remove_at(t->msgs, i);
+}
+
+static void _thread_message_state_set(Message_Store *store, Store_Thread *t,
+					Store_Message *m, unsigned char state)
+{
+	_state_ref_del(store, m);
+	m->state = state;
+	_state_ref_add(store, t, m);
+}
+
+static void _store_thread_free(void *data)
+{
+	Store_Thread *t = data;
+
+	eina_inarray_free(t->msgs);
+	eina_stringshare_del(t->phone);
+	free(t);
+}
+
+static Store_Thread *_store_thread_new(Message_Store *store, uint32_t id,
+					const char *phone, uint32_t size)
+{
+	Store_Thread *t;
+
+	t = calloc(1, sizeof(Store_Thread));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(t, NULL);
+
+	t->msgs = eina_inarray_new(sizeof(Store_Message), 0);
+	EINA_SAFETY_ON_NULL_GOTO(t->msgs, err);
+
+	t->id = id;
+	t->size = size;
+	t->phone = eina_stringshare_add(phone);
+	eina_hash_add(store->threads, phone, t);
+
+	if (id >= store->next_thread)
+		store->next_thread = id + 1;
+	return t;
+
+err:
+	free(t);
+	return NULL;
+}
+
+static void _store_thread_remove(Message_Store *store, Store_Thread *t)
+{
+	Store_Message *m;
+
+	EINA_INARRAY_FOREACH(t->msgs, m) {
+		_store_index_del(store, m);
+		store->dead += m->size;
+		_state_ref_del(store, m);
+	}
+
+	store->dead += t->size;
+	eina_hash_del_by_key(store->threads, t->phone);
+}
+
+static Store_Thread *_store_thread_get(Message_Store *store,
+					const char *phone)
+{
+	Store_Thread *t;
+	Store_Record r;
+
+	t = eina_hash_find(store->threads, phone);
+	if (t)
+		return t;
+
+	_record_init(&r, STORE_RECORD_THREAD, store->next_thread, 0, 0,
+			EINA_FALSE, 0);
+	if (!_store_record_add(store, &r, phone))
+		return NULL;
+
+	return _store_thread_new(store, r.thread, phone, r.size);
+}
+
+static Eina_Bool _store_message_add(Message_Store *store, Store_Thread *t,
+					uint64_t id, long long time,
+					const char *content,
+					Eina_Bool outgoing, unsigned char state)
+{
+	Store_Message m;
+	Store_Record r;
+
+	_record_init(&r, STORE_RECORD_MESSAGE, t->id, id, time, outgoing,
+			state);
+	m.offset = _store_record_add(store, &r, content);
+	if (!m.offset)
+		return EINA_FALSE;
+
+	m.size = r.size;
+	m.hash = _content_hash(content);
+	m.outgoing = r.outgoing;
+	m.state = state;
+	m.id = id;
+	m.time = time;
+	_thread_message_insert(store, t, &m);
+	if (store->indexing)
+		message_index_add(store->index, t->phone, m.id, time, content);
+	return EINA_TRUE;
+}
+
+static void _store_record_apply(Message_Store *store, Eina_Hash *ids,
+				const Store_Record *r, uint32_t off,
+				const char *content)
+{
+	Store_Thread *t = eina_hash_find(ids, &r->thread);
+	Store_Message m;
+	int idx;
+
+	switch (r->type) {
+	case STORE_RECORD_THREAD:
+		if (t || eina_hash_find(store->threads, content)) {
+			WRN("%s: thread %u (%s) defined twice", store->path,
+				r->thread, content);
+			break;
+		}
+		t = _store_thread_new(store, r->thread, content, r->size);
+		if (t)
+			eina_hash_add(ids, &t->id, t);
+		return;
+	case STORE_RECORD_THREAD_DEL:
+		if (!t)
+			break;
+		eina_hash_del_by_key(ids, &t->id);
+		_store_thread_remove(store, t);
+		break;
+	case STORE_RECORD_MESSAGE:
+		if (!t)
+			break;
+		m.offset = off;
+		m.size = r->size;
+		m.hash = _content_hash(content);
+		m.outgoing = r->outgoing;
+		m.state = r->state;
+		m.id = r->id;
+		m.time = r->time;
+		if (m.id >= store->next_id)
+			store->next_id = m.id + 1;
+		_thread_message_insert(store, t, &m);
+		if (store->indexing)
+			message_index_add(store->index, t->phone, m.id, m.time,
+						content);
+		return;
+	case STORE_RECORD_STATE:
+		if (!t)
+			break;
+		idx = _thread_message_find(t, r->time, r->id);
+		if (idx >= 0)
+			_thread_message_state_set(store, t,
+						eina_inarray_nth(t->msgs, idx),
+						r->state);
+		break;
+	case STORE_RECORD_DEL:
+		if (!t)
+			break;
+		idx = _thread_message_find(t, r->time, r->id);
+		if (idx >= 0)
+			_thread_message_remove_at(store, t, idx);
+		break;
+	case STORE_RECORD_COMMIT:
+		if (r->id > store->next_id)
+			store->next_id = r->id;
+		break;
+	default:
+		WRN("%s: unknown record type %hhu", store->path, r->type);
+	}
+
+	store->dead += r->size;
+}
+
+static void _store_reset(Message_Store *store)
+{
+	unsigned int i;
+
+	_store_unmap(store);
+	if (store->threads)
+		eina_hash_free(store->threads);
+	store->threads = eina_hash_string_superfast_new(_store_thread_free);
+
+	for (i = 0; i < STORE_STATES; i++) {
+		if (!store->states[i])
+			continue;
+		eina_inarray_free(store->states[i]);
+		store->states[i] = NULL;
+	}
+
+	store->size = 0;
+	store->dead = 0;
+	store->next_thread = 1;
+	/* ids handed out before a reload may still be saved */
+	if (!store->next_id)
+		store->next_id = 1;
+}
+
+static Eina_Bool _store_file_init(Message_Store *store)
+{
+	if (ftruncate(store->fd, 0) < 0 ||
+		pwrite(store->fd, STORE_MAGIC, sizeof(STORE_MAGIC), 0) !=
+		sizeof(STORE_MAGIC)) {
+		ERR("could not write to %s: %s", store->path, strerror(errno));
+		return EINA_FALSE;
+	}
+
+	store->size = sizeof(STORE_MAGIC);
+	return EINA_TRUE;
+}
+
+/* changes whenever the store file does, to tell if the index matches it */
+static unsigned long long _store_signature(const Message_Store *store)
+{
+	struct stat st;
+
+	if (fstat(store->fd, &st) < 0)
+		return 0;
+
+	return ((unsigned long long)st.st_size << 32) ^
+		(unsigned long long)st.st_mtime ^
+		((unsigned long long)st.st_ino << 48);
+}
+
+/* builds the indexes from what was committed, the search index is left
+ * alone if keep_index
+ */
+static Eina_Bool _store_load(Message_Store *store, Eina_Bool keep_index)
+{
+	char broken[PATH_MAX];
+	Store_Record r;
+	Eina_Hash *ids;
+	struct stat st;
+	size_t size, off, end;
+	int fd;
+
+	_store_reset(store);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store->threads, EINA_FALSE);
+	if (!keep_index)
+		message_index_clear(store->index);
+
+	if (fstat(store->fd, &st) < 0)
+		return EINA_FALSE;
+	if (st.st_size == 0)
+		return _store_file_init(store);
+
+	store->size = st.st_size;
+	if ((size_t)st.st_size > UINT32_MAX || !_store_map(store) ||
+		memcmp(store->map, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0) {
+		ERR("%s is not a message store, starting a new one",
+			store->path);
+		_store_unmap(store);
+		store->size = 0;
+		/* the old file stays aside, the new one is a fresh inode */
+		snprintf(broken, sizeof(broken), "%s.broken", store->path);
+		if (rename(store->path, broken) < 0) {
+			WRN("could not keep a copy as %s: %s", broken,
+				strerror(errno));
+			return _store_file_init(store);
+		}
+		fd = open(store->path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0) {
+			ERR("could not open %s: %s", store->path,
+				strerror(errno));
+			return EINA_FALSE;
+		}
+		close(store->fd);
+		store->fd = fd;
+		return _store_file_init(store);
+	}
+	size = store->size;
+
+	/* the committed part ends with the last commit record */
+	end = off = sizeof(STORE_MAGIC);
+	while (off + sizeof(r) <= size) {
+		memcpy(&r, store->map + off, sizeof(r));
+		if (!_record_valid(&r, sizeof(r), r.size, r.checksum,
+					r.type == STORE_RECORD_MESSAGE ||
+					r.type == STORE_RECORD_THREAD,
+					store->map, off, size))
+			break;
+		off += r.size;
+		if (r.type == STORE_RECORD_COMMIT)
+			end = off;
+	}
+
+	ids = eina_hash_int32_new(NULL);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(ids, EINA_FALSE);
+
+	store->indexing = !keep_index;
+	for (off = sizeof(STORE_MAGIC); off < end; off += r.size) {
+		memcpy(&r, store->map + off, sizeof(r));
+		_store_record_apply(store, ids, &r, off,
+					store->map + off + sizeof(r));
+	}
+	store->indexing = EINA_TRUE;
+
+	eina_hash_free(ids);
+
+	if (end != size) {
+		WRN("%s: discarding %zu bytes of an unfinished transaction",
+			store->path, size - end);
+		_store_unmap(store);
+		if (ftruncate(store->fd, end) < 0)
+			ERR("could not truncate %s: %s", store->path,
+				strerror(errno));
+	}
+
+	store->size = end;
+	DBG("%s: %u bytes, %u superseded, %d conversations", store->path,
+		store->size, store->dead, eina_hash_population(store->threads));
+	return EINA_TRUE;
+}
+
+static Eina_Bool _store_compact_idler(void *data);
+
+static void _store_compact_check(Message_Store *store)
+{
+	if ((store->compact_idler) || (store->compact))
+		return;
+	if (store->dead < STORE_COMPACT_MIN || store->dead < store->size / 2)
+		return;
+
+	store->compact_idler = ecore_idler_add(_store_compact_idler, store);
+}
+
+static Eina_Bool _store_index_idler(void *data)
+{
+	Message_Store *store = data;
+
+	if (store->transaction > 0)
+		return ECORE_CALLBACK_RENEW;
+
+	store->index_idler = NULL;
+	message_index_save(store->index, store->index_path,
+				_store_signature(store));
+	return ECORE_CALLBACK_CANCEL;
+}
+
+/* the index matches the store file only until its next change */
+static void _store_index_save(Message_Store *store)
+{
+	if (!store->index_idler)
+		store->index_idler = ecore_idler_add(_store_index_idler, store);
+}
+
+static Eina_Bool _store_commit(Message_Store *store)
+{
+	Store_Record r;
+	size_t len;
+
+	if (!store->failed && eina_binbuf_length_get(store->pending) == 0)
+		return EINA_TRUE;
+
+	_record_init(&r, STORE_RECORD_COMMIT, 0, store->next_id, 0,
+			EINA_FALSE, 0);
+	if ((store->failed) || (!_store_record_add(store, &r, NULL)))
+		goto rollback;
+
+	len = eina_binbuf_length_get(store->pending);
+	if (pwrite(store->fd, eina_binbuf_string_get(store->pending), len,
+			store->size) != (ssize_t)len) {
+		ERR("could not write to %s: %s", store->path, strerror(errno));
+		goto rollback;
+	}
+
+	store->size += len;
+	store->dead += r.size;
+	eina_binbuf_reset(store->pending);
+	_store_index_save(store);
+	_store_compact_check(store);
+	return EINA_TRUE;
+
+rollback:
+	ERR("transaction on %s failed, rolling back", store->path);
+	eina_binbuf_reset(store->pending);
+	store->failed = EINA_FALSE;
+	_store_load(store, EINA_FALSE);
+	return EINA_FALSE;
+}
+
+void message_store_begin(Message_Store *store)
+{
+	EINA_SAFETY_ON_NULL_RETURN(store);
+	store->transaction++;
+}
+
+Eina_Bool message_store_commit(Message_Store *store)
+{
+	Eina_Bool ret;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(store->transaction <= 0, EINA_FALSE);
+
+	if (store->transaction > 1) {
+		store->transaction--;
+		return !store->failed;
+	}
+
+	ret = _store_commit(store);
+	store->transaction = 0;
+	return ret;
+}
+
+static Eina_Bool _record_write(FILE *fp, Store_Record *r, const char *content)
+{
+	size_t len = content ? strlen(content) + 1 : 0;
+
+	_record_seal(r, content, len);
+	if (fwrite(r, sizeof(*r), 1, fp) != 1)
+		return EINA_FALSE;
+	if (len && fwrite(content, len, 1, fp) != 1)
+		return EINA_FALSE;
+	return EINA_TRUE;
+}
+
+static void _store_compact_free(Store_Compact *ctx)
+{
+	Store_Compact_Item *item;
+
+	if (ctx->items) {
+		EINA_INARRAY_FOREACH(ctx->items, item)
+			eina_stringshare_del(item->phone);
+		eina_inarray_free(ctx->items);
+	}
+	if (ctx->fd >= 0)
+		close(ctx->fd);
+	free(ctx->tmp);
+	free(ctx);
+}
+
+static Eina_Bool _store_compact_item_add(Store_Compact *ctx,
+						const Store_Record *r,
+						uint32_t offset,
+						const char *phone)
+{
+	Store_Compact_Item item;
+
+	item.r = *r;
+	item.offset = offset;
+	item.phone = eina_stringshare_ref(phone);
+	if (eina_inarray_push(ctx->items, &item) >= 0)
+		return EINA_TRUE;
+
+	eina_stringshare_del(item.phone);
+	ctx->ok = EINA_FALSE;
+	return EINA_FALSE;
+}
+
+/* thread ids are kept, so the records committed while the thread runs
+ * still apply once appended to the new file
+ */
+static Eina_Bool _store_compact_snapshot(const Eina_Hash *hash __UNUSED__,
+						const void *key __UNUSED__,
+						void *data, void *fdata)
+{
+	Store_Compact *ctx = fdata;
+	Store_Thread *t = data;
+	Store_Message *m;
+	Store_Record r;
+
+	_record_init(&r, STORE_RECORD_THREAD, t->id, 0, 0, EINA_FALSE, 0);
+	if (!_store_compact_item_add(ctx, &r, 0, t->phone))
+		return EINA_FALSE;
+
+	EINA_INARRAY_FOREACH(t->msgs, m) {
+		_record_init(&r, STORE_RECORD_MESSAGE, t->id, m->id, m->time,
+				m->outgoing, m->state);
+		if (!_store_compact_item_add(ctx, &r, m->offset, NULL))
+			return EINA_FALSE;
+	}
+
+	return EINA_TRUE;
+}
+
+/* in the thread: writes the live records to ctx->tmp, on disk once done */
+static void _store_compact_run(void *data, Ecore_Thread *thread)
+{
+	Store_Compact *ctx = data;
+	Store_Compact_Item *item;
+	Store_Record r, old;
+	char *content = NULL, *tmp;
+	size_t len, content_size = 0;
+	FILE *fp;
+
+	ctx->ok = EINA_FALSE;
+	fp = fopen(ctx->tmp, "wb");
+	if (!fp) {
+		ERR("could not open %s: %s", ctx->tmp, strerror(errno));
+		return;
+	}
+
+	if (fwrite(STORE_MAGIC, sizeof(STORE_MAGIC), 1, fp) != 1)
+		goto end;
+
+	EINA_INARRAY_FOREACH(ctx->items, item) {
+		if (ecore_thread_check(thread))
+			goto end;
+
+		if (item->r.type == STORE_RECORD_THREAD) {
+			if (!_record_write(fp, &item->r, item->phone))
+				goto end;
+			continue;
+		}
+
+		/* committed records do not change, they are read while the
+		 * store appends after them
+		 */
+		if ((pread(ctx->fd, &old, sizeof(old), item->offset) !=
+			sizeof(old)) || (old.size <= sizeof(old)))
+			goto end;
+		len = old.size - sizeof(old);
+		if (len > content_size) {
+			tmp = realloc(content, len);
+			if (!tmp)
+				goto end;
+			content = tmp;
+			content_size = len;
+		}
+		if ((pread(ctx->fd, content, len, item->offset + sizeof(old)) !=
+			(ssize_t)len) || (content[len - 1] != '\0'))
+			goto end;
+		if (!_record_write(fp, &item->r, content))
+			goto end;
+	}
+
+	_record_init(&r, STORE_RECORD_COMMIT, 0, ctx->next_id, 0,
+			EINA_FALSE, 0);
+	if (!_record_write(fp, &r, NULL))
+		goto end;
+
+	/* the new file replaces the only copy, it must be complete first */
+	if ((fflush(fp) == 0) && (fsync(fileno(fp)) == 0))
+		ctx->ok = EINA_TRUE;
+
+end:
+	if (fclose(fp) != 0)
+		ctx->ok = EINA_FALSE;
+	free(content);
+}
+
+static void _store_dir_sync(const Message_Store *store)
+{
+	int fd = open(store->dir, O_RDONLY | O_DIRECTORY);
+
+	if (fd < 0)
+		return;
+	if (fsync(fd) < 0)
+		WRN("could not sync %s: %s", store->dir, strerror(errno));
+	close(fd);
+}
+
+/* appends what was committed meanwhile and swaps the files */
+static void _store_compact_finish(Message_Store *store)
+{
+	Store_Compact *ctx = store->compact;
+	size_t tail;
+	int fd;
+
+	store->compact = NULL;
+	if (!ctx->ok)
+		goto err;
+
+	if (store->size < ctx->size)
+		goto err;
+	tail = store->size - ctx->size;
+
+	fd = open(ctx->tmp, O_WRONLY | O_APPEND);
+	if (fd < 0)
+		goto err;
+	/* synced as any commit is, the file is valid up to its last commit */
+	if ((tail > 0) && ((!_store_map(store)) ||
+			(write(fd, store->map + ctx->size, tail) !=
+				(ssize_t)tail))) {
+		close(fd);
+		goto err;
+	}
+	close(fd);
+
+	if (rename(ctx->tmp, store->path) < 0)
+		goto err;
+	_store_dir_sync(store);
+
+	/* offsets changed, start over from the new file */
+	fd = open(store->path, O_RDWR);
+	if (fd < 0) {
+		ERR("could not open %s: %s", store->path, strerror(errno));
+		_store_compact_free(ctx);
+		return;
+	}
+	close(store->fd);
+	store->fd = fd;
+	/* ids did not change, neither did the search index */
+	_store_load(store, EINA_TRUE);
+	_store_index_save(store);
+	DBG("%s: compacted to %u bytes", store->path, store->size);
+	_store_compact_free(ctx);
+	return;
+
+err:
+	ERR("could not compact %s", store->path);
+	unlink(ctx->tmp);
+	_store_compact_free(ctx);
+}
+
+static void _store_compact_end(void *data, Ecore_Thread *thread __UNUSED__)
+{
+	Store_Compact *ctx = data;
+	Message_Store *store = ctx->store;
+
+	if (!store) {
+		unlink(ctx->tmp);
+		_store_compact_free(ctx);
+		return;
+	}
+
+	ctx->thread = NULL;
+	/* the open transaction was applied to the indexes of the old file */
+	if (store->transaction > 0) {
+		store->compact_idler = ecore_idler_add(_store_compact_idler,
+							store);
+		return;
+	}
+	_store_compact_finish(store);
+}
+
+static void _store_compact_cancel(void *data, Ecore_Thread *thread)
+{
+	Store_Compact *ctx = data;
+
+	ctx->ok = EINA_FALSE;
+	_store_compact_end(data, thread);
+}
+
+/* rewrites the store with only the live records, in a thread */
+static void _store_compact(Message_Store *store)
+{
+	Store_Compact *ctx;
+	Ecore_Thread *thread;
+
+	DBG("%s: %u of %u bytes are superseded", store->path, store->dead,
+		store->size);
+
+	ctx = calloc(1, sizeof(Store_Compact));
+	EINA_SAFETY_ON_NULL_RETURN(ctx);
+	ctx->store = store;
+	ctx->ok = EINA_TRUE;
+	ctx->size = store->size;
+	ctx->next_id = store->next_id;
+	ctx->fd = dup(store->fd);
+	ctx->items = eina_inarray_new(sizeof(Store_Compact_Item), 1024);
+	if ((ctx->fd < 0) || (!ctx->items) ||
+		(asprintf(&ctx->tmp, "%s.tmp", store->path) < 0)) {
+		ctx->tmp = NULL;
+		goto err;
+	}
+
+	eina_hash_foreach(store->threads, _store_compact_snapshot, ctx);
+	if (!ctx->ok)
+		goto err;
+
+	store->compact = ctx;
+	thread = ecore_thread_run(_store_compact_run, _store_compact_end,
+					_store_compact_cancel, ctx);
+	/* without threads it ran and ended already */
+	if (store->compact == ctx)
+		ctx->thread = thread;
+	return;
+
+err:
+	ERR("could not compact %s", store->path);
+	store->compact = NULL;
+	_store_compact_free(ctx);
+}
+
+static Eina_Bool _store_compact_idler(void *data)
+{
+	Message_Store *store = data;
+
+	if (store->transaction > 0)
+		return ECORE_CALLBACK_RENEW;
+
+	store->compact_idler = NULL;
+	if (store->compact)
+		_store_compact_finish(store);
+	else
+		_store_compact(store);
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _store_eet_path_get(const Message_Store *store, const char *phone,
+				char *path, size_t size, Eina_Bool bkp)
+{
+	snprintf(path, size, "%s/%s.eet%s", store->dir, phone,
+			bkp ? ".bkp" : "");
+}
+
+/* a message imported by an earlier, interrupted migration */
+static Eina_Bool _store_eet_imported(const Store_Thread *t,
+					const Store_Eet_Message *em)
+{
+	unsigned int i = _thread_time_position(t, em->time, EINA_FALSE);
+	uint32_t hash = _content_hash(em->content);
+
+	for (; i < eina_inarray_count(t->msgs); i++) {
+		const Store_Message *m = eina_inarray_nth(t->msgs, i);
+		if (m->time != em->time)
+			break;
+		if ((m->hash == hash) && (m->outgoing == !!em->outgoing))
+			return EINA_TRUE;
+	}
+
+	return EINA_FALSE;
+}
+
+/* returns the messages imported or -1 if no file could be read */
+static int _store_eet_import(Message_Store *store, const char *phone)
+{
+	Store_Eet_List *messages = NULL;
+	Store_Eet_Message *em;
+	Store_Thread *t;
+	char path[PATH_MAX];
+	Eet_File *efile;
+	int i, n = 0;
+
+	for (i = 0; i < 2 && !messages; i++) {
+		_store_eet_path_get(store, phone, path, sizeof(path), i);
+		efile = eet_open(path, EET_FILE_MODE_READ);
+		if (!efile)
+			continue;
+		messages = eet_data_read(efile, store->edd_list,
+						STORE_EET_ENTRY);
+		eet_close(efile);
+	}
+
+	if (!messages)
+		return -1;
+
+	t = _store_thread_get(store, phone);
+	EINA_LIST_FREE(messages->list, em) {
+		if (t && em->content && !_store_eet_imported(t, em) &&
+			_store_message_add(store, t, store->next_id++,
+						em->time, em->content,
+						em->outgoing, em->state))
+			n++;
+		eina_stringshare_del(em->content);
+		free(em);
+	}
+	free(messages);
+
+	return n;
+}
+
+static void _store_old_files_delete(const Message_Store *store,
+					const char *phone)
+{
+	char path[PATH_MAX];
+
+	_store_eet_path_get(store, phone, path, sizeof(path), EINA_FALSE);
+	ecore_file_unlink(path);
+	_store_eet_path_get(store, phone, path, sizeof(path), EINA_TRUE);
+	ecore_file_unlink(path);
+}
+
+/* unreadable files are kept for a look, out of the way of migrations */
+static void _store_old_files_keep(const Message_Store *store,
+					const char *phone)
+{
+	char path[PATH_MAX], broken[PATH_MAX];
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		_store_eet_path_get(store, phone, path, sizeof(path), i);
+		if (!ecore_file_exists(path))
+			continue;
+		snprintf(broken, sizeof(broken), "%s.broken", path);
+		if (rename(path, broken) < 0)
+			ERR("could not move %s aside: %s", path,
+				strerror(errno));
+	}
+}
+
+/* moves <phone>.eet conversations into the store, on every start until
+ * none is left
+ */
+static void _store_migrate(Message_Store *store)
+{
+	static const char *suffixes[] = { ".eet.bkp", ".eet", NULL };
+	Eina_List *files, *l, *l_next, *phones = NULL;
+	char *name, *phone;
+	unsigned int i;
+
+	files = ecore_file_ls(store->dir);
+	EINA_LIST_FREE(files, name) {
+		size_t len = strlen(name);
+
+		for (i = 0; suffixes[i]; i++) {
+			if (eina_str_has_suffix(name, suffixes[i]))
+				break;
+		}
+
+		if (suffixes[i]) {
+			len -= strlen(suffixes[i]);
+			name[len] = '\0';
+			/* messages.eet is the overview, not a conversation */
+			if ((len > 0) && (strcmp(name, "messages") != 0) &&
+				(!eina_list_search_unsorted(phones,
+						EINA_COMPARE_CB(strcmp), name))) {
+				phones = eina_list_append(phones, name);
+				continue;
+			}
+		}
+		free(name);
+	}
+
+	if (!phones)
+		return;
+
+	message_store_begin(store);
+	EINA_LIST_FOREACH_SAFE(phones, l, l_next, phone) {
+		int n = _store_eet_import(store, phone);
+		if (n >= 0) {
+			INF("moved %d messages of %s into %s", n, phone,
+				store->path);
+			continue;
+		}
+		ERR("could not read the messages of %s, moving its files "
+			"aside as .broken", phone);
+		_store_old_files_keep(store, phone);
+		phones = eina_list_remove_list(phones, l);
+		free(phone);
+	}
+
+	/* files are left for the next start unless the messages are on
+	 * disk, those imported already are not imported twice
+	 */
+	if ((message_store_commit(store)) && (fsync(store->fd) == 0)) {
+		EINA_LIST_FOREACH(phones, l, phone)
+			_store_old_files_delete(store, phone);
+	}
+
+	EINA_LIST_FREE(phones, phone)
+		free(phone);
+}
+
+static void _store_eet_descriptors_init(Message_Store *store)
+{
+	Eet_Data_Descriptor_Class eddc;
+
+	/* eet checks the names on read, these are the ones of the files
+	 * written before the store replaced them in overview.c
+	 */
+	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Store_Eet_Message);
+	eddc.name = "Message";
+	store->edd_msg = eet_data_descriptor_stream_new(&eddc);
+
+	EET_EINA_STREAM_DATA_DESCRIPTOR_CLASS_SET(&eddc, Store_Eet_List);
+	eddc.name = "Messages_List";
+	store->edd_list = eet_data_descriptor_stream_new(&eddc);
+
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd_msg, Store_Eet_Message,
+					"content", content, EET_T_STRING);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd_msg, Store_Eet_Message,
+					"time", time, EET_T_LONG_LONG);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd_msg, Store_Eet_Message,
+					"outgoing", outgoing, EET_T_UCHAR);
+	EET_DATA_DESCRIPTOR_ADD_BASIC(store->edd_msg, Store_Eet_Message,
+					"state", state, EET_T_UCHAR);
+
+	EET_DATA_DESCRIPTOR_ADD_LIST(store->edd_list, Store_Eet_List, "list",
+					list, store->edd_msg);
+}
+
+Message_Store *message_store_new(const char *dir)
+{
+	Message_Store *store;
+	Eina_Bool keep_index;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(dir, NULL);
+
+	store = calloc(1, sizeof(Message_Store));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, NULL);
+
+	store->dir = strdup(dir);
+	EINA_SAFETY_ON_NULL_GOTO(store->dir, err_dir);
+
+	if (asprintf(&store->path, "%s/%s", dir, STORE_FILE) < 0)
+		goto err_path;
+
+	if (asprintf(&store->index_path, "%s/%s", dir, STORE_INDEX_FILE) < 0)
+		goto err_index_path;
+
+	store->index = message_index_new();
+	EINA_SAFETY_ON_NULL_GOTO(store->index, err_index);
+
+	store->pending = eina_binbuf_new();
+	EINA_SAFETY_ON_NULL_GOTO(store->pending, err_pending);
+
+	store->fd = open(store->path, O_RDWR | O_CREAT, 0600);
+	if (store->fd < 0) {
+		ERR("could not open %s: %s", store->path, strerror(errno));
+		goto err_open;
+	}
+
+	/* a stale index is rebuilt while loading */
+	keep_index = message_index_load(store->index, store->index_path,
+					_store_signature(store));
+	if (!_store_load(store, keep_index))
+		goto err_load;
+
+	eet_init();
+	_store_eet_descriptors_init(store);
+
+	_store_migrate(store);
+
+	return store;
+
+err_load:
+	close(store->fd);
+	_store_reset(store);
+	eina_hash_free(store->threads);
+err_open:
+	eina_binbuf_free(store->pending);
+err_pending:
+	message_index_free(store->index);
+err_index:
+	free(store->index_path);
+err_index_path:
+	free(store->path);
+err_path:
+	free(store->dir);
+err_dir:
+	free(store);
+	return NULL;
+}
+
+void message_store_free(Message_Store *store)
+{
+	EINA_SAFETY_ON_NULL_RETURN(store);
+
+	if (store->transaction > 0) {
+		WRN("committing a transaction left open");
+		store->transaction = 1;
+		message_store_commit(store);
+	}
+
+	if (store->compact_idler)
+		ecore_idler_del(store->compact_idler);
+	if (store->compact) {
+		/* the thread frees it once it stops */
+		store->compact->store = NULL;
+		if (store->compact->thread)
+			ecore_thread_cancel(store->compact->thread);
+		else {
+			unlink(store->compact->tmp);
+			_store_compact_free(store->compact);
+		}
+		store->compact = NULL;
+	}
+	if (store->index_idler)
+		ecore_idler_del(store->index_idler);
+
+	message_index_save(store->index, store->index_path,
+				_store_signature(store));
+	message_index_free(store->index);
+
+	_store_reset(store);
+	eina_hash_free(store->threads);
+	eina_binbuf_free(store->pending);
+	close(store->fd);
+
+	eet_data_descriptor_free(store->edd_msg);
+	eet_data_descriptor_free(store->edd_list);
+	eet_shutdown();
+
+	free(store->index_path);
+	free(store->path);
+	free(store->dir);
+	free(store);
+}
+
+unsigned long long message_store_message_id_new(Message_Store *store)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, 0);
+	/* the next commit records it as used */
+	return store->next_id++;
+}
+
+Eina_Bool message_store_message_save(Message_Store *store, const char *phone,
+					unsigned long long id, long long time,
+					const char *content, Eina_Bool outgoing,
+					unsigned char state)
+{
+	Store_Thread *t;
+	Store_Message *m;
+	Store_Record r;
+	int i;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(content, EINA_FALSE);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(id == 0, EINA_FALSE);
+
+	message_store_begin(store);
+
+	t = _store_thread_get(store, phone);
+	if (!t)
+		goto end;
+
+	i = _thread_message_find(t, time, id);
+	if (i < 0) {
+		if (!_store_message_add(store, t, id, time, content, outgoing,
+					state))
+			goto end;
+		if (id >= store->next_id)
+			store->next_id = id + 1;
+		goto end;
+	}
+
+	m = eina_inarray_nth(t->msgs, i);
+	if (m->state == state)
+		goto end;
+
+	_record_init(&r, STORE_RECORD_STATE, t->id, m->id, m->time,
+			m->outgoing, state);
+	if (_store_record_add(store, &r, NULL)) {
+		_thread_message_state_set(store, t, m, state);
+		store->dead += r.size;
+	}
+
+end:
+	return message_store_commit(store);
+}
+
+/* returns the number of messages left in t or -1 */
+static int _thread_message_del(Message_Store *store, Store_Thread *t,
+				unsigned int i)
+{
+	const Store_Message *m = eina_inarray_nth(t->msgs, i);
+	const char *phone;
+	Store_Record r;
+	int left = -1;
+
+	message_store_begin(store);
+	_record_init(&r, STORE_RECORD_DEL, t->id, m->id, m->time,
+			m->outgoing, m->state);
+	if (_store_record_add(store, &r, NULL)) {
+		_thread_message_remove_at(store, t, i);
+		store->dead += r.size;
+	}
+
+	/* t is gone if the commit fails and reloads the indexes */
+	phone = eina_stringshare_ref(t->phone);
+	if (message_store_commit(store)) {
+		t = eina_hash_find(store->threads, phone);
+		left = t ? (int)eina_inarray_count(t->msgs) : 0;
+	}
+	eina_stringshare_del(phone);
+
+	return left;
+}
+
+int message_store_message_del(Message_Store *store, const char *phone,
+				long long time, const char *content,
+				Eina_Bool outgoing, unsigned char state)
+{
+	Store_Thread *t;
+	uint32_t hash;
+	unsigned int i;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, -1);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, -1);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(content, -1);
+
+	t = eina_hash_find(store->threads, phone);
+	if (!t)
+		return -1;
+
+	hash = _content_hash(content);
+	i = _thread_time_position(t, time, EINA_FALSE);
+	for (; i < eina_inarray_count(t->msgs); i++) {
+		const Store_Message *m = eina_inarray_nth(t->msgs, i);
+		const char *c;
+
+		if (m->time != time)
+			break;
+		if (m->hash != hash || m->outgoing != !!outgoing ||
+			m->state != state)
+			continue;
+
+		c = _store_content_get(store, m->offset);
+		if (!c || strcmp(c, content) != 0)
+			continue;
+
+		return _thread_message_del(store, t, i);
+	}
+
+	return eina_inarray_count(t->msgs);
+}
+
+int message_store_message_id_del(Message_Store *store, const char *phone,
+					long long time, unsigned long long id)
+{
+	Store_Thread *t;
+	int i;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, -1);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, -1);
+
+	t = eina_hash_find(store->threads, phone);
+	if (!t)
+		return -1;
+
+	i = _thread_message_find(t, time, id);
+	if (i < 0)
+		return eina_inarray_count(t->msgs);
+
+	return _thread_message_del(store, t, i);
+}
+
+Eina_Bool message_store_message_state_set(Message_Store *store,
+						const char *phone,
+						long long time,
+						unsigned long long id,
+						unsigned char state)
+{
+	Store_Thread *t;
+	Store_Message *m;
+	Store_Record r;
+	int i;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, EINA_FALSE);
+
+	t = eina_hash_find(store->threads, phone);
+	if (!t)
+		return EINA_FALSE;
+
+	i = _thread_message_find(t, time, id);
+	if (i < 0)
+		return EINA_FALSE;
+
+	m = eina_inarray_nth(t->msgs, i);
+	if (m->state == state)
+		return EINA_TRUE;
+
+	message_store_begin(store);
+	_record_init(&r, STORE_RECORD_STATE, t->id, m->id, m->time,
+			m->outgoing, state);
+	if (_store_record_add(store, &r, NULL)) {
+		_thread_message_state_set(store, t, m, state);
+		store->dead += r.size;
+	}
+	return message_store_commit(store);
+}
+
+void message_store_thread_del(Message_Store *store, const char *phone)
+{
+	Store_Thread *t;
+	Store_Record r;
+
+	EINA_SAFETY_ON_NULL_RETURN(store);
+	EINA_SAFETY_ON_NULL_RETURN(phone);
+
+	t = eina_hash_find(store->threads, phone);
+	if (!t)
+		return;
+
+	message_store_begin(store);
+	_record_init(&r, STORE_RECORD_THREAD_DEL, t->id, 0, 0, EINA_FALSE, 0);
+	if (_store_record_add(store, &r, NULL)) {
+		_store_thread_remove(store, t);
+		store->dead += r.size;
+	}
+	message_store_commit(store);
+}
+
+unsigned int message_store_thread_count_get(const Message_Store *store,
+						const char *phone)
+{
+	const Store_Thread *t;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, 0);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, 0);
+
+	t = eina_hash_find(store->threads, phone);
+	return t ? eina_inarray_count(t->msgs) : 0;
+}
+
+unsigned int message_store_thread_message_position_get(
+						const Message_Store *store,
+						const char *phone,
+						long long time,
+						unsigned long long id)
+{
+	const Store_Thread *t;
+	int i;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, 0);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, 0);
+
+	t = eina_hash_find(store->threads, phone);
+	if (!t)
+		return 0;
+
+	/* others of the same second may come before it */
+	i = _thread_message_find(t, time, id);
+	if (i >= 0)
+		return i;
+	return _thread_time_position(t, time, EINA_FALSE);
+}
+
+Eina_Bool message_store_thread_range_foreach(Message_Store *store,
+						const char *phone,
+						unsigned int first,
+						unsigned int count,
+						Message_Store_Foreach_Cb cb,
+						const void *data)
+{
+	const Store_Thread *t;
+	unsigned int i, n;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(phone, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, EINA_FALSE);
+
+	t = eina_hash_find(store->threads, phone);
+	if (!t)
+		return EINA_FALSE;
+
+	n = eina_inarray_count(t->msgs);
+	if (first > n)
+		first = n;
+	if (count > n - first)
+		count = n - first;
+
+	for (i = first; i < first + count; i++) {
+		const Store_Message *m = eina_inarray_nth(t->msgs, i);
+		const char *content = _store_content_get(store, m->offset);
+
+		if (!content)
+			return EINA_FALSE;
+		if (!cb((void *)data, m->id, m->time, content, m->outgoing,
+			m->state))
+			break;
+	}
+
+	return EINA_TRUE;
+}
+
+Eina_Bool message_store_thread_foreach(Message_Store *store, const char *phone,
+					Message_Store_Foreach_Cb cb,
+					const void *data)
+{
+	return message_store_thread_range_foreach(store, phone, 0, UINT_MAX,
+							cb, data);
+}
+
+void message_store_state_foreach(Message_Store *store, unsigned char state,
+					Message_Store_State_Cb cb,
+					const void *data)
+{
+	const Store_State_Ref *ref;
+	const Eina_Inarray *refs;
+
+	EINA_SAFETY_ON_NULL_RETURN(store);
+	EINA_SAFETY_ON_NULL_RETURN(cb);
+
+	refs = store->states[state];
+	if (!refs)
+		return;
+
+	EINA_INARRAY_FOREACH(refs, ref) {
+		const char *rec = _store_record_get(store, ref->offset);
+		Store_Record r;
+
+		if (!rec)
+			return;
+		memcpy(&r, rec, sizeof(r));
+		if (!cb((void *)data, ref->thread->phone, r.id, r.time,
+			rec + sizeof(r), r.outgoing))
+			return;
+	}
+}
+
+static Eina_Bool _store_search_hit(void *data, const char *phone,
+					unsigned long long id, long long time)
+{
+	Store_Search *ctx = data;
+	const Store_Thread *t;
+	const Store_Message *m;
+	const char *content;
+	int i;
+
+	t = eina_hash_find(ctx->store->threads, phone);
+	if (!t)
+		return EINA_TRUE;
+
+	i = _thread_message_find(t, time, id);
+	if (i < 0)
+		return EINA_TRUE;
+
+	m = eina_inarray_nth(t->msgs, i);
+	content = _store_content_get(ctx->store, m->offset);
+	if (!content)
+		return EINA_TRUE;
+
+	return ctx->cb((void *)ctx->data, t->phone, m->id, m->time, content,
+			m->outgoing);
+}
+
+void message_store_search(Message_Store *store, const char *query,
+				unsigned int max, Message_Store_State_Cb cb,
+				const void *data)
+{
+	Store_Search ctx;
+
+	EINA_SAFETY_ON_NULL_RETURN(store);
+	EINA_SAFETY_ON_NULL_RETURN(query);
+	EINA_SAFETY_ON_NULL_RETURN(cb);
+
+	ctx.store = store;
+	ctx.cb = cb;
+	ctx.data = data;
+	message_index_query(store->index, query, max, _store_search_hit, &ctx);
+}
@@ -0,0 +1,112 @@
+#ifndef _EFL_OFONO_STORE_H__
+#define _EFL_OFONO_STORE_H__ 1
+
+/*
+ * Conversation storage, a single log-structured file for all
+ * correspondents.
+ *
+ * Every change is appended as records closed by a commit record, a
+ * transaction that did not reach its commit is discarded when the file
+ * is opened again. Messages are indexed in memory by conversation and
+ * time, and by state, their content is only read from the file when
+ * asked for. Superseded records are compacted away when idle.
+ *
+ * Message content is also indexed by word for searching, the index is
+ * kept in messages.index next to the store and rebuilt if it does not
+ * match it.
+ *
+ * Conversations still in the old <phone>.eet files are moved into the
+ * store when it is first created.
+ */
+
+typedef struct _Message_Store Message_Store;
+
+typedef Eina_Bool (*Message_Store_Foreach_Cb)(void *data,
+						unsigned long long id,
+						long long time,
+						const char *content,
+						Eina_Bool outgoing,
+						unsigned char state);
+
+typedef Eina_Bool (*Message_Store_State_Cb)(void *data, const char *phone,
+						unsigned long long id,
+						long long time,
+						const char *content,
+						Eina_Bool outgoing);
+
+Message_Store *message_store_new(const char *dir);
+void message_store_free(Message_Store *store);
+
+/* writes until the matching commit are a single transaction, calls nest */
+void message_store_begin(Message_Store *store);
+Eina_Bool message_store_commit(Message_Store *store);
+
+/* Messages get an id when created, before they are saved. It never
+ * changes nor is reused. The time of the message locates it in the
+ * conversation.
+ */
+unsigned long long message_store_message_id_new(Message_Store *store);
+
+/* adds the message, or only updates its state if the conversation
+ * already has it
+ */
+Eina_Bool message_store_message_save(Message_Store *store, const char *phone,
+					unsigned long long id, long long time,
+					const char *content, Eina_Bool outgoing,
+					unsigned char state);
+
+/* returns the number of messages left in the conversation or -1 */
+int message_store_message_del(Message_Store *store, const char *phone,
+				long long time, const char *content,
+				Eina_Bool outgoing, unsigned char state);
+
+int message_store_message_id_del(Message_Store *store, const char *phone,
+					long long time, unsigned long long id);
+
+Eina_Bool message_store_message_state_set(Message_Store *store,
+						const char *phone,
+						long long time,
+						unsigned long long id,
+						unsigned char state);
+
+void message_store_thread_del(Message_Store *store, const char *phone);
+
+unsigned int message_store_thread_count_get(const Message_Store *store,
+						const char *phone);
+
+/* position of the message, or of the first one at or after time if it
+ * is gone
+ */
+unsigned int message_store_thread_message_position_get(
+						const Message_Store *store,
+						const char *phone,
+						long long time,
+						unsigned long long id);
+
+/* oldest first, stops if cb returns EINA_FALSE. Returns EINA_FALSE if
+ * the conversation could not be read. cb must not change the store.
+ */
+Eina_Bool message_store_thread_range_foreach(Message_Store *store,
+						const char *phone,
+						unsigned int first,
+						unsigned int count,
+						Message_Store_Foreach_Cb cb,
+						const void *data);
+
+Eina_Bool message_store_thread_foreach(Message_Store *store, const char *phone,
+					Message_Store_Foreach_Cb cb,
+					const void *data);
+
+/* all messages in state, in the order they were stored */
+void message_store_state_foreach(Message_Store *store, unsigned char state,
+					Message_Store_State_Cb cb,
+					const void *data);
+
+/* messages with words starting with each of the query words, newest
+ * first. Stops after max messages or if cb returns EINA_FALSE.
+ */
+void message_store_search(Message_Store *store, const char *query,
+				unsigned int max, Message_Store_State_Cb cb,
+				const void *data);
+
+#endif
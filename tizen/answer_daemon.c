@@ -9,6 +9,8 @@
 #include <Elementary.h>
 #include <E_DBus.h>
 
+#include "trace.h"
+
 #ifdef HAVE_TIZEN
 #include <Ecore_X.h>
 #include <vconf.h>
@@ -22,6 +24,7 @@
 #define BUS_NAME "org.tizen.dialer"
 #define PATH "/"
 #define IFACE "org.tizen.dialer.Control"
+#define PHOTO_CACHE_MAX 4
 
 static int _log_domain = -1;
 #define ERR(...)      EINA_LOG_DOM_ERR(_log_domain, __VA_ARGS__)
@@ -31,11 +34,19 @@ static int _log_domain = -1;
 static E_DBus_Connection *bus_conn = NULL;
 
 typedef struct _Call {
-	const char *line_id, *img, *type, *name;
+	const char *line_id, *img, *type, *name, *path;
 } Call;
 
+typedef struct _Photo {
+	const char *path;
+	Evas_Object *icon;
+} Photo;
+
 typedef struct _Call_Screen {
 	Evas_Object *win, *layout;
+	Evas_Object *photo; /* swallowed */
+	Evas_Object *photo_none;
+	Eina_List *photos; /* Photo, most recently used first */
 	Call *call;
 	Eina_Bool screen_visible;
 	E_DBus_Signal_Handler *sig_call_add;
@@ -83,13 +94,14 @@ static Eina_Bool _phone_locked(void)
 static Call *_call_create(DBusMessage *msg)
 {
 	DBusError err;
-	const char *img, *name, *id, *type;
+	const char *img, *name, *id, *type, *path;
 	Call *call;
 
 	dbus_error_init(&err);
 	dbus_message_get_args(msg, &err, DBUS_TYPE_STRING, &img,
 				DBUS_TYPE_STRING, &id, DBUS_TYPE_STRING,
 				&name, DBUS_TYPE_STRING, &type,
+				DBUS_TYPE_STRING, &path,
 				DBUS_TYPE_INVALID);
 
 	if (dbus_error_is_set(&err)) {
@@ -103,6 +115,7 @@ static Call *_call_create(DBusMessage *msg)
 	call->line_id = eina_stringshare_add(id);
 	call->type = eina_stringshare_add(type);
 	call->name = eina_stringshare_add(name);
+	call->path = eina_stringshare_add(path);
 	DBG("c=%p line_id=%s, name=%s, type=%s, img=%s",
 		call, call->line_id, call->name, call->type, call->img);
 	return call;
@@ -116,13 +129,110 @@ static void _call_destroy(Call *c)
 	eina_stringshare_del(c->line_id);
 	eina_stringshare_del(c->type);
 	eina_stringshare_del(c->name);
+	eina_stringshare_del(c->path);
 	free(c);
 }
 
+static Evas_Object *_photo_icon_add(Call_Screen *cs, const char *path)
+{
+	Evas_Object *icon = elm_icon_add(cs->layout);
+	Eina_Bool ok;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(icon, NULL);
+#ifdef HAVE_TIZEN
+	ok = elm_icon_file_set(icon, path, NULL);
+#else
+	ok = elm_image_file_set(icon, path, NULL);
+#endif
+	if (!ok) {
+		ERR("Could not load photo %s", path);
+		evas_object_del(icon);
+		return NULL;
+	}
+
+	/* decode now, the icon is hidden until a call from this contact */
+	evas_object_image_preload(elm_image_object_get(icon), EINA_FALSE);
+	return icon;
+}
+
+static void _photo_set(Call_Screen *cs, Evas_Object *icon)
+{
+	Evas_Object *prev;
+
+	if (cs->photo == icon)
+		return;
+
+	prev = elm_object_part_content_unset(cs->layout, "elm.swallow.photo");
+	if (prev)
+		evas_object_hide(prev);
+	elm_object_part_content_set(cs->layout, "elm.swallow.photo", icon);
+	cs->photo = icon;
+}
+
+static Evas_Object *_photo_get(Call_Screen *cs, const char *path)
+{
+	Eina_List *l;
+	Photo *p;
+
+	if ((!path) || (path[0] == '\0'))
+		return cs->photo_none;
+
+	EINA_LIST_FOREACH(cs->photos, l, p) {
+		if (p->path == path) {
+			cs->photos = eina_list_promote_list(cs->photos, l);
+			return p->icon;
+		}
+	}
+
+	p = calloc(1, sizeof(Photo));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(p, cs->photo_none);
+	p->icon = _photo_icon_add(cs, path);
+	if (!p->icon) {
+		free(p);
+		return cs->photo_none;
+	}
+	p->path = eina_stringshare_ref(path);
+	cs->photos = eina_list_prepend(cs->photos, p);
+
+	if (eina_list_count(cs->photos) > PHOTO_CACHE_MAX) {
+		Eina_List *last = eina_list_last(cs->photos);
+		Photo *old = eina_list_data_get(last);
+
+		cs->photos = eina_list_remove_list(cs->photos, last);
+		if (cs->photo == old->icon)
+			_photo_set(cs, cs->photo_none);
+		evas_object_del(old->icon);
+		eina_stringshare_del(old->path);
+		free(old);
+	}
+
+	return p->icon;
+}
+
+static void _photos_free(Call_Screen *cs)
+{
+	Photo *p;
+
+	EINA_LIST_FREE(cs->photos, p) {
+		eina_stringshare_del(p->path);
+		free(p);
+	}
+}
+
+static void _call_screen_render_post(void *data, Evas *e,
+					void *event_info __UNUSED__)
+{
+	Call_Screen *cs = data;
+
+	evas_event_callback_del_full(e, EVAS_CALLBACK_RENDER_POST,
+					_call_screen_render_post, cs);
+	if (cs->call)
+		trace_mark(cs->call->path, "answer-rendered");
+}
+
 static void _call_screen_show(Call_Screen *cs)
 {
 	Call *c = cs->call;
-	Evas_Object *icon = NULL;
 
 	INF("Show line_id=%s, name=%s, type=%s",
 		c->line_id, c->name, c->type);
@@ -138,22 +248,18 @@ static void _call_screen_show(Call_Screen *cs)
 	else
 		elm_object_part_text_set(cs->layout, "elm.text.name",
 						c->name);
-	icon = elm_icon_add(cs->layout);
-
-	if (strcmp("", c->img) != 0) {
-#ifdef HAVE_TIZEN
-		elm_icon_file_set(icon, c->img, NULL);
-#else
-		elm_image_file_set(icon, c->img, NULL);
-#endif
-	} else
-		elm_icon_standard_set(icon, "no-picture");
-
-	elm_object_part_text_set(cs->layout, "elm.text.state", "Incoming...");
 	elm_object_part_text_set(cs->layout, "elm.text.phone.type", c->type);
-	elm_object_part_content_set(cs->layout, "elm.swallow.photo", icon);
+	_photo_set(cs, _photo_get(cs, c->img));
 	elm_object_signal_emit(cs->layout, "show,activecall", "gui");
 	evas_object_show(cs->win);
+	trace_mark(c->path, "answer-shown");
+	if (trace_enabled_get()) {
+		Evas *e = evas_object_evas_get(cs->win);
+		evas_event_callback_del_full(e, EVAS_CALLBACK_RENDER_POST,
+						_call_screen_render_post, cs);
+		evas_event_callback_add(e, EVAS_CALLBACK_RENDER_POST,
+					_call_screen_render_post, cs);
+	}
 #ifdef HAVE_TIZEN
 	//screen can't be off
 	power_lock_state(POWER_STATE_NORMAL, 0);
@@ -171,9 +277,14 @@ static void _sig_call_added(void *data, DBusMessage *msg)
 	if (cs->call)
 		_call_destroy(cs->call);
 	cs->call = _call_create(msg);
+	EINA_SAFETY_ON_NULL_RETURN(cs->call);
+	trace_mark(cs->call->path, "answer-signal");
 
-	if (!locked)
+	if (!locked) {
+		/* start decoding, the phone may lock before it is answered */
+		_photo_get(cs, cs->call->img);
 		return;
+	}
 
 	_call_screen_show(cs);
 }
@@ -288,6 +399,8 @@ static void _daemon_available_call_reply(void *data, DBusMessage *msg,
 		_call_destroy(cs->call);
 
 	cs->call = _call_create(msg);
+	EINA_SAFETY_ON_NULL_RETURN(cs->call);
+	trace_mark(cs->call->path, "answer-fetched");
 	_call_screen_show(cs);
 }
 
@@ -500,6 +613,13 @@ static Eina_Bool _gui_init(Call_Screen *cs)
 	evas_object_show(slider);
 	elm_object_part_content_set(lay, "elm.swallow.slider", slider);
 
+	cs->layout = lay;
+	cs->photo_none = elm_icon_add(lay);
+	EINA_SAFETY_ON_NULL_GOTO(cs->photo_none, err_obj);
+	elm_icon_standard_set(cs->photo_none, "no-picture");
+	_photo_set(cs, cs->photo_none);
+	elm_object_part_text_set(lay, "elm.text.state", "Incoming...");
+
 	obj = elm_layout_edje_get(lay);
 	edje_object_size_min_get(obj, &w, &h);
 	if ((w == 0) || (h == 0))
@@ -509,11 +629,15 @@ static Eina_Bool _gui_init(Call_Screen *cs)
 	evas_object_resize(lay, w, h);
 	evas_object_resize(win, w, h);
 	cs->win = win;
-	cs->layout = lay;
+
+	/* lay it out while hidden, a call only swaps texts and photo */
+	evas_smart_objects_calculate(evas_object_evas_get(win));
 
 	return EINA_TRUE;
 
 err_obj:
+	cs->layout = NULL;
+	cs->photo_none = NULL;
 	evas_object_del(win);
 	return EINA_FALSE;
 }
@@ -542,6 +666,7 @@ EAPI int elm_main(int argc __UNUSED__, char **argv __UNUSED__)
 		e_dbus_signal_handler_del(bus_conn, cs->sig_name_changed);
 
 	evas_object_del(cs->win);
+	_photos_free(cs);
 	if (cs->call)
 		_call_destroy(cs->call);
 
@@ -0,0 +1,362 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Ecore.h>
+#include <Ecore_Getopt.h>
+#include <Eina.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "trace.h"
+
+/*
+ * Summarizes the files written with OFONO_EFL_TRACE set.
+ *
+ * Lines are "<monotonic seconds> <call path> <hop>". Hops of a call
+ * are put in time order, a call starts at its first hop and oFono
+ * reuses paths, so "ofono-call-added" or a long gap starts a new one.
+ * For each hop it prints the time since the previous hop of the call
+ * and since the call started, p50, p99 and max over all calls.
+ */
+
+#define TRACE_CALL_START "ofono-call-added"
+#define TRACE_CALL_MAX 60.0 /* later hops are of another call */
+
+typedef struct _Event {
+	double t;
+	const char *key;
+	const char *hop;
+} Event;
+
+typedef struct _Call {
+	double start;
+	double last;
+} Call;
+
+typedef struct _Hop {
+	const char *name;
+	Eina_Inarray *step; /* double, since the previous hop */
+	Eina_Inarray *total; /* double, since the call started */
+} Hop;
+
+typedef struct _Report {
+	Eina_Inarray *events; /* Event */
+	Eina_Hash *hops; /* name -> Hop */
+	unsigned int calls;
+	unsigned int skipped;
+} Report;
+
+static const Ecore_Getopt options = {
+	"ofono-efl-call-trace-report",
+	"%prog [options] [trace-file] [...]",
+	PACKAGE_VERSION,
+	"(C) 2012 Intel Corporation",
+	"GPL-2" /* TODO: check license with Intel */,
+	"Latency of incoming calls from "TRACE_ENV" files, stdin if none.",
+	EINA_FALSE,
+	{ECORE_GETOPT_VERSION('V', "version"),
+	 ECORE_GETOPT_COPYRIGHT('C', "copyright"),
+	 ECORE_GETOPT_LICENSE('L', "license"),
+	 ECORE_GETOPT_HELP('h', "help"),
+	 ECORE_GETOPT_SENTINEL
+	}
+};
+
+int _log_domain = -1;
+int _app_exit_code = EXIT_SUCCESS;
+
+static void _hop_free(void *data)
+{
+	Hop *hop = data;
+
+	eina_stringshare_del(hop->name);
+	eina_inarray_free(hop->step);
+	eina_inarray_free(hop->total);
+	free(hop);
+}
+
+static Eina_Bool _file_read(Report *rep, FILE *fp, const char *name)
+{
+	char line[512], key[256], hop[128];
+	unsigned int n = 0;
+	Event ev;
+
+	while (fgets(line, sizeof(line), fp)) {
+		n++;
+		if (sscanf(line, "%lf %255s %127s", &ev.t, key, hop) != 3) {
+			WRN("%s:%u: not a trace line", name, n);
+			rep->skipped++;
+			continue;
+		}
+
+		ev.key = eina_stringshare_add(key);
+		ev.hop = eina_stringshare_add(hop);
+		if (eina_inarray_push(rep->events, &ev) < 0) {
+			eina_stringshare_del(ev.key);
+			eina_stringshare_del(ev.hop);
+			return EINA_FALSE;
+		}
+	}
+
+	if (ferror(fp)) {
+		ERR("Could not read %s", name);
+		return EINA_FALSE;
+	}
+
+	return EINA_TRUE;
+}
+
+static int _event_cmp(const void *a, const void *b)
+{
+	const Event *ea = a, *eb = b;
+
+	if (ea->t < eb->t)
+		return -1;
+	return ea->t > eb->t;
+}
+
+static int _double_cmp(const void *a, const void *b)
+{
+	const double *da = a, *db = b;
+
+	if (*da < *db)
+		return -1;
+	return *da > *db;
+}
+
+static Hop *_hop_get(Report *rep, const char *name)
+{
+	Hop *hop = eina_hash_find(rep->hops, name);
+
+	if (hop)
+		return hop;
+
+	hop = calloc(1, sizeof(Hop));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(hop, NULL);
+	hop->name = eina_stringshare_ref(name);
+	hop->step = eina_inarray_new(sizeof(double), 64);
+	hop->total = eina_inarray_new(sizeof(double), 64);
+	if ((!hop->step) || (!hop->total)) {
+		_hop_free(hop);
+		return NULL;
+	}
+
+	eina_hash_add(rep->hops, name, hop);
+	return hop;
+}
+
+static Eina_Bool _events_process(Report *rep)
+{
+	Eina_Hash *calls = eina_hash_stringshared_new(free);
+	Event *ev;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(calls, EINA_FALSE);
+
+	/* files of the dialer and the answer daemon may interleave */
+	eina_inarray_sort(rep->events, _event_cmp);
+
+	EINA_INARRAY_FOREACH(rep->events, ev) {
+		Call *call = eina_hash_find(calls, ev->key);
+		Hop *hop;
+		double step, total;
+
+		if ((!call) || (strcmp(ev->hop, TRACE_CALL_START) == 0) ||
+			(ev->t - call->start > TRACE_CALL_MAX)) {
+			if (!call) {
+				call = malloc(sizeof(Call));
+				EINA_SAFETY_ON_NULL_GOTO(call, err);
+				eina_hash_add(calls, ev->key, call);
+			}
+			call->start = call->last = ev->t;
+			rep->calls++;
+		}
+
+		step = ev->t - call->last;
+		total = ev->t - call->start;
+		call->last = ev->t;
+
+		hop = _hop_get(rep, ev->hop);
+		EINA_SAFETY_ON_NULL_GOTO(hop, err);
+		eina_inarray_push(hop->step, &step);
+		eina_inarray_push(hop->total, &total);
+	}
+
+	eina_hash_free(calls);
+	return EINA_TRUE;
+
+err:
+	eina_hash_free(calls);
+	return EINA_FALSE;
+}
+
+/* nearest rank, values must be sorted */
+static double _percentile(const Eina_Inarray *values, unsigned int p)
+{
+	unsigned int count = eina_inarray_count(values), rank;
+
+	if (count == 0)
+		return 0.0;
+
+	rank = (count * p + 99) / 100;
+	if (rank > 0)
+		rank--;
+	return *(double *)eina_inarray_nth(values, rank);
+}
+
+static Eina_Bool _hops_list(const Eina_Hash *hash __UNUSED__,
+				const void *key __UNUSED__, void *data,
+				void *fdata)
+{
+	Eina_List **hops = fdata;
+	*hops = eina_list_append(*hops, data);
+	return EINA_TRUE;
+}
+
+static int _hop_cmp(const void *a, const void *b)
+{
+	const Hop *ha = a, *hb = b;
+	double ma = _percentile(ha->total, 50);
+	double mb = _percentile(hb->total, 50);
+
+	if (ma < mb)
+		return -1;
+	if (ma > mb)
+		return 1;
+	return strcmp(ha->name, hb->name);
+}
+
+static void _report_print(Report *rep)
+{
+	Eina_List *hops = NULL;
+	Hop *hop;
+
+	eina_hash_foreach(rep->hops, _hops_list, &hops);
+	EINA_LIST_FREE(hops, hop) {
+		eina_inarray_sort(hop->step, _double_cmp);
+		eina_inarray_sort(hop->total, _double_cmp);
+	}
+
+	eina_hash_foreach(rep->hops, _hops_list, &hops);
+	hops = eina_list_sort(hops, 0, _hop_cmp);
+
+	printf("%u calls, %u events", rep->calls,
+		eina_inarray_count(rep->events));
+	if (rep->skipped)
+		printf(", %u lines skipped", rep->skipped);
+	printf("\n\n%-20s %6s %27s %27s\n", "", "",
+		"since previous hop (ms)", "since call added (ms)");
+	printf("%-20s %6s %8s %8s %9s %8s %8s %9s\n", "hop", "count",
+		"p50", "p99", "max", "p50", "p99", "max");
+
+	EINA_LIST_FREE(hops, hop) {
+		printf("%-20s %6u %8.1f %8.1f %9.1f %8.1f %8.1f %9.1f\n",
+			hop->name, eina_inarray_count(hop->step),
+			_percentile(hop->step, 50) * 1000.0,
+			_percentile(hop->step, 99) * 1000.0,
+			_percentile(hop->step, 100) * 1000.0,
+			_percentile(hop->total, 50) * 1000.0,
+			_percentile(hop->total, 99) * 1000.0,
+			_percentile(hop->total, 100) * 1000.0);
+	}
+}
+
+static void _report_free(Report *rep)
+{
+	Event *ev;
+
+	if (rep->events) {
+		EINA_INARRAY_FOREACH(rep->events, ev) {
+			eina_stringshare_del(ev->key);
+			eina_stringshare_del(ev->hop);
+		}
+		eina_inarray_free(rep->events);
+	}
+	if (rep->hops)
+		eina_hash_free(rep->hops);
+}
+
+int main(int argc, char **argv)
+{
+	int args, i;
+	Eina_Bool quit_option = EINA_FALSE;
+	Report rep;
+	Ecore_Getopt_Value values[] = {
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_NONE
+	};
+
+	memset(&rep, 0, sizeof(rep));
+
+	eina_init();
+	ecore_init();
+
+	_log_domain = eina_log_domain_register("call-trace-report", NULL);
+	if (_log_domain < 0) {
+		EINA_LOG_CRIT("Could not create log domain "
+				"'call-trace-report'.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	args = ecore_getopt_parse(&options, values, argc, argv);
+	if (args < 0) {
+		ERR("Could not parse command line options.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (quit_option)
+		goto end;
+
+	rep.events = eina_inarray_new(sizeof(Event), 1024);
+	rep.hops = eina_hash_stringshared_new(_hop_free);
+	if ((!rep.events) || (!rep.hops)) {
+		_app_exit_code = EXIT_FAILURE;
+		goto end_report;
+	}
+
+	if (args >= argc) {
+		if (!_file_read(&rep, stdin, "stdin")) {
+			_app_exit_code = EXIT_FAILURE;
+			goto end_report;
+		}
+	}
+
+	for (i = args; i < argc; i++) {
+		FILE *fp = fopen(argv[i], "r");
+		Eina_Bool ok;
+
+		if (!fp) {
+			ERR("Could not open %s", argv[i]);
+			_app_exit_code = EXIT_FAILURE;
+			goto end_report;
+		}
+		ok = _file_read(&rep, fp, argv[i]);
+		fclose(fp);
+		if (!ok) {
+			_app_exit_code = EXIT_FAILURE;
+			goto end_report;
+		}
+	}
+
+	if (!_events_process(&rep)) {
+		_app_exit_code = EXIT_FAILURE;
+		goto end_report;
+	}
+
+	_report_print(&rep);
+
+end_report:
+	_report_free(&rep);
+end:
+	if (_log_domain >= 0)
+		eina_log_domain_unregister(_log_domain);
+	ecore_shutdown();
+	eina_shutdown();
+	return _app_exit_code;
+}
@@ -0,0 +1,645 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Elementary.h>
+#include <Eet.h>
+#include <Eina.h>
+#include <Ecore_Getopt.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "log.h"
+#include "contacts-ofono-efl.h"
+#include "contacts-db.h"
+
+#ifndef EET_COMPRESSION_DEFAULT
+#define EET_COMPRESSION_DEFAULT 1
+#endif
+
+/*
+ * Streams CSV or vCard files into the desktop contacts database.
+ *
+ * CSV columns are the same as ofono-efl-contacts-db-create.py:
+ * first name, last name, work, home and mobile phones, plus an
+ * optional picture. Numbers keep only their digits. Contacts are sorted
+ * once here and written together with their snapshot, so the dialer
+ * maps them without decoding or sorting anything.
+ */
+
+typedef enum {
+	FORMAT_AUTO = 0,
+	FORMAT_CSV,
+	FORMAT_VCARD
+} Format;
+
+typedef struct _Import {
+	Eina_Inarray *contacts; /* Contact_Info * */
+	unsigned int skipped;
+	Eina_Bool verbose;
+} Import;
+
+typedef struct _VCard {
+	const char *first_name;
+	const char *last_name;
+	const char *full_name;
+	const char *mobile;
+	const char *home;
+	const char *work;
+	const char *picture;
+	Eina_Bool active;
+} VCard;
+
+static const char *formats[] = {"auto", "csv", "vcard", NULL};
+
+static const Ecore_Getopt options = {
+	"ofono-efl-contacts-import",
+	"%prog [options] <file.csv|file.vcf> [...]",
+	PACKAGE_VERSION,
+	"(C) 2012 Intel Corporation",
+	"GPL-2" /* TODO: check license with Intel */,
+	"Creates the desktop contacts database from CSV or vCard files.",
+	EINA_FALSE,
+	{ECORE_GETOPT_STORE_STR('o', "output",
+				"directory to write contacts.eet to."),
+	 ECORE_GETOPT_CHOICE('f', "format", "input format.", formats),
+	 ECORE_GETOPT_STORE_TRUE('v', "verbose", "print imported contacts."),
+	 ECORE_GETOPT_VERSION('V', "version"),
+	 ECORE_GETOPT_COPYRIGHT('C', "copyright"),
+	 ECORE_GETOPT_LICENSE('L', "license"),
+	 ECORE_GETOPT_HELP('h', "help"),
+	 ECORE_GETOPT_SENTINEL
+	}
+};
+
+int _log_domain = -1;
+int _app_exit_code = EXIT_SUCCESS;
+
+static const char *_number_normalize(const char *number)
+{
+	char *buf;
+	size_t i, j;
+
+	if (!number)
+		return eina_stringshare_add("");
+
+	buf = alloca(strlen(number) + 1);
+	for (i = 0, j = 0; number[i] != '\0'; i++) {
+		if (isdigit((unsigned char)number[i]))
+			buf[j++] = number[i];
+	}
+	buf[j] = '\0';
+
+	return eina_stringshare_add(buf);
+}
+
+static const char *_name_normalize(const char *name)
+{
+	const char *end;
+
+	if (!name)
+		return eina_stringshare_add("");
+
+	while (isspace((unsigned char)*name))
+		name++;
+	end = name + strlen(name);
+	while (end > name && isspace((unsigned char)end[-1]))
+		end--;
+
+	return eina_stringshare_add_length(name, end - name);
+}
+
+static void _contact_add(Import *imp, const char *first_name,
+				const char *last_name, const char *work,
+				const char *home, const char *mobile,
+				const char *picture)
+{
+	Contact_Info *c_info;
+
+	c_info = calloc(1, sizeof(Contact_Info));
+	EINA_SAFETY_ON_NULL_RETURN(c_info);
+
+	c_info->first_name = _name_normalize(first_name);
+	c_info->last_name = _name_normalize(last_name);
+	c_info->work = _number_normalize(work);
+	c_info->home = _number_normalize(home);
+	c_info->mobile = _number_normalize(mobile);
+	if (picture && picture[0] != '\0')
+		c_info->picture = eina_stringshare_add(picture);
+
+	if (c_info->first_name[0] == '\0' && c_info->last_name[0] == '\0' &&
+		c_info->work[0] == '\0' && c_info->home[0] == '\0' &&
+		c_info->mobile[0] == '\0') {
+		imp->skipped++;
+		goto err;
+	}
+
+	if (imp->verbose)
+		printf("Add: %s, %s, %s, %s, %s\n", c_info->first_name,
+			c_info->last_name, c_info->work, c_info->home,
+			c_info->mobile);
+
+	if (eina_inarray_push(imp->contacts, &c_info) < 0)
+		goto err;
+	return;
+
+err:
+	eina_stringshare_del(c_info->first_name);
+	eina_stringshare_del(c_info->last_name);
+	eina_stringshare_del(c_info->work);
+	eina_stringshare_del(c_info->home);
+	eina_stringshare_del(c_info->mobile);
+	eina_stringshare_del(c_info->picture);
+	free(c_info);
+}
+
+/* splits line in place, handling "quoted, fields" and "" escapes */
+static unsigned int _csv_split(char *line, char **fields, unsigned int max)
+{
+	unsigned int n = 0;
+	char *r = line, *w = line;
+
+	while (n < max) {
+		Eina_Bool quoted = EINA_FALSE;
+
+		while (*r == ' ' || *r == '\t')
+			r++;
+		fields[n++] = w;
+
+		if (*r == '"') {
+			quoted = EINA_TRUE;
+			r++;
+		}
+
+		for (; *r != '\0'; r++) {
+			if (quoted && *r == '"') {
+				if (r[1] == '"') {
+					*w++ = '"';
+					r++;
+					continue;
+				}
+				quoted = EINA_FALSE;
+				continue;
+			}
+			if (!quoted && *r == ',')
+				break;
+			*w++ = *r;
+		}
+
+		if (*r != ',') {
+			*w = '\0';
+			break;
+		}
+		r++;
+		*w++ = '\0';
+	}
+
+	return n;
+}
+
+static void _csv_line(Import *imp, char *line, unsigned int lineno,
+			const char *filename)
+{
+	char *fields[6];
+	unsigned int n;
+
+	n = _csv_split(line, fields, 6);
+	if (n < 5) {
+		if (n > 1 || fields[0][0] != '\0')
+			WRN("%s:%u: expected at least 5 columns, got %u",
+				filename, lineno, n);
+		imp->skipped++;
+		return;
+	}
+
+	_contact_add(imp, fields[0], fields[1], fields[2], fields[3],
+			fields[4], n > 5 ? fields[5] : NULL);
+}
+
+static void _vcard_unescape(char *s)
+{
+	char *w = s;
+
+	for (; *s != '\0'; s++) {
+		if (*s == '\\' && s[1] != '\0') {
+			s++;
+			*w++ = (*s == 'n' || *s == 'N') ? ' ' : *s;
+		} else
+			*w++ = *s;
+	}
+	*w = '\0';
+}
+
+/* splits structured values at unescaped ';' */
+static char *_vcard_component_next(char **p_value)
+{
+	char *start = *p_value, *s;
+
+	if (!start)
+		return NULL;
+
+	for (s = start; *s != '\0'; s++) {
+		if (*s == '\\' && s[1] != '\0')
+			s++;
+		else if (*s == ';')
+			break;
+	}
+
+	if (*s == ';') {
+		*s = '\0';
+		*p_value = s + 1;
+	} else
+		*p_value = NULL;
+
+	_vcard_unescape(start);
+	return start;
+}
+
+static void _vcard_number_set(VCard *card, const char *params,
+				const char *value)
+{
+	const char **slot = NULL;
+
+	if (strcasestr(params, "CELL"))
+		slot = &card->mobile;
+	else if (strcasestr(params, "WORK"))
+		slot = &card->work;
+	else if (strcasestr(params, "HOME"))
+		slot = &card->home;
+
+	if (!slot || *slot) {
+		if (!card->mobile)
+			slot = &card->mobile;
+		else if (!card->home)
+			slot = &card->home;
+		else if (!card->work)
+			slot = &card->work;
+		else
+			return;
+	}
+
+	*slot = eina_stringshare_add(value);
+}
+
+static void _vcard_reset(VCard *card)
+{
+	eina_stringshare_del(card->first_name);
+	eina_stringshare_del(card->last_name);
+	eina_stringshare_del(card->full_name);
+	eina_stringshare_del(card->mobile);
+	eina_stringshare_del(card->home);
+	eina_stringshare_del(card->work);
+	eina_stringshare_del(card->picture);
+	memset(card, 0, sizeof(VCard));
+}
+
+static void _vcard_end(Import *imp, VCard *card)
+{
+	const char *first = card->first_name, *last = card->last_name;
+	char *full = NULL;
+
+	/* no N:, fall back to splitting FN: at the first space */
+	if (!first && !last && card->full_name) {
+		char *sp;
+
+		full = strdup(card->full_name);
+		if (full) {
+			first = full;
+			sp = strchr(full, ' ');
+			if (sp) {
+				*sp = '\0';
+				last = sp + 1;
+			}
+		}
+	}
+
+	_contact_add(imp, first, last, card->work, card->home, card->mobile,
+			card->picture);
+	free(full);
+	_vcard_reset(card);
+}
+
+static void _vcard_line(Import *imp, VCard *card, char *line,
+			unsigned int lineno, const char *filename)
+{
+	char *value, *name, *params, *dot;
+
+	value = strchr(line, ':');
+	if (!value)
+		return;
+	*value++ = '\0';
+
+	name = line;
+	params = strchr(name, ';');
+	if (params)
+		*params++ = '\0';
+	else
+		params = "";
+
+	/* drop "item1." style groups */
+	dot = strchr(name, '.');
+	if (dot)
+		name = dot + 1;
+
+	if (strcasecmp(name, "BEGIN") == 0 &&
+		strcasecmp(value, "VCARD") == 0) {
+		if (card->active)
+			WRN("%s:%u: missing END:VCARD", filename, lineno);
+		_vcard_reset(card);
+		card->active = EINA_TRUE;
+		return;
+	}
+
+	if (!card->active)
+		return;
+
+	if (strcasecmp(name, "END") == 0)
+		_vcard_end(imp, card);
+	else if (strcasecmp(name, "N") == 0) {
+		char *last = _vcard_component_next(&value);
+		char *first = _vcard_component_next(&value);
+		eina_stringshare_replace(&card->last_name, last);
+		eina_stringshare_replace(&card->first_name, first);
+	} else if (strcasecmp(name, "FN") == 0) {
+		_vcard_unescape(value);
+		eina_stringshare_replace(&card->full_name, value);
+	} else if (strcasecmp(name, "TEL") == 0) {
+		if (strncasecmp(value, "tel:", sizeof("tel:") - 1) == 0)
+			value += sizeof("tel:") - 1;
+		_vcard_number_set(card, params, value);
+	} else if (strcasecmp(name, "PHOTO") == 0) {
+		/* inline (base64) photos are not supported */
+		if (strncasecmp(value, "file://", sizeof("file://") - 1) == 0)
+			eina_stringshare_replace(&card->picture, value +
+						sizeof("file://") - 1);
+	}
+}
+
+static Format _format_guess(const char *filename)
+{
+	const char *ext = strrchr(filename, '.');
+
+	if (ext && (strcasecmp(ext, ".vcf") == 0 ||
+			strcasecmp(ext, ".vcard") == 0))
+		return FORMAT_VCARD;
+	return FORMAT_CSV;
+}
+
+static Eina_Bool _file_import(Import *imp, const char *filename,
+				Format format)
+{
+	FILE *fp;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	unsigned int lineno = 0, before;
+	Eina_Strbuf *logical = NULL;
+	Eina_Bool ret = EINA_FALSE;
+	VCard card;
+
+	if (strcmp(filename, "-") == 0)
+		fp = stdin;
+	else
+		fp = fopen(filename, "r");
+	if (!fp) {
+		ERR("could not open %s: %s", filename, strerror(errno));
+		return EINA_FALSE;
+	}
+
+	if (format == FORMAT_AUTO)
+		format = _format_guess(filename);
+
+	memset(&card, 0, sizeof(VCard));
+	if (format == FORMAT_VCARD) {
+		logical = eina_strbuf_new();
+		EINA_SAFETY_ON_NULL_GOTO(logical, end);
+	}
+
+	before = eina_inarray_count(imp->contacts);
+	while ((len = getline(&line, &size, fp)) >= 0) {
+		lineno++;
+		while (len > 0 && (line[len - 1] == '\n' ||
+					line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		if (format == FORMAT_CSV) {
+			_csv_line(imp, line, lineno, filename);
+			continue;
+		}
+
+		/* vCard lines starting with blank continue the previous one */
+		if (line[0] == ' ' || line[0] == '\t') {
+			eina_strbuf_append(logical, line + 1);
+			continue;
+		}
+
+		if (eina_strbuf_length_get(logical) > 0) {
+			char *prev = eina_strbuf_string_steal(logical);
+			_vcard_line(imp, &card, prev, lineno - 1, filename);
+			free(prev);
+		}
+		eina_strbuf_append(logical, line);
+	}
+
+	if (logical && eina_strbuf_length_get(logical) > 0) {
+		char *prev = eina_strbuf_string_steal(logical);
+		_vcard_line(imp, &card, prev, lineno, filename);
+		free(prev);
+	}
+
+	if (card.active) {
+		WRN("%s: missing END:VCARD at end of file", filename);
+		_vcard_end(imp, &card);
+	}
+
+	INF("%s: %u lines, %u contacts", filename, lineno,
+		eina_inarray_count(imp->contacts) - before);
+	ret = EINA_TRUE;
+
+end:
+	if (logical)
+		eina_strbuf_free(logical);
+	free(line);
+	if (fp != stdin)
+		fclose(fp);
+	return ret;
+}
+
+static int _contact_ptr_sort_cb(const void *v1, const void *v2)
+{
+	const Contact_Info * const *c1 = v1, * const *c2 = v2;
+	return contacts_db_sort_cb(*c1, *c2);
+}
+
+static Eina_Bool _database_write(Import *imp, const char *dir)
+{
+	Eet_Data_Descriptor *edd, *edd_list;
+	Contacts_List c_list;
+	Contact_Info **itr;
+	Eet_File *efile;
+	char path[PATH_MAX], bkp[PATH_MAX], tmp[PATH_MAX], snap[PATH_MAX];
+	Eina_Bool ret = EINA_FALSE;
+
+	snprintf(path, sizeof(path), "%s/contacts.eet", dir);
+	snprintf(bkp, sizeof(bkp), "%s/contacts.eet.bkp", dir);
+	snprintf(tmp, sizeof(tmp), "%s/contacts.eet.tmp", dir);
+	snprintf(snap, sizeof(snap), "%s/contacts.snap", dir);
+
+	eina_inarray_sort(imp->contacts, _contact_ptr_sort_cb);
+
+	memset(&c_list, 0, sizeof(c_list));
+	EINA_INARRAY_FOREACH(imp->contacts, itr)
+		c_list.list = eina_list_append(c_list.list, *itr);
+
+	contacts_db_descriptors_init(&edd, &edd_list);
+
+	efile = eet_open(tmp, EET_FILE_MODE_WRITE);
+	if (!efile) {
+		ERR("could not open %s for writing", tmp);
+		goto end;
+	}
+	if (!eet_data_write(efile, edd_list, CONTACTS_ENTRY, &c_list,
+				EET_COMPRESSION_DEFAULT)) {
+		ERR("could not write %s", tmp);
+		eet_close(efile);
+		ecore_file_unlink(tmp);
+		goto end;
+	}
+	eet_close(efile);
+
+	if (ecore_file_exists(path)) {
+		ecore_file_unlink(bkp);
+		ecore_file_mv(path, bkp);
+	}
+	if (rename(tmp, path) < 0) {
+		ERR("could not rename %s to %s: %s", tmp, path,
+			strerror(errno));
+		goto end;
+	}
+
+	if (!contacts_db_snapshot_write(snap, path, c_list.list))
+		WRN("could not write %s, it will be created on first use",
+			snap);
+
+	ret = EINA_TRUE;
+
+end:
+	eina_list_free(c_list.list);
+	eet_data_descriptor_free(edd);
+	eet_data_descriptor_free(edd_list);
+	return ret;
+}
+
+static void _import_free(Import *imp)
+{
+	Contact_Info **itr;
+
+	EINA_INARRAY_FOREACH(imp->contacts, itr) {
+		Contact_Info *c_info = *itr;
+		eina_stringshare_del(c_info->first_name);
+		eina_stringshare_del(c_info->last_name);
+		eina_stringshare_del(c_info->work);
+		eina_stringshare_del(c_info->home);
+		eina_stringshare_del(c_info->mobile);
+		eina_stringshare_del(c_info->picture);
+		free(c_info);
+	}
+	eina_inarray_free(imp->contacts);
+}
+
+int main(int argc, char **argv)
+{
+	int args, i;
+	char *output = NULL, *format_str = NULL;
+	char dir[PATH_MAX];
+	Eina_Bool quit_option = EINA_FALSE;
+	Format format = FORMAT_AUTO;
+	Import imp;
+	Ecore_Getopt_Value values[] = {
+		ECORE_GETOPT_VALUE_STR(output),
+		ECORE_GETOPT_VALUE_PTR_CAST(format_str),
+		ECORE_GETOPT_VALUE_BOOL(imp.verbose),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_NONE
+	};
+
+	memset(&imp, 0, sizeof(imp));
+
+	eina_init();
+	ecore_init();
+	ecore_file_init();
+	efreet_init();
+	eet_init();
+
+	_log_domain = eina_log_domain_register("contacts-import", NULL);
+	if (_log_domain < 0) {
+		EINA_LOG_CRIT("Could not create log domain 'contacts-import'.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	args = ecore_getopt_parse(&options, values, argc, argv);
+	if (args < 0) {
+		ERR("Could not parse command line options.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (quit_option)
+		goto end;
+
+	if (args >= argc) {
+		ecore_getopt_help(stderr, &options);
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (format_str && strcmp(format_str, "csv") == 0)
+		format = FORMAT_CSV;
+	else if (format_str && strcmp(format_str, "vcard") == 0)
+		format = FORMAT_VCARD;
+
+	if (output)
+		eina_strlcpy(dir, output, sizeof(dir));
+	else
+		snprintf(dir, sizeof(dir), "%s/%s", efreet_config_home_get(),
+				PACKAGE_NAME);
+	ecore_file_mkpath(dir);
+
+	imp.contacts = eina_inarray_new(sizeof(Contact_Info *), 1024);
+	if (!imp.contacts) {
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	for (i = args; i < argc; i++) {
+		if (!_file_import(&imp, argv[i], format)) {
+			_app_exit_code = EXIT_FAILURE;
+			goto end_import;
+		}
+	}
+
+	if (!_database_write(&imp, dir)) {
+		_app_exit_code = EXIT_FAILURE;
+		goto end_import;
+	}
+
+	printf("Imported %u contacts (%u skipped) into %s/contacts.eet\n",
+		eina_inarray_count(imp.contacts), imp.skipped, dir);
+
+end_import:
+	_import_free(&imp);
+end:
+	if (_log_domain >= 0)
+		eina_log_domain_unregister(_log_domain);
+	eet_shutdown();
+	efreet_shutdown();
+	ecore_file_shutdown();
+	ecore_shutdown();
+	eina_shutdown();
+	return _app_exit_code;
+}
@@ -0,0 +1,549 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Elementary.h>
+#include <E_DBus.h>
+#include <Ecore_Getopt.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "ofono.h"
+
+/*
+ * Signal handling throughput of utils/ofono.c, against the mock oFono
+ * of ofono-efl-mock-ofono.py ("make bench" runs both).
+ *
+ * Scenarios run one after the other once the modem is there:
+ *   modems  modems appearing, ModemAdded with all their properties;
+ *   storm   PropertyChanged of an incoming call;
+ *   sms     incoming messages;
+ *   sent    messages sent, until oFono says they are sent or failed.
+ * For each it prints the events handled per second and the CPU time
+ * and allocations per event, setup of the scenario not included.
+ */
+
+#define MOCK_PATH "/"
+#define MOCK_IFACE "org.ofono.Mock"
+
+typedef enum {
+	SCENARIO_MODEMS = 0,
+	SCENARIO_STORM,
+	SCENARIO_SMS,
+	SCENARIO_SENT,
+	SCENARIO_LAST
+} Scenario;
+
+typedef struct _Sample {
+	double wall;
+	double cpu;
+	unsigned long allocs;
+	unsigned long alloc_bytes;
+} Sample;
+
+typedef struct _Bench {
+	E_DBus_Connection *bus;
+	Scenario scenario;
+	unsigned int counts[SCENARIO_LAST];
+	unsigned int events;
+	Eina_Bool replied; /* signals of the mock are before its reply */
+	Eina_Bool started;
+	Sample start;
+	Ecore_Timer *timeout;
+	double timeout_secs;
+	OFono_Call *call;
+	Ecore_Job *next;
+} Bench;
+
+static const char *scenario_names[SCENARIO_LAST] = {
+	"modems", "storm", "sms", "sent"
+};
+
+static const Ecore_Getopt options = {
+	"ofono-efl-bench",
+	"%prog [options]",
+	PACKAGE_VERSION,
+	"(C) 2012 Intel Corporation",
+	"GPL-2" /* TODO: check license with Intel */,
+	"Benchmarks oFono signal handling against ofono-efl-mock-ofono.py, "
+	"scenarios with a count of 0 are skipped.",
+	EINA_FALSE,
+	{ECORE_GETOPT_STORE_UINT('m', "modems", "modems to add."),
+	 ECORE_GETOPT_STORE_UINT('s', "storm",
+					"PropertyChanged signals of a call."),
+	 ECORE_GETOPT_STORE_UINT('i', "sms", "incoming messages."),
+	 ECORE_GETOPT_STORE_UINT('o', "sent", "messages to send."),
+	 ECORE_GETOPT_STORE_DOUBLE('t', "timeout",
+					"seconds a scenario may take."),
+	 ECORE_GETOPT_VERSION('V', "version"),
+	 ECORE_GETOPT_COPYRIGHT('C', "copyright"),
+	 ECORE_GETOPT_LICENSE('L', "license"),
+	 ECORE_GETOPT_HELP('h', "help"),
+	 ECORE_GETOPT_SENTINEL
+	}
+};
+
+int _log_domain = -1;
+int _app_exit_code = EXIT_SUCCESS;
+
+static unsigned long _allocs = 0;
+static unsigned long _alloc_bytes = 0;
+
+#ifdef __GLIBC__
+/* glibc lets programs replace malloc, count and forward to its own.
+ * Its strdup, asprintf, fopen and the like call the replacement, the
+ * aligned allocators do not and are replaced too. mmap is not counted.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+
+void *malloc(size_t size)
+{
+	__sync_fetch_and_add(&_allocs, 1);
+	__sync_fetch_and_add(&_alloc_bytes, size);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	__sync_fetch_and_add(&_allocs, 1);
+	__sync_fetch_and_add(&_alloc_bytes, nmemb * size);
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	__sync_fetch_and_add(&_allocs, 1);
+	__sync_fetch_and_add(&_alloc_bytes, size);
+	return __libc_realloc(ptr, size);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+	__sync_fetch_and_add(&_allocs, 1);
+	__sync_fetch_and_add(&_alloc_bytes, size);
+	return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+int posix_memalign(void **ret, size_t alignment, size_t size)
+{
+	void *p;
+
+	if ((alignment % sizeof(void *)) || (alignment & (alignment - 1)))
+		return EINVAL;
+
+	p = memalign(alignment, size);
+	if (!p)
+		return ENOMEM;
+	*ret = p;
+	return 0;
+}
+
+void *valloc(size_t size)
+{
+	return memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+void *pvalloc(size_t size)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	return memalign(page, (size + page - 1) & ~(page - 1));
+}
+
+#define ALLOCS_COUNTED EINA_TRUE
+#else
+#define ALLOCS_COUNTED EINA_FALSE
+#endif
+
+static void _sample_get(Sample *s)
+{
+	struct rusage ru;
+
+	s->wall = ecore_time_get();
+	s->allocs = _allocs;
+	s->alloc_bytes = _alloc_bytes;
+
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		s->cpu = ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+			(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+	else
+		s->cpu = 0.0;
+}
+
+static void _report_header(void)
+{
+	printf("%-8s %8s %8s %10s %10s %10s %10s\n", "scenario", "events",
+		"wall s", "events/s", "cpu us/ev", "allocs/ev", "bytes/ev");
+}
+
+static void _report(const Bench *b, const Sample *end)
+{
+	double wall = end->wall - b->start.wall;
+	double events = b->events ? b->events : 1;
+
+	printf("%-8s %8u %8.3f %10.0f %10.1f",
+		scenario_names[b->scenario], b->events, wall,
+		wall > 0.0 ? b->events / wall : 0.0,
+		(end->cpu - b->start.cpu) * 1e6 / events);
+	if (ALLOCS_COUNTED)
+		printf(" %10.1f %10.0f\n",
+			(end->allocs - b->start.allocs) / events,
+			(end->alloc_bytes - b->start.alloc_bytes) / events);
+	else
+		printf(" %10s %10s\n", "-", "-");
+	fflush(stdout);
+}
+
+static void _scenario_run(void *data);
+
+static void _scenario_end(Bench *b)
+{
+	Sample end;
+
+	_sample_get(&end);
+	_report(b, &end);
+
+	if (b->timeout) {
+		ecore_timer_del(b->timeout);
+		b->timeout = NULL;
+	}
+
+	b->scenario++;
+	if (!b->next)
+		b->next = ecore_job_add(_scenario_run, b);
+}
+
+static void _scenario_check(Bench *b)
+{
+	if ((b->replied) && (b->events >= b->counts[b->scenario]))
+		_scenario_end(b);
+}
+
+static void _measure_start(Bench *b)
+{
+	b->events = 0;
+	b->replied = EINA_FALSE;
+	_sample_get(&b->start);
+}
+
+static void _mock_reply(void *data, DBusMessage *msg, DBusError *err)
+{
+	Bench *b = data;
+
+	if (!msg) {
+		if (err)
+			ERR("Mock failed: %s: %s", err->name, err->message);
+		else
+			ERR("No reply from the mock");
+		_app_exit_code = EXIT_FAILURE;
+		ecore_main_loop_quit();
+		return;
+	}
+
+	b->replied = EINA_TRUE;
+	_scenario_check(b);
+}
+
+/* without cb the reply is ignored */
+static Eina_Bool _mock_call(Bench *b, const char *method,
+				E_DBus_Method_Return_Cb cb, int type, ...)
+{
+	DBusMessage *msg;
+	DBusPendingCall *pc;
+	va_list ap;
+	Eina_Bool ok;
+
+	msg = dbus_message_new_method_call("org.ofono", MOCK_PATH, MOCK_IFACE,
+						method);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(msg, EINA_FALSE);
+
+	va_start(ap, type);
+	ok = dbus_message_append_args_valist(msg, type, ap);
+	va_end(ap);
+	if (!ok) {
+		ERR("Could not append arguments of %s", method);
+		dbus_message_unref(msg);
+		return EINA_FALSE;
+	}
+
+	pc = e_dbus_message_send(b->bus, msg, cb, -1, b);
+	dbus_message_unref(msg);
+	if (!pc) {
+		ERR("Could not call %s on the mock", method);
+		return EINA_FALSE;
+	}
+	return EINA_TRUE;
+}
+
+static Eina_Bool _mock_count_call(Bench *b, const char *method)
+{
+	dbus_uint32_t count = b->counts[b->scenario];
+
+	_measure_start(b);
+	return _mock_call(b, method, _mock_reply, DBUS_TYPE_UINT32, &count,
+				DBUS_TYPE_INVALID);
+}
+
+static void _sms_sent(void *data, OFono_Error err,
+			OFono_Sent_SMS *sms __UNUSED__)
+{
+	Bench *b = data;
+
+	if (err != OFONO_ERROR_NONE) {
+		/* no state change will come for this one */
+		WRN("Could not send: %s", ofono_error_message_get(err));
+		b->events++;
+		_scenario_check(b);
+	}
+}
+
+static Eina_Bool _scenario_start(Bench *b)
+{
+	const char *number = "5551234", *name = "Bench";
+	unsigned int i;
+
+	switch (b->scenario) {
+	case SCENARIO_MODEMS:
+		return _mock_count_call(b, "AddModems");
+	case SCENARIO_STORM:
+		/* storm starts once the call is there */
+		b->call = NULL;
+		return _mock_call(b, "IncomingCall", NULL,
+					DBUS_TYPE_STRING, &number,
+					DBUS_TYPE_STRING, &name,
+					DBUS_TYPE_INVALID);
+	case SCENARIO_SMS:
+		return _mock_count_call(b, "IncomingMessages");
+	case SCENARIO_SENT:
+		_measure_start(b);
+		for (i = 0; i < b->counts[b->scenario]; i++) {
+			if (!ofono_sms_send(number, "Bench message",
+						_sms_sent, b))
+				return EINA_FALSE;
+		}
+		b->replied = EINA_TRUE;
+		return EINA_TRUE;
+	default:
+		return EINA_FALSE;
+	}
+}
+
+static Eina_Bool _scenario_timeout(void *data)
+{
+	Bench *b = data;
+
+	if (!b->started)
+		ERR("No modem after %.1f seconds, is the mock running?",
+			b->timeout_secs);
+	else
+		ERR("%s timed out, %u of %u events",
+			scenario_names[b->scenario], b->events,
+			b->counts[b->scenario]);
+	b->timeout = NULL;
+	_app_exit_code = EXIT_FAILURE;
+	ecore_main_loop_quit();
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _scenario_run(void *data)
+{
+	Bench *b = data;
+
+	b->next = NULL;
+
+	if ((b->scenario > SCENARIO_STORM) && (b->call)) {
+		_mock_call(b, "HangupCall", NULL, DBUS_TYPE_INVALID);
+		b->call = NULL;
+	}
+
+	while ((b->scenario < SCENARIO_LAST) && (!b->counts[b->scenario]))
+		b->scenario++;
+
+	if (b->scenario == SCENARIO_LAST) {
+		ecore_main_loop_quit();
+		return;
+	}
+
+	b->timeout = ecore_timer_add(b->timeout_secs, _scenario_timeout, b);
+	if (!_scenario_start(b)) {
+		ERR("Could not start %s", scenario_names[b->scenario]);
+		_app_exit_code = EXIT_FAILURE;
+		ecore_main_loop_quit();
+	}
+}
+
+static void _modem_connected(void *data)
+{
+	Bench *b = data;
+
+	if (b->started)
+		return;
+	b->started = EINA_TRUE;
+
+	if (b->timeout) {
+		ecore_timer_del(b->timeout);
+		b->timeout = NULL;
+	}
+
+	_report_header();
+	b->next = ecore_job_add(_scenario_run, b);
+}
+
+static void _modem_changed(void *data)
+{
+	Bench *b = data;
+
+	if (b->scenario != SCENARIO_MODEMS)
+		return;
+	b->events++;
+	_scenario_check(b);
+}
+
+static void _call_added(void *data, OFono_Call *call)
+{
+	Bench *b = data;
+
+	if ((b->scenario != SCENARIO_STORM) || (b->call))
+		return;
+
+	b->call = call;
+	if (!_mock_count_call(b, "Storm")) {
+		_app_exit_code = EXIT_FAILURE;
+		ecore_main_loop_quit();
+	}
+}
+
+static void _call_changed(void *data, OFono_Call *call)
+{
+	Bench *b = data;
+
+	if ((b->scenario != SCENARIO_STORM) || (call != b->call))
+		return;
+	b->events++;
+	_scenario_check(b);
+}
+
+static void _incoming_sms(void *data, unsigned int sms_class __UNUSED__,
+				time_t timestamp __UNUSED__,
+				const char *sender __UNUSED__,
+				const char *message __UNUSED__)
+{
+	Bench *b = data;
+
+	if (b->scenario != SCENARIO_SMS)
+		return;
+	b->events++;
+	_scenario_check(b);
+}
+
+static void _sent_sms_changed(void *data, OFono_Error err __UNUSED__,
+				OFono_Sent_SMS *sms)
+{
+	Bench *b = data;
+
+	if ((b->scenario != SCENARIO_SENT) ||
+		(ofono_sent_sms_state_get(sms) == OFONO_SENT_SMS_STATE_PENDING))
+		return;
+	b->events++;
+	_scenario_check(b);
+}
+
+int main(int argc, char **argv)
+{
+	int args;
+	Eina_Bool quit_option = EINA_FALSE;
+	Bench bench;
+	Ecore_Getopt_Value values[] = {
+		ECORE_GETOPT_VALUE_UINT(bench.counts[SCENARIO_MODEMS]),
+		ECORE_GETOPT_VALUE_UINT(bench.counts[SCENARIO_STORM]),
+		ECORE_GETOPT_VALUE_UINT(bench.counts[SCENARIO_SMS]),
+		ECORE_GETOPT_VALUE_UINT(bench.counts[SCENARIO_SENT]),
+		ECORE_GETOPT_VALUE_DOUBLE(bench.timeout_secs),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_NONE
+	};
+
+	memset(&bench, 0, sizeof(bench));
+	bench.counts[SCENARIO_MODEMS] = 50;
+	bench.counts[SCENARIO_STORM] = 10000;
+	bench.counts[SCENARIO_SMS] = 10000;
+	bench.counts[SCENARIO_SENT] = 1000;
+	bench.timeout_secs = 60.0;
+
+	elm_init(argc, argv);
+
+	_log_domain = eina_log_domain_register("ofono-efl-bench", NULL);
+	if (_log_domain < 0) {
+		EINA_LOG_CRIT("Could not create log domain 'ofono-efl-bench'.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	args = ecore_getopt_parse(&options, values, argc, argv);
+	if (args < 0) {
+		ERR("Could not parse command line options.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (quit_option)
+		goto end;
+
+	if (!ofono_init()) {
+		CRITICAL("Could not setup ofono");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	ofono_modem_api_require("VoiceCallManager,MessageManager");
+	ofono_modem_type_require("hfp");
+
+	bench.bus = e_dbus_bus_get(DBUS_BUS_SYSTEM);
+	if (!bench.bus) {
+		CRITICAL("Could not get DBus System Bus");
+		_app_exit_code = EXIT_FAILURE;
+		goto end_ofono;
+	}
+
+	ofono_modem_conected_cb_add(_modem_connected, &bench);
+	ofono_modem_changed_cb_add(_modem_changed, &bench);
+	ofono_call_added_cb_add(_call_added, &bench);
+	ofono_call_changed_cb_add(_call_changed, &bench);
+	ofono_incoming_sms_cb_add(_incoming_sms, &bench);
+	ofono_sent_sms_changed_cb_add(_sent_sms_changed, &bench);
+
+	bench.timeout = ecore_timer_add(bench.timeout_secs, _scenario_timeout,
+					&bench);
+
+	ecore_main_loop_begin();
+
+	if (bench.timeout)
+		ecore_timer_del(bench.timeout);
+	if (bench.next)
+		ecore_job_del(bench.next);
+
+end_ofono:
+	ofono_shutdown();
+end:
+	if (_log_domain >= 0)
+		eina_log_domain_unregister(_log_domain);
+	elm_shutdown();
+	return _app_exit_code;
+}
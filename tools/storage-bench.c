@@ -0,0 +1,371 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <Ecore.h>
+#include <Ecore_File.h>
+#include <Ecore_Getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "log.h"
+#include "ofono.h"
+#include "history-store.h"
+#include "store.h"
+
+/*
+ * Cost of the call history and message stores, without any UI.
+ *
+ * Writes a synthetic history or set of conversations of the given size
+ * in one go, opens it again and appends to it one record at a time,
+ * each append saved on its own as the dialer and messages do. Prints
+ * the time of each step, the size of the files and the peak RSS of the
+ * process, so run one store and size per process.
+ */
+
+#define HISTORY_FILE "history.eet"
+
+static const char *stores[] = {"history", "messages", NULL};
+
+static const char *message_files[] = {"messages.store", "messages.index"};
+
+static const Ecore_Getopt options = {
+	"ofono-efl-storage-bench",
+	"%prog [options]",
+	PACKAGE_VERSION,
+	"(C) 2012 Intel Corporation",
+	"GPL-2" /* TODO: check license with Intel */,
+	"Benchmarks loading and saving of the call history and messages.",
+	EINA_FALSE,
+	{ECORE_GETOPT_CHOICE('s', "store", "store to benchmark.", stores),
+	 ECORE_GETOPT_STORE_UINT('r', "records", "calls or messages."),
+	 ECORE_GETOPT_STORE_UINT('t', "threads",
+					"conversations the messages are in."),
+	 ECORE_GETOPT_STORE_UINT('a', "appends",
+					"records appended after loading."),
+	 ECORE_GETOPT_STORE_STR('d', "dir",
+				"directory for the files, a temporary one "
+				"is used and removed if not given."),
+	 ECORE_GETOPT_STORE_TRUE('n', "no-header", "only print results."),
+	 ECORE_GETOPT_VERSION('V', "version"),
+	 ECORE_GETOPT_COPYRIGHT('C', "copyright"),
+	 ECORE_GETOPT_LICENSE('L', "license"),
+	 ECORE_GETOPT_HELP('h', "help"),
+	 ECORE_GETOPT_SENTINEL
+	}
+};
+
+int _log_domain = -1;
+int _app_exit_code = EXIT_SUCCESS;
+
+typedef struct _Bench {
+	const char *dir;
+	unsigned int records;
+	unsigned int threads;
+	unsigned int appends;
+	double save; /* seconds */
+	double load;
+	double append;
+	unsigned long long size; /* bytes */
+} Bench;
+
+static const char *words[] = {
+	"call", "me", "when", "you", "get", "this", "meeting", "moved",
+	"to", "tomorrow", "at", "the", "office", "see", "running", "late",
+	"dinner", "tonight", "ok", "thanks"
+};
+
+static const char *_number_get(char *buf, size_t size, unsigned int i)
+{
+	snprintf(buf, size, "555%07u", i);
+	return buf;
+}
+
+/* a few words picked by i, so the search index has some work */
+static const char *_content_get(char *buf, size_t size, unsigned int i)
+{
+	unsigned int n = EINA_C_ARRAY_LENGTH(words), w, len = 0;
+
+	buf[0] = '\0';
+	for (w = 0; w < 8; w++) {
+		int r = snprintf(buf + len, size - len, "%s%s",
+					w ? " " : "", words[(i * 7 + w * 3) % n]);
+		if ((r < 0) || ((size_t)r >= size - len))
+			break;
+		len += r;
+	}
+	snprintf(buf + len, size - len, " #%u", i);
+	return buf;
+}
+
+static unsigned long long _file_size(const char *dir, const char *name)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	if (stat(path, &st) < 0)
+		return 0;
+	return st.st_size;
+}
+
+static void _history_call_fill(History_Call *call, unsigned int i,
+				long long now)
+{
+	char buf[32];
+
+	call->start_time = now - i * 60;
+	call->end_time = call->start_time + 30;
+	call->line_id = eina_stringshare_add(_number_get(buf, sizeof(buf),
+								i % 1000));
+	call->name = eina_stringshare_add("");
+	call->completed = (i % 3) != 0;
+	call->incoming = (i % 2) == 0;
+}
+
+static Eina_Bool _history_bench(Bench *b)
+{
+	History_Store *store;
+	History_Call *call;
+	char path[PATH_MAX];
+	long long now = time(NULL);
+	unsigned int i;
+	double t;
+
+	snprintf(path, sizeof(path), "%s/%s", b->dir, HISTORY_FILE);
+
+	store = history_store_new(path, sizeof(History_Call), NULL);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	history_store_clear(store);
+	/* oldest first, the store keeps the newest first */
+	for (i = b->records; i > 0; i--) {
+		call = history_store_call_add(store);
+		EINA_SAFETY_ON_NULL_GOTO(call, err);
+		_history_call_fill(call, i - 1 + b->appends, now);
+	}
+
+	t = ecore_time_get();
+	if (!history_store_save(store))
+		goto err;
+	history_store_free(store);
+	b->save = ecore_time_get() - t;
+
+	t = ecore_time_get();
+	store = history_store_new(path, sizeof(History_Call), NULL);
+	b->load = ecore_time_get() - t;
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+	if (eina_list_count(history_store_calls_get(store)) != b->records) {
+		ERR("Read %u calls of %u",
+			eina_list_count(history_store_calls_get(store)),
+			b->records);
+		goto err;
+	}
+
+	b->size = _file_size(b->dir, HISTORY_FILE);
+
+	t = ecore_time_get();
+	for (i = b->appends; i > 0; i--) {
+		call = history_store_call_add(store);
+		EINA_SAFETY_ON_NULL_GOTO(call, err);
+		_history_call_fill(call, i - 1, now);
+		if (!history_store_save(store))
+			goto err;
+	}
+	b->append = ecore_time_get() - t;
+
+	history_store_free(store);
+	return EINA_TRUE;
+
+err:
+	history_store_free(store);
+	return EINA_FALSE;
+}
+
+static Eina_Bool _messages_save(Message_Store *store, const Bench *b,
+				unsigned int i, long long now)
+{
+	char number[32], content[256];
+
+	/* i is spread over the threads, times grow in each */
+	return message_store_message_save(store,
+				_number_get(number, sizeof(number),
+						i % b->threads),
+				message_store_message_id_new(store), now + i,
+				_content_get(content, sizeof(content), i),
+				(i % 2) == 0, OFONO_SENT_SMS_STATE_SENT);
+}
+
+static unsigned long long _messages_size(const char *dir)
+{
+	unsigned long long size = 0;
+	unsigned int i;
+
+	for (i = 0; i < EINA_C_ARRAY_LENGTH(message_files); i++)
+		size += _file_size(dir, message_files[i]);
+	return size;
+}
+
+static Eina_Bool _messages_bench(Bench *b)
+{
+	Message_Store *store;
+	long long now = time(NULL) - b->records - b->appends;
+	char path[PATH_MAX];
+	unsigned int i;
+	double t;
+
+	/* start empty if the directory was used before */
+	for (i = 0; i < EINA_C_ARRAY_LENGTH(message_files); i++) {
+		snprintf(path, sizeof(path), "%s/%s", b->dir,
+				message_files[i]);
+		unlink(path);
+	}
+
+	store = message_store_new(b->dir);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+
+	/* the index is written when the store is freed */
+	t = ecore_time_get();
+	message_store_begin(store);
+	for (i = 0; i < b->records; i++) {
+		if (!_messages_save(store, b, i, now))
+			break;
+	}
+	if (!message_store_commit(store) || (i < b->records)) {
+		ERR("Could not save %u messages", b->records);
+		message_store_free(store);
+		return EINA_FALSE;
+	}
+	message_store_free(store);
+	b->save = ecore_time_get() - t;
+
+	t = ecore_time_get();
+	store = message_store_new(b->dir);
+	b->load = ecore_time_get() - t;
+	EINA_SAFETY_ON_NULL_RETURN_VAL(store, EINA_FALSE);
+
+	b->size = _messages_size(b->dir);
+
+	t = ecore_time_get();
+	for (i = b->records; i < b->records + b->appends; i++) {
+		if (!_messages_save(store, b, i, now)) {
+			ERR("Could not append message %u", i);
+			message_store_free(store);
+			return EINA_FALSE;
+		}
+	}
+	b->append = ecore_time_get() - t;
+
+	message_store_free(store);
+	return EINA_TRUE;
+}
+
+static long _peak_rss_get(void)
+{
+	struct rusage ru;
+
+	if (getrusage(RUSAGE_SELF, &ru) < 0)
+		return 0;
+	return ru.ru_maxrss; /* KiB on Linux */
+}
+
+int main(int argc, char **argv)
+{
+	int args;
+	char *store = NULL, *dir = NULL, tmp[] = "/tmp/ofono-efl-bench-XXXXXX";
+	Eina_Bool quit_option = EINA_FALSE, no_header = EINA_FALSE, ok;
+	Bench bench;
+	Ecore_Getopt_Value values[] = {
+		ECORE_GETOPT_VALUE_STR(store),
+		ECORE_GETOPT_VALUE_UINT(bench.records),
+		ECORE_GETOPT_VALUE_UINT(bench.threads),
+		ECORE_GETOPT_VALUE_UINT(bench.appends),
+		ECORE_GETOPT_VALUE_STR(dir),
+		ECORE_GETOPT_VALUE_BOOL(no_header),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_NONE
+	};
+
+	memset(&bench, 0, sizeof(bench));
+	bench.records = 10000;
+	bench.threads = 100;
+	bench.appends = 100;
+
+	eina_init();
+	ecore_init();
+	ecore_file_init();
+
+	_log_domain = eina_log_domain_register("storage-bench", NULL);
+	if (_log_domain < 0) {
+		EINA_LOG_CRIT("Could not create log domain 'storage-bench'.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	args = ecore_getopt_parse(&options, values, argc, argv);
+	if (args < 0) {
+		ERR("Could not parse command line options.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (quit_option)
+		goto end;
+
+	if (!store)
+		store = (char *)stores[0];
+	if (bench.threads == 0)
+		bench.threads = 1;
+
+	if (dir) {
+		ecore_file_mkpath(dir);
+		bench.dir = dir;
+	} else {
+		bench.dir = mkdtemp(tmp);
+		if (!bench.dir) {
+			ERR("Could not create a temporary directory");
+			_app_exit_code = EXIT_FAILURE;
+			goto end;
+		}
+	}
+
+	if (strcmp(store, "messages") == 0)
+		ok = _messages_bench(&bench);
+	else
+		ok = _history_bench(&bench);
+
+	if (!dir)
+		ecore_file_recursive_rm(bench.dir);
+
+	if (!ok) {
+		ERR("Could not benchmark the %s store", store);
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (!no_header)
+		printf("%-8s %8s %10s %10s %12s %10s %10s\n", "store",
+			"records", "save ms", "load ms", "append us",
+			"size KiB", "rss KiB");
+	printf("%-8s %8u %10.1f %10.1f %12.1f %10llu %10ld\n", store,
+		bench.records, bench.save * 1000.0, bench.load * 1000.0,
+		bench.appends ? bench.append * 1e6 / bench.appends : 0.0,
+		bench.size / 1024, _peak_rss_get());
+
+end:
+	if (_log_domain >= 0)
+		eina_log_domain_unregister(_log_domain);
+	ecore_file_shutdown();
+	ecore_shutdown();
+	eina_shutdown();
+	return _app_exit_code;
+}
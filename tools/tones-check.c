@@ -0,0 +1,438 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Elementary.h>
+#include <E_DBus.h>
+#include <Ecore_Getopt.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "ofono.h"
+
+/*
+ * Checks the DTMF queue of utils/ofono.c against the mock oFono of
+ * ofono-efl-mock-ofono.py ("make check-tones" runs both).
+ *
+ * Once a call is active each case pushes its tones one by one, then
+ * compares what the mock got with what is expected:
+ *   order     a burst while oFono is busy, sent in order in one go;
+ *   coalesce  tones a short while apart go in the same SendTones;
+ *   depth     no more SendTones in flight than the queue allows.
+ * The queue must report the same SendTones, all tones sent and none
+ * failed. Exits with failure if any case does not match.
+ */
+
+#define MOCK_PATH "/"
+#define MOCK_IFACE "org.ofono.Mock"
+
+typedef struct _Tones_Case {
+	const char *name;
+	unsigned int depth;
+	double coalesce;
+	double tone; /* seconds the mock plays each tone */
+	double interval; /* between pushes, 0.0 pushes all at once */
+	const char *tones; /* each one pushed alone */
+	const char *calls; /* SendTones expected, space separated */
+	unsigned int in_flight; /* most SendTones expected at once */
+} Tones_Case;
+
+typedef struct _Check {
+	E_DBus_Connection *bus;
+	unsigned int current;
+	unsigned int pushed;
+	unsigned int sent;
+	OFono_Tones_Queue *queue;
+	Eina_Strbuf *replied; /* tones of each reply, space separated */
+	OFono_Call *call;
+	Eina_Bool started;
+	Ecore_Timer *pusher;
+	Ecore_Timer *timeout;
+	double timeout_secs;
+	unsigned int failed;
+	Ecore_Job *next;
+} Check;
+
+static const Tones_Case cases[] = {
+	/* the first is sent right away, the rest waits for its reply */
+	{"order", 1, 0.0, 0.05, 0.0, "1234567890*#", "1 234567890*#", 1},
+	/* 2, 3 and 4 wait for each other while 1 plays */
+	{"coalesce", 4, 0.3, 0.5, 0.05, "1234", "1 234", 2},
+	/* 1 and 2 are sent at once, 3 to 5 wait for a free slot */
+	{"depth", 2, 0.0, 0.2, 0.01, "12345", "1 2 345", 2},
+};
+
+#define CASES_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+static const Ecore_Getopt options = {
+	"ofono-efl-tones-check",
+	"%prog [options]",
+	PACKAGE_VERSION,
+	"(C) 2012 Intel Corporation",
+	"GPL-2" /* TODO: check license with Intel */,
+	"Checks the DTMF queue against ofono-efl-mock-ofono.py.",
+	EINA_FALSE,
+	{ECORE_GETOPT_STORE_DOUBLE('t', "timeout",
+					"seconds all cases may take."),
+	 ECORE_GETOPT_VERSION('V', "version"),
+	 ECORE_GETOPT_COPYRIGHT('C', "copyright"),
+	 ECORE_GETOPT_LICENSE('L', "license"),
+	 ECORE_GETOPT_HELP('h', "help"),
+	 ECORE_GETOPT_SENTINEL
+	}
+};
+
+int _log_domain = -1;
+int _app_exit_code = EXIT_SUCCESS;
+
+static void _check_fail(Check *c, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("%-8s FAIL: ", cases[c->current].name);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	putchar('\n');
+	fflush(stdout);
+	c->failed++;
+}
+
+static void _check_abort(Check *c)
+{
+	c->failed++;
+	ecore_main_loop_quit();
+}
+
+/* without cb the reply is ignored */
+static Eina_Bool _mock_call(Check *c, const char *method,
+				E_DBus_Method_Return_Cb cb, int type, ...)
+{
+	DBusMessage *msg;
+	DBusPendingCall *pc;
+	va_list ap;
+	Eina_Bool ok;
+
+	msg = dbus_message_new_method_call("org.ofono", MOCK_PATH, MOCK_IFACE,
+						method);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(msg, EINA_FALSE);
+
+	va_start(ap, type);
+	ok = dbus_message_append_args_valist(msg, type, ap);
+	va_end(ap);
+	if (!ok) {
+		ERR("Could not append arguments of %s", method);
+		dbus_message_unref(msg);
+		return EINA_FALSE;
+	}
+
+	pc = e_dbus_message_send(c->bus, msg, cb, -1, c);
+	dbus_message_unref(msg);
+	if (!pc) {
+		ERR("Could not call %s on the mock", method);
+		return EINA_FALSE;
+	}
+	return EINA_TRUE;
+}
+
+static void _case_run(void *data);
+
+static void _case_end(Check *c)
+{
+	if (c->pusher) {
+		ecore_timer_del(c->pusher);
+		c->pusher = NULL;
+	}
+	if (c->queue) {
+		ofono_tones_queue_free(c->queue);
+		c->queue = NULL;
+	}
+
+	c->current++;
+	if (!c->next)
+		c->next = ecore_job_add(_case_run, c);
+}
+
+static void _tones_taken(void *data, DBusMessage *msg, DBusError *err)
+{
+	const Tones_Case *tc;
+	OFono_Tones_Queue_Stats stats;
+	Check *c = data;
+	const char *calls;
+	dbus_uint32_t in_flight;
+	unsigned int failed;
+
+	if (!msg) {
+		ERR("TakeTones failed: %s", err ? err->message : "no reply");
+		_check_abort(c);
+		return;
+	}
+
+	if (!dbus_message_get_args(msg, err, DBUS_TYPE_STRING, &calls,
+					DBUS_TYPE_UINT32, &in_flight,
+					DBUS_TYPE_INVALID)) {
+		ERR("Could not get the tones of the mock");
+		_check_abort(c);
+		return;
+	}
+
+	tc = cases + c->current;
+	failed = c->failed;
+	if (strcmp(calls, tc->calls) != 0)
+		_check_fail(c, "mock got \"%s\", expected \"%s\"", calls,
+				tc->calls);
+	if (strcmp(eina_strbuf_string_get(c->replied), tc->calls) != 0)
+		_check_fail(c, "queue replied \"%s\", expected \"%s\"",
+				eina_strbuf_string_get(c->replied), tc->calls);
+	if (in_flight != tc->in_flight)
+		_check_fail(c, "%u SendTones in flight at once, expected %u",
+				in_flight, tc->in_flight);
+
+	ofono_tones_queue_stats_get(c->queue, &stats);
+	if ((stats.queued != c->pushed) || (stats.sent != c->pushed) ||
+		(stats.failed))
+		_check_fail(c, "stats: %u queued, %u sent, %u failed of %u",
+				stats.queued, stats.sent, stats.failed,
+				c->pushed);
+
+	if (failed == c->failed)
+		printf("%-8s ok: \"%s\", %u SendTones, %u in flight, "
+			"latency avg %0.3fs max %0.3fs\n", tc->name, calls,
+			stats.calls, in_flight, stats.latency_avg,
+			stats.latency_max);
+	fflush(stdout);
+
+	_case_end(c);
+}
+
+static void _tones_replied(void *data, const char *tones, OFono_Error err)
+{
+	Check *c = data;
+
+	if (err != OFONO_ERROR_NONE)
+		_check_fail(c, "SendTones(%s) failed: %s", tones,
+				ofono_error_message_get(err));
+
+	if (eina_strbuf_length_get(c->replied) > 0)
+		eina_strbuf_append_char(c->replied, ' ');
+	eina_strbuf_append(c->replied, tones);
+
+	c->sent += strlen(tones);
+	if (c->sent < strlen(cases[c->current].tones))
+		return;
+
+	if (!_mock_call(c, "TakeTones", _tones_taken, DBUS_TYPE_INVALID))
+		_check_abort(c);
+}
+
+static Eina_Bool _tone_push(void *data)
+{
+	Check *c = data;
+	const Tones_Case *tc = cases + c->current;
+	char tone[2] = { tc->tones[c->pushed], '\0' };
+
+	if (!ofono_tones_queue_push(c->queue, tone)) {
+		_check_fail(c, "could not push %s", tone);
+		_check_abort(c);
+		c->pusher = NULL;
+		return ECORE_CALLBACK_CANCEL;
+	}
+
+	c->pushed++;
+	if (tc->tones[c->pushed] != '\0')
+		return ECORE_CALLBACK_RENEW;
+
+	c->pusher = NULL;
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _tone_time_set(void *data, DBusMessage *msg, DBusError *err)
+{
+	Check *c = data;
+	const Tones_Case *tc = cases + c->current;
+
+	if (!msg) {
+		ERR("SetToneTime failed: %s", err ? err->message : "no reply");
+		_check_abort(c);
+		return;
+	}
+
+	c->pushed = 0;
+	c->sent = 0;
+	eina_strbuf_reset(c->replied);
+	c->queue = ofono_tones_queue_new(tc->depth, tc->coalesce,
+						_tones_replied, c);
+	if (!c->queue) {
+		_check_abort(c);
+		return;
+	}
+
+	if (tc->interval > 0.0) {
+		/* the first one is pushed right away */
+		if (_tone_push(c) == ECORE_CALLBACK_RENEW)
+			c->pusher = ecore_timer_add(tc->interval, _tone_push,
+							c);
+		return;
+	}
+
+	while ((tc->tones[c->pushed] != '\0') &&
+		(_tone_push(c) == ECORE_CALLBACK_RENEW))
+		;
+}
+
+static void _case_run(void *data)
+{
+	Check *c = data;
+
+	c->next = NULL;
+
+	if (c->current == CASES_COUNT) {
+		_mock_call(c, "HangupCall", NULL, DBUS_TYPE_INVALID);
+		ecore_main_loop_quit();
+		return;
+	}
+
+	if (!_mock_call(c, "SetToneTime", _tone_time_set,
+			DBUS_TYPE_DOUBLE, &cases[c->current].tone,
+			DBUS_TYPE_INVALID))
+		_check_abort(c);
+}
+
+static Eina_Bool _check_timeout(void *data)
+{
+	Check *c = data;
+
+	if (!c->call)
+		ERR("No active call after %.1f seconds, is the mock running?",
+			c->timeout_secs);
+	else
+		_check_fail(c, "timed out, %u of %u tones pushed, %u sent",
+				c->pushed,
+				(unsigned int)strlen(cases[c->current].tones),
+				c->sent);
+	c->timeout = NULL;
+	_check_abort(c);
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _modem_connected(void *data)
+{
+	const char *number = "5551234", *name = "Tones";
+	Check *c = data;
+
+	if (c->started)
+		return;
+	c->started = EINA_TRUE;
+
+	/* SendTones needs an active call, the mock answers in order */
+	if ((!_mock_call(c, "IncomingCall", NULL, DBUS_TYPE_STRING, &number,
+				DBUS_TYPE_STRING, &name, DBUS_TYPE_INVALID)) ||
+		(!_mock_call(c, "AnswerCall", NULL, DBUS_TYPE_INVALID)))
+		_check_abort(c);
+}
+
+static void _call_changed(void *data, OFono_Call *call)
+{
+	Check *c = data;
+
+	if ((c->call) ||
+		(ofono_call_state_get(call) != OFONO_CALL_STATE_ACTIVE))
+		return;
+
+	c->call = call;
+	c->next = ecore_job_add(_case_run, c);
+}
+
+int main(int argc, char **argv)
+{
+	int args;
+	Eina_Bool quit_option = EINA_FALSE;
+	Check check;
+	Ecore_Getopt_Value values[] = {
+		ECORE_GETOPT_VALUE_DOUBLE(check.timeout_secs),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_BOOL(quit_option),
+		ECORE_GETOPT_VALUE_NONE
+	};
+
+	memset(&check, 0, sizeof(check));
+	check.timeout_secs = 30.0;
+
+	elm_init(argc, argv);
+
+	_log_domain = eina_log_domain_register("ofono-efl-tones-check", NULL);
+	if (_log_domain < 0) {
+		EINA_LOG_CRIT("Could not create log domain "
+				"'ofono-efl-tones-check'.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	args = ecore_getopt_parse(&options, values, argc, argv);
+	if (args < 0) {
+		ERR("Could not parse command line options.");
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (quit_option)
+		goto end;
+
+	check.replied = eina_strbuf_new();
+	if (!check.replied) {
+		_app_exit_code = EXIT_FAILURE;
+		goto end;
+	}
+
+	if (!ofono_init()) {
+		CRITICAL("Could not setup ofono");
+		_app_exit_code = EXIT_FAILURE;
+		goto end_strbuf;
+	}
+
+	ofono_modem_api_require("VoiceCallManager");
+	ofono_modem_type_require("hfp");
+
+	check.bus = e_dbus_bus_get(DBUS_BUS_SYSTEM);
+	if (!check.bus) {
+		CRITICAL("Could not get DBus System Bus");
+		_app_exit_code = EXIT_FAILURE;
+		goto end_ofono;
+	}
+
+	ofono_modem_conected_cb_add(_modem_connected, &check);
+	ofono_call_changed_cb_add(_call_changed, &check);
+
+	check.timeout = ecore_timer_add(check.timeout_secs, _check_timeout,
+					&check);
+
+	ecore_main_loop_begin();
+
+	if (check.timeout)
+		ecore_timer_del(check.timeout);
+	if (check.next)
+		ecore_job_del(check.next);
+	if (check.pusher)
+		ecore_timer_del(check.pusher);
+	if (check.queue)
+		ofono_tones_queue_free(check.queue);
+
+	if (check.failed) {
+		printf("%u check(s) failed\n", check.failed);
+		_app_exit_code = EXIT_FAILURE;
+	}
+
+end_ofono:
+	ofono_shutdown();
+end_strbuf:
+	eina_strbuf_free(check.replied);
+end:
+	if (_log_domain >= 0)
+		eina_log_domain_unregister(_log_domain);
+	elm_shutdown();
+	return _app_exit_code;
+}
@@ -0,0 +1,50 @@
+#ifndef _EFL_OFONO_CONTACTS_DB_H__
+#define _EFL_OFONO_CONTACTS_DB_H__ 1
+
+/*
+ * On-disk layout of the desktop contacts database, shared by
+ * contacts.c and the ofono-efl-contacts-import tool.
+ */
+
+#define CONTACTS_ENTRY "contacts"
+
+typedef struct _Contacts Contacts;
+
+typedef struct _Contacts_List {
+	Eina_List *list;
+	Eina_Bool dirty;
+	Ecore_Poller *save_poller;
+} Contacts_List;
+
+struct _Contact_Info {
+	const char *first_name;
+	const char *last_name;
+	const char *full_name; /* not in edd */
+	const char *mobile;
+	const char *home;
+	const char *work;
+	const char *picture;
+
+	Eina_Bool mapped; /* not in edd, strings point into a snapshot */
+	Contacts *contacts; /* not in edd */
+	Elm_Object_Item *it; /* not in edd */
+	Eina_Inlist *on_del_cbs; /* not in edd */
+	Ecore_Idler *changed_idler; /* not in edd */
+	struct {
+		Eina_Inlist *listeners;
+		Eina_List *deleted;
+		int walking;
+	} on_changed_cbs; /* not in edd */
+};
+
+void contacts_db_descriptors_init(Eet_Data_Descriptor **edd,
+					Eet_Data_Descriptor **edd_list);
+
+/* order of the list in the database and of the snapshot records */
+int contacts_db_sort_cb(const void *v1, const void *v2);
+
+/* list must be sorted with contacts_db_sort_cb() and saved to source */
+Eina_Bool contacts_db_snapshot_write(const char *path, const char *source,
+					const Eina_List *list);
+
+#endif
@@ -0,0 +1,454 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "contacts-snapshot.h"
+
+#define SNAPSHOT_MAGIC "OECSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_NULL 0xffffffff
+#define SNAPSHOT_LETTERS 256
+
+typedef struct _Snapshot_Header {
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint32_t records_off; /* count * FIELD_LAST string offsets */
+	uint32_t letters_off; /* SNAPSHOT_LETTERS first record indexes */
+	uint32_t numbers_off; /* numbers_count Snapshot_Number */
+	uint32_t numbers_count;
+	uint32_t strings_off;
+	uint32_t strings_size;
+} Snapshot_Header;
+
+typedef struct _Snapshot_Number {
+	uint32_t str;
+	uint32_t ref; /* record * FIELD_LAST + field */
+} Snapshot_Number;
+
+struct _Contacts_Snapshot {
+	Eina_File *file;
+	const char *map;
+	const Snapshot_Header *header;
+	const uint32_t *records;
+	const uint32_t *letters;
+	const Snapshot_Number *numbers;
+	const char *strings;
+};
+
+typedef struct _Snapshot_Writer_Number {
+	const char *number;
+	Snapshot_Number entry;
+} Snapshot_Writer_Number;
+
+static Eina_Bool _source_stat(const char *source, Snapshot_Header *h)
+{
+	struct stat st;
+
+	if (stat(source, &st) < 0)
+		return EINA_FALSE;
+
+	h->source_size = st.st_size;
+	h->source_mtime = st.st_mtime;
+	return EINA_TRUE;
+}
+
+/* compares from the last character, so numbers sharing a suffix are
+ * contiguous and a shorter suffix sorts before the longer ones.
+ */
+static int _reverse_cmp(const char *a, const char *b, Eina_Bool prefix)
+{
+	size_t la = strlen(a), lb = strlen(b);
+
+	while (la > 0 && lb > 0) {
+		unsigned char ca = a[--la], cb = b[--lb];
+		if (ca != cb)
+			return ca - cb;
+	}
+
+	if (lb == 0 && (prefix || la == 0))
+		return 0;
+	return (la == 0) ? -1 : 1;
+}
+
+static int _writer_number_cmp(const void *v1, const void *v2)
+{
+	const Snapshot_Writer_Number *n1 = v1, *n2 = v2;
+	int r = _reverse_cmp(n1->number, n2->number, EINA_FALSE);
+	if (r == 0)
+		return (int)n1->entry.ref - (int)n2->entry.ref;
+	return r;
+}
+
+static uint32_t _strings_add(Eina_Strbuf *strings, Eina_Hash *offsets,
+				const char *str)
+{
+	uintptr_t off;
+
+	if (!str)
+		return SNAPSHOT_NULL;
+
+	off = (uintptr_t)eina_hash_find(offsets, str);
+	if (off)
+		return off - 1;
+
+	off = eina_strbuf_length_get(strings);
+	eina_strbuf_append_length(strings, str, strlen(str) + 1);
+	eina_hash_add(offsets, str, (void *)(off + 1));
+	return off;
+}
+
+static Eina_Bool _is_number(Contacts_Snapshot_Field f)
+{
+	return f == CONTACTS_SNAPSHOT_FIELD_MOBILE ||
+		f == CONTACTS_SNAPSHOT_FIELD_WORK ||
+		f == CONTACTS_SNAPSHOT_FIELD_HOME;
+}
+
+Eina_Bool contacts_snapshot_write(const char *path, const char *source,
+					const char * const *records,
+					unsigned int count)
+{
+	Snapshot_Header h;
+	Snapshot_Writer_Number *wn = NULL;
+	Snapshot_Number *numbers = NULL;
+	uint32_t *recs = NULL, letters[SNAPSHOT_LETTERS];
+	Eina_Strbuf *strings = NULL;
+	Eina_Hash *offsets = NULL;
+	unsigned int i, f, n = 0;
+	char *tmp = NULL;
+	FILE *fp = NULL;
+	Eina_Bool ret = EINA_FALSE;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(path, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(source, EINA_FALSE);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(count > 0 && !records, EINA_FALSE);
+
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	h.version = SNAPSHOT_VERSION;
+	h.count = count;
+	if (!_source_stat(source, &h)) {
+		ERR("could not stat %s", source);
+		return EINA_FALSE;
+	}
+
+	strings = eina_strbuf_new();
+	EINA_SAFETY_ON_NULL_GOTO(strings, end);
+	offsets = eina_hash_string_superfast_new(NULL);
+	EINA_SAFETY_ON_NULL_GOTO(offsets, end);
+
+	if (count > 0) {
+		recs = malloc(sizeof(uint32_t) * count *
+				CONTACTS_SNAPSHOT_FIELD_LAST);
+		EINA_SAFETY_ON_NULL_GOTO(recs, end);
+		wn = malloc(sizeof(Snapshot_Writer_Number) * count * 3);
+		EINA_SAFETY_ON_NULL_GOTO(wn, end);
+	}
+
+	for (i = 0; i < SNAPSHOT_LETTERS; i++)
+		letters[i] = count;
+
+	for (i = 0; i < count; i++) {
+		const char * const *r = records + i * CONTACTS_SNAPSHOT_FIELD_LAST;
+		unsigned char letter;
+
+		for (f = 0; f < CONTACTS_SNAPSHOT_FIELD_LAST; f++) {
+			uint32_t off = _strings_add(strings, offsets, r[f]);
+			recs[i * CONTACTS_SNAPSHOT_FIELD_LAST + f] = off;
+
+			if (!_is_number(f) || !r[f] || r[f][0] == '\0')
+				continue;
+			wn[n].number = r[f];
+			wn[n].entry.str = off;
+			wn[n].entry.ref = i * CONTACTS_SNAPSHOT_FIELD_LAST + f;
+			n++;
+		}
+
+		letter = r[CONTACTS_SNAPSHOT_FIELD_FIRST_NAME] ?
+			r[CONTACTS_SNAPSHOT_FIELD_FIRST_NAME][0] : 0;
+		if (letters[letter] == count)
+			letters[letter] = i;
+	}
+
+	if (n > 0) {
+		qsort(wn, n, sizeof(Snapshot_Writer_Number),
+			_writer_number_cmp);
+		numbers = malloc(sizeof(Snapshot_Number) * n);
+		EINA_SAFETY_ON_NULL_GOTO(numbers, end);
+		for (i = 0; i < n; i++)
+			numbers[i] = wn[i].entry;
+	}
+
+	h.records_off = sizeof(Snapshot_Header);
+	h.letters_off = h.records_off +
+		sizeof(uint32_t) * count * CONTACTS_SNAPSHOT_FIELD_LAST;
+	h.numbers_off = h.letters_off + sizeof(letters);
+	h.numbers_count = n;
+	h.strings_off = h.numbers_off + sizeof(Snapshot_Number) * n;
+	h.strings_size = eina_strbuf_length_get(strings);
+
+	if (asprintf(&tmp, "%s.tmp", path) < 0) {
+		tmp = NULL;
+		goto end;
+	}
+
+	fp = fopen(tmp, "wb");
+	if (!fp) {
+		ERR("could not open %s for writing", tmp);
+		goto end;
+	}
+
+	if ((fwrite(&h, sizeof(h), 1, fp) != 1) ||
+		(count > 0 && fwrite(recs, sizeof(uint32_t) *
+					CONTACTS_SNAPSHOT_FIELD_LAST,
+					count, fp) != count) ||
+		(fwrite(letters, sizeof(letters), 1, fp) != 1) ||
+		(n > 0 && fwrite(numbers, sizeof(Snapshot_Number), n, fp) != n) ||
+		(h.strings_size > 0 &&
+			fwrite(eina_strbuf_string_get(strings), h.strings_size,
+				1, fp) != 1)) {
+		ERR("could not write %s", tmp);
+		goto end;
+	}
+
+	if (fclose(fp) != 0) {
+		fp = NULL;
+		ERR("could not write %s", tmp);
+		goto end;
+	}
+	fp = NULL;
+
+	/* rename so readers that still map the old snapshot keep it */
+	if (rename(tmp, path) < 0) {
+		ERR("could not rename %s to %s", tmp, path);
+		goto end;
+	}
+
+	DBG("wrote %s: %u contacts, %u numbers, %u bytes of strings",
+		path, count, n, h.strings_size);
+	ret = EINA_TRUE;
+
+end:
+	if (fp) {
+		fclose(fp);
+		unlink(tmp);
+	}
+	free(tmp);
+	free(numbers);
+	free(wn);
+	free(recs);
+	if (offsets)
+		eina_hash_free(offsets);
+	if (strings)
+		eina_strbuf_free(strings);
+	return ret;
+}
+
+static Eina_Bool _section_check(size_t size, uint32_t off, size_t len)
+{
+	return off <= size && len <= size - off;
+}
+
+Contacts_Snapshot *contacts_snapshot_open(const char *path,
+						const char *source)
+{
+	Contacts_Snapshot *snap;
+	const Snapshot_Header *h;
+	Snapshot_Header src;
+	size_t size;
+	uint32_t i, n;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(path, NULL);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(source, NULL);
+
+	if (!_source_stat(source, &src))
+		return NULL;
+
+	snap = calloc(1, sizeof(Contacts_Snapshot));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(snap, NULL);
+
+	snap->file = eina_file_open(path, EINA_FALSE);
+	if (!snap->file)
+		goto err_open;
+
+	size = eina_file_size_get(snap->file);
+	if (size < sizeof(Snapshot_Header))
+		goto err_map;
+
+	snap->map = eina_file_map_all(snap->file, EINA_FILE_RANDOM);
+	if (!snap->map)
+		goto err_map;
+
+	h = snap->header = (const Snapshot_Header *)snap->map;
+	if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+		h->version != SNAPSHOT_VERSION) {
+		WRN("%s is not a contacts snapshot", path);
+		goto err_header;
+	}
+
+	if (h->source_size != src.source_size ||
+		h->source_mtime != src.source_mtime) {
+		DBG("%s is older than %s", path, source);
+		goto err_header;
+	}
+
+	if (!_section_check(size, h->records_off, (size_t)h->count *
+				CONTACTS_SNAPSHOT_FIELD_LAST *
+				sizeof(uint32_t)) ||
+		!_section_check(size, h->letters_off,
+				SNAPSHOT_LETTERS * sizeof(uint32_t)) ||
+		!_section_check(size, h->numbers_off, (size_t)h->numbers_count *
+				sizeof(Snapshot_Number)) ||
+		!_section_check(size, h->strings_off, h->strings_size) ||
+		(h->strings_size > 0 &&
+			snap->map[h->strings_off + h->strings_size - 1] != '\0')) {
+		ERR("%s is truncated or corrupt", path);
+		goto err_header;
+	}
+
+	snap->records = (const uint32_t *)(snap->map + h->records_off);
+	snap->letters = (const uint32_t *)(snap->map + h->letters_off);
+	snap->numbers = (const Snapshot_Number *)(snap->map + h->numbers_off);
+	snap->strings = snap->map + h->strings_off;
+
+	n = h->count * CONTACTS_SNAPSHOT_FIELD_LAST;
+	for (i = 0; i < n; i++) {
+		if (snap->records[i] != SNAPSHOT_NULL &&
+			snap->records[i] >= h->strings_size) {
+			ERR("%s has invalid string offsets", path);
+			goto err_header;
+		}
+	}
+	for (i = 0; i < h->numbers_count; i++) {
+		if (snap->numbers[i].str >= h->strings_size ||
+			snap->numbers[i].ref >= n) {
+			ERR("%s has an invalid number index", path);
+			goto err_header;
+		}
+	}
+
+	DBG("mapped %s: %u contacts, %u numbers", path, h->count,
+		h->numbers_count);
+	return snap;
+
+err_header:
+	eina_file_map_free(snap->file, (void *)snap->map);
+err_map:
+	eina_file_close(snap->file);
+err_open:
+	free(snap);
+	return NULL;
+}
+
+void contacts_snapshot_close(Contacts_Snapshot *snap)
+{
+	EINA_SAFETY_ON_NULL_RETURN(snap);
+	eina_file_map_free(snap->file, (void *)snap->map);
+	eina_file_close(snap->file);
+	free(snap);
+}
+
+unsigned int contacts_snapshot_count_get(const Contacts_Snapshot *snap)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(snap, 0);
+	return snap->header->count;
+}
+
+const char *contacts_snapshot_field_get(const Contacts_Snapshot *snap,
+					unsigned int record,
+					Contacts_Snapshot_Field field)
+{
+	uint32_t off;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(snap, NULL);
+	EINA_SAFETY_ON_FALSE_RETURN_VAL(record < snap->header->count, NULL);
+	EINA_SAFETY_ON_FALSE_RETURN_VAL(field < CONTACTS_SNAPSHOT_FIELD_LAST,
+					NULL);
+
+	off = snap->records[record * CONTACTS_SNAPSHOT_FIELD_LAST + field];
+	if (off == SNAPSHOT_NULL)
+		return NULL;
+	return snap->strings + off;
+}
+
+unsigned int contacts_snapshot_letter_first_get(const Contacts_Snapshot *snap,
+						unsigned char letter)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(snap, 0);
+	return snap->letters[letter];
+}
+
+/* first index in the number index that is not smaller than key */
+static uint32_t _number_lower_bound(const Contacts_Snapshot *snap,
+					const char *key)
+{
+	uint32_t lo = 0, hi = snap->header->numbers_count;
+
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		const char *s = snap->strings + snap->numbers[mid].str;
+		if (_reverse_cmp(s, key, EINA_FALSE) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+int contacts_snapshot_number_find(const Contacts_Snapshot *snap,
+					const char *number,
+					Contacts_Snapshot_Field *field)
+{
+	uint32_t i;
+	const Snapshot_Number *e;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(snap, -1);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(number, -1);
+
+	i = _number_lower_bound(snap, number);
+	if (i >= snap->header->numbers_count)
+		return -1;
+
+	e = snap->numbers + i;
+	if (strcmp(snap->strings + e->str, number) != 0)
+		return -1;
+
+	if (field)
+		*field = e->ref % CONTACTS_SNAPSHOT_FIELD_LAST;
+	return e->ref / CONTACTS_SNAPSHOT_FIELD_LAST;
+}
+
+void contacts_snapshot_number_suffix_foreach(const Contacts_Snapshot *snap,
+						const char *suffix,
+						Contacts_Snapshot_Number_Cb cb,
+						const void *data)
+{
+	uint32_t i;
+
+	EINA_SAFETY_ON_NULL_RETURN(snap);
+	EINA_SAFETY_ON_NULL_RETURN(suffix);
+	EINA_SAFETY_ON_NULL_RETURN(cb);
+
+	for (i = _number_lower_bound(snap, suffix);
+		i < snap->header->numbers_count; i++) {
+		const Snapshot_Number *e = snap->numbers + i;
+
+		if (_reverse_cmp(snap->strings + e->str, suffix, EINA_TRUE) != 0)
+			break;
+		if (!cb((void *)data, e->ref / CONTACTS_SNAPSHOT_FIELD_LAST,
+			e->ref % CONTACTS_SNAPSHOT_FIELD_LAST))
+			break;
+	}
+}
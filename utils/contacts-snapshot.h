@@ -0,0 +1,65 @@
+#ifndef _EFL_OFONO_CONTACTS_SNAPSHOT_H__
+#define _EFL_OFONO_CONTACTS_SNAPSHOT_H__ 1
+
+/*
+ * Read-only, mmap-able copy of the desktop contacts database.
+ *
+ * The Eet file stays the editable source, the snapshot is regenerated
+ * whenever it is saved and records the size and mtime of the Eet file
+ * it was generated from, so a stale snapshot is never used.
+ *
+ * Records are sorted by first then last name, which is also the name
+ * index, strings live in a shared table and the number index is sorted
+ * by reversed number so both exact and suffix lookups are a binary
+ * search.
+ */
+
+typedef struct _Contacts_Snapshot Contacts_Snapshot;
+
+typedef enum {
+	CONTACTS_SNAPSHOT_FIELD_FIRST_NAME = 0,
+	CONTACTS_SNAPSHOT_FIELD_LAST_NAME,
+	CONTACTS_SNAPSHOT_FIELD_MOBILE,
+	CONTACTS_SNAPSHOT_FIELD_WORK,
+	CONTACTS_SNAPSHOT_FIELD_HOME,
+	CONTACTS_SNAPSHOT_FIELD_PICTURE,
+	CONTACTS_SNAPSHOT_FIELD_LAST
+} Contacts_Snapshot_Field;
+
+typedef Eina_Bool (*Contacts_Snapshot_Number_Cb)(void *data,
+						unsigned int record,
+						Contacts_Snapshot_Field field);
+
+/* records is count * CONTACTS_SNAPSHOT_FIELD_LAST strings (may be NULL),
+ * already sorted by name. source is the Eet file they were saved to.
+ */
+Eina_Bool contacts_snapshot_write(const char *path, const char *source,
+					const char * const *records,
+					unsigned int count);
+
+Contacts_Snapshot *contacts_snapshot_open(const char *path,
+						const char *source);
+void contacts_snapshot_close(Contacts_Snapshot *snap);
+
+unsigned int contacts_snapshot_count_get(const Contacts_Snapshot *snap);
+
+const char *contacts_snapshot_field_get(const Contacts_Snapshot *snap,
+					unsigned int record,
+					Contacts_Snapshot_Field field);
+
+/* first record whose first name starts with letter, or count */
+unsigned int contacts_snapshot_letter_first_get(const Contacts_Snapshot *snap,
+						unsigned char letter);
+
+/* returns the record or -1 */
+int contacts_snapshot_number_find(const Contacts_Snapshot *snap,
+					const char *number,
+					Contacts_Snapshot_Field *field);
+
+/* calls cb for every number ending with suffix, stops if it returns EINA_FALSE */
+void contacts_snapshot_number_suffix_foreach(const Contacts_Snapshot *snap,
+						const char *suffix,
+						Contacts_Snapshot_Number_Cb cb,
+						const void *data);
+
+#endif
@@ -9,48 +9,41 @@
 #include "log.h"
 #include "ofono.h"
 #include "contacts-ofono-efl.h"
+#include "contacts-db.h"
+#include "contacts-snapshot.h"
 #include "util.h"
+#include "scroll-bench.h"
 
 #ifndef EET_COMPRESSION_DEFAULT
 #define EET_COMPRESSION_DEFAULT 1
 #endif
 
-#define CONTACTS_ENTRY "contacts"
+#define CONTACTS_LETTERS 256
 
-typedef struct _Contacts_List {
-	Eina_List *list;
-	Eina_Bool dirty;
-	Ecore_Poller *save_poller;
-} Contacts_List;
+typedef struct _Contacts_Letter {
+	Elm_Object_Item *group;
+	unsigned int count;
+	unsigned char letter;
+} Contacts_Letter;
 
-typedef struct _Contacts {
+struct _Contacts {
 	char *path;
 	char *bkp;
+	char *snap_path;
 	Eet_Data_Descriptor *edd;
 	Eet_Data_Descriptor *edd_list;
 	Elm_Genlist_Item_Class *itc, *group;
-	Evas_Object *genlist, *layout, *details;
+	Evas_Object *genlist, *layout, *details, *index;
+	Ecore_Job *index_job;
 	Contacts_List *c_list;
-} Contacts;
-
-struct _Contact_Info {
-	const char *first_name;
-	const char *last_name;
-	const char *full_name; /* not in edd */
-	const char *mobile;
-	const char *home;
-	const char *work;
-	const char *picture;
-
-	Contacts *contacts; /* not in edd */
-	Elm_Object_Item *it; /* not in edd */
-	Eina_Inlist *on_del_cbs; /* not in edd */
-	Ecore_Idler *changed_idler; /* not in edd */
+	Eina_Inarray *sorted; /* Contact_Info *, as contacts_db_sort_cb() */
+	Contacts_Letter letters[CONTACTS_LETTERS];
 	struct {
-		Eina_Inlist *listeners;
-		Eina_List *deleted;
-		int walking;
-	} on_changed_cbs; /* not in edd */
+		Contacts_Snapshot *loaded; /* mapped contacts point here */
+		Contacts_Snapshot *current; /* records match contacts->sorted */
+		Eina_Bool stale;
+		Ecore_Idler *idler;
+	} snap;
 };
 
 typedef struct _Contact_Info_On_Del_Ctx {
@@ -66,6 +59,34 @@ typedef struct _Contact_Info_On_Changed_Ctx {
 	Eina_Bool deleted;
 } Contact_Info_On_Changed_Ctx;
 
+static const char *_snapshot_field_type_get(Contacts_Snapshot_Field field)
+{
+	switch (field) {
+	case CONTACTS_SNAPSHOT_FIELD_MOBILE:
+		return "Mobile";
+	case CONTACTS_SNAPSHOT_FIELD_WORK:
+		return "Work";
+	case CONTACTS_SNAPSHOT_FIELD_HOME:
+		return "Home";
+	default:
+		return NULL;
+	}
+}
+
+static inline Contact_Info *_contacts_nth(const Contacts *contacts,
+						unsigned int i)
+{
+	return *(Contact_Info **)eina_inarray_nth(contacts->sorted, i);
+}
+
+/* indexes are only valid until the first change after they were written */
+static const Contacts_Snapshot *_contacts_snapshot_get(const Contacts *contacts)
+{
+	if (contacts->snap.stale)
+		return NULL;
+	return contacts->snap.current;
+}
+
 Eina_List *contact_info_all_numbers_get(const Contact_Info *c)
 {
 	Eina_List *l = NULL;
@@ -126,6 +147,52 @@ static void _partial_number_match_add(Eina_List **p_list, const char *type,
 	_partial_match_add(p_list, type, c_info, EINA_FALSE);
 }
 
+static Eina_Bool _partial_number_snapshot_cb(void *data, unsigned int record,
+						Contacts_Snapshot_Field field)
+{
+	Eina_Inarray *refs = data;
+	unsigned int ref = record * CONTACTS_SNAPSHOT_FIELD_LAST + field;
+	eina_inarray_push(refs, &ref);
+	return EINA_TRUE;
+}
+
+static int _ref_cmp(const void *v1, const void *v2)
+{
+	const unsigned int *r1 = v1, *r2 = v2;
+	if (*r1 < *r2)
+		return -1;
+	return *r1 > *r2;
+}
+
+/* same results and order as the list walk, using the suffix index */
+static Eina_List *_partial_number_snapshot_search(const Contacts *contacts,
+						const Contacts_Snapshot *snap,
+						const char *query_number)
+{
+	Eina_List *ret = NULL;
+	Eina_Inarray *refs;
+	unsigned int *ref;
+
+	refs = eina_inarray_new(sizeof(unsigned int), 32);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(refs, NULL);
+
+	contacts_snapshot_number_suffix_foreach(snap, query_number,
+					_partial_number_snapshot_cb, refs);
+	eina_inarray_sort(refs, _ref_cmp);
+
+	EINA_INARRAY_FOREACH(refs, ref) {
+		unsigned int record = *ref / CONTACTS_SNAPSHOT_FIELD_LAST;
+		Contacts_Snapshot_Field field;
+
+		field = *ref % CONTACTS_SNAPSHOT_FIELD_LAST;
+		_partial_number_match_add(&ret, _snapshot_field_type_get(field),
+						_contacts_nth(contacts, record));
+	}
+
+	eina_inarray_free(refs);
+	return ret;
+}
+
 Eina_List *contact_partial_match_search(Evas_Object *obj, const char *query)
 {
 	const Contact_Info *c_info;
@@ -160,7 +227,13 @@ Eina_List *contact_partial_match_search(Evas_Object *obj, const char *query)
 				_partial_name_match_add(&ret, c_info);
 		}
 	} else {
+		const Contacts_Snapshot *snap = _contacts_snapshot_get(contacts);
+
 		query_number[j] = '\0';
+		if (snap && j > 0)
+			return _partial_number_snapshot_search(contacts, snap,
+								query_number);
+
 		EINA_LIST_FOREACH(contacts->c_list->list, l, c_info) {
 			if (_number_match(c_info->mobile, query_number))
 				_partial_number_match_add(&ret, "Mobile",
@@ -209,12 +282,24 @@ Contact_Info *contact_search(Evas_Object *obj, const char *number, const char **
 	Contact_Info *c_info;
 	Eina_List *l;
 	Contacts *contacts;
+	const Contacts_Snapshot *snap;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(obj, NULL);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(number, NULL);
 	contacts = evas_object_data_get(obj, "contacts.ctx");
 	EINA_SAFETY_ON_NULL_RETURN_VAL(contacts, NULL);
 
+	snap = _contacts_snapshot_get(contacts);
+	if (snap && number[0] != '\0') {
+		Contacts_Snapshot_Field field;
+		int record = contacts_snapshot_number_find(snap, number, &field);
+		if (record < 0)
+			return NULL;
+		if (type)
+			*type = _snapshot_field_type_get(field);
+		return _contacts_nth(contacts, record);
+	}
+
 	EINA_LIST_FOREACH(contacts->c_list->list, l, c_info) {
 		if (strcmp(number, c_info->mobile) == 0) {
 			if (type)
@@ -296,25 +381,115 @@ const char *contact_info_number_check(const Contact_Info *c, const char *number)
 	return NULL;
 }
 
+Eina_Bool contacts_db_snapshot_write(const char *path, const char *source,
+					const Eina_List *list)
+{
+	const char **records;
+	const Contact_Info *c_info;
+	const Eina_List *l;
+	unsigned int i, count;
+	Eina_Bool ret;
+
+	count = eina_list_count(list);
+	records = malloc(sizeof(char *) * CONTACTS_SNAPSHOT_FIELD_LAST *
+				(count + 1));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(records, EINA_FALSE);
+
+	i = 0;
+	EINA_LIST_FOREACH(list, l, c_info) {
+		const char **r = records + i * CONTACTS_SNAPSHOT_FIELD_LAST;
+
+		r[CONTACTS_SNAPSHOT_FIELD_FIRST_NAME] = c_info->first_name;
+		r[CONTACTS_SNAPSHOT_FIELD_LAST_NAME] = c_info->last_name;
+		r[CONTACTS_SNAPSHOT_FIELD_MOBILE] = c_info->mobile;
+		r[CONTACTS_SNAPSHOT_FIELD_WORK] = c_info->work;
+		r[CONTACTS_SNAPSHOT_FIELD_HOME] = c_info->home;
+		r[CONTACTS_SNAPSHOT_FIELD_PICTURE] = c_info->picture;
+		i++;
+	}
+
+	ret = contacts_snapshot_write(path, source, records, count);
+	free(records);
+	return ret;
+}
+
+/* c_list->list must be in contacts->sorted order */
+static void _contacts_snapshot_update(Contacts *contacts)
+{
+	Contacts_Snapshot *snap;
+
+	if (!contacts_db_snapshot_write(contacts->snap_path, contacts->path,
+					contacts->c_list->list))
+		return;
+
+	snap = contacts_snapshot_open(contacts->snap_path, contacts->path);
+	EINA_SAFETY_ON_NULL_RETURN(snap);
+
+	if (contacts->snap.current &&
+		contacts->snap.current != contacts->snap.loaded)
+		contacts_snapshot_close(contacts->snap.current);
+	contacts->snap.current = snap;
+	contacts->snap.stale = EINA_FALSE;
+}
+
+/* the database and its snapshot are written in name order */
+static void _contacts_list_sync(Contacts *contacts)
+{
+	Eina_List *l;
+	unsigned int i = 0;
+
+	if (eina_list_count(contacts->c_list->list) !=
+		eina_inarray_count(contacts->sorted)) {
+		ERR("contacts list and index are out of sync");
+		contacts->c_list->list = eina_list_sort(contacts->c_list->list,
+							0, contacts_db_sort_cb);
+		return;
+	}
+
+	for (l = contacts->c_list->list; l; l = eina_list_next(l))
+		eina_list_data_set(l, _contacts_nth(contacts, i++));
+}
+
+static Eina_Bool _contacts_snapshot_idler(void *data)
+{
+	Contacts *contacts = data;
+
+	contacts->snap.idler = NULL;
+
+	/* pending changes will write it when saved */
+	if (contacts->snap.stale || contacts->c_list->save_poller)
+		return EINA_FALSE;
+
+	_contacts_snapshot_update(contacts);
+	return EINA_FALSE;
+}
+
 static Eina_Bool _contacts_save_do(void *data)
 {
 	Contacts *contacts = data;
 	Eet_File *efile;
+	Eina_Bool written;
 
 	contacts->c_list->save_poller = NULL;
 	contacts->c_list->dirty = EINA_FALSE;
 
+	_contacts_list_sync(contacts);
+
 	ecore_file_unlink(contacts->bkp);
 	ecore_file_mv(contacts->path, contacts->bkp);
 	efile = eet_open(contacts->path, EET_FILE_MODE_WRITE);
 	EINA_SAFETY_ON_NULL_GOTO(efile, failed);
-	if (!(eet_data_write(efile,
+	written = !!eet_data_write(efile,
 				contacts->edd_list, CONTACTS_ENTRY,
-				contacts->c_list, EET_COMPRESSION_DEFAULT)))
+				contacts->c_list, EET_COMPRESSION_DEFAULT);
+	if (!written)
 		ERR("Could in the contacts database");
 
 	DBG("wrote %s", contacts->path);
 	eet_close(efile);
+
+	if (written)
+		_contacts_snapshot_update(contacts);
 	return EINA_FALSE;
 
 failed:
@@ -360,13 +535,32 @@ static Eina_Bool _contact_info_changed_idler(void *data)
 	return EINA_FALSE;
 }
 
+static void _contact_info_detach(Contact_Info *c);
+static void _contact_info_attach(Contact_Info *c);
+
 static void _contact_info_changed(Contact_Info *c)
 {
+	c->contacts->snap.stale = EINA_TRUE;
 	if (c->changed_idler)
 		return;
 	c->changed_idler = ecore_idler_add(_contact_info_changed_idler, c);
 }
 
+/* copy the strings out of the snapshot before changing any of them */
+static void _contact_info_strings_own(Contact_Info *c)
+{
+	if (!c->mapped)
+		return;
+
+	c->first_name = eina_stringshare_add(c->first_name);
+	c->last_name = eina_stringshare_add(c->last_name);
+	c->mobile = eina_stringshare_add(c->mobile);
+	c->home = eina_stringshare_add(c->home);
+	c->work = eina_stringshare_add(c->work);
+	c->picture = eina_stringshare_add(c->picture);
+	c->mapped = EINA_FALSE;
+}
+
 Eina_Bool contact_info_picture_set(Contact_Info *c, const char *filename)
 {
 	EINA_SAFETY_ON_NULL_RETURN_VAL(c, EINA_FALSE);
@@ -374,6 +568,7 @@ Eina_Bool contact_info_picture_set(Contact_Info *c, const char *filename)
 
 	DBG("c=%p, was=%s, new=%s", c, c->picture, filename);
 
+	_contact_info_strings_own(c);
 	if (eina_stringshare_replace(&(c->picture), filename))
 		_contact_info_changed(c);
 
@@ -387,10 +582,16 @@ Eina_Bool contact_info_first_name_set(Contact_Info *c, const char *name)
 
 	DBG("c=%p, was=%s, new=%s", c, c->first_name, name);
 
-	if (eina_stringshare_replace(&(c->first_name), name)) {
-		eina_stringshare_replace(&(c->full_name), NULL);
-		_contact_info_changed(c);
-	}
+	_contact_info_strings_own(c);
+	if (c->first_name && strcmp(c->first_name, name) == 0)
+		return EINA_TRUE;
+
+	/* take it out while the old name still tells where it is */
+	_contact_info_detach(c);
+	eina_stringshare_replace(&(c->first_name), name);
+	eina_stringshare_replace(&(c->full_name), NULL);
+	_contact_info_attach(c);
+	_contact_info_changed(c);
 
 	return EINA_TRUE;
 }
@@ -402,10 +603,15 @@ Eina_Bool contact_info_last_name_set(Contact_Info *c, const char *name)
 
 	DBG("c=%p, was=%s, new=%s", c, c->last_name, name);
 
-	if (eina_stringshare_replace(&(c->last_name), name)) {
-		eina_stringshare_replace(&(c->full_name), NULL);
-		_contact_info_changed(c);
-	}
+	_contact_info_strings_own(c);
+	if (c->last_name && strcmp(c->last_name, name) == 0)
+		return EINA_TRUE;
+
+	_contact_info_detach(c);
+	eina_stringshare_replace(&(c->last_name), name);
+	eina_stringshare_replace(&(c->full_name), NULL);
+	_contact_info_attach(c);
+	_contact_info_changed(c);
 
 	return EINA_TRUE;
 }
@@ -420,6 +626,7 @@ Eina_Bool contact_info_detail_set(Contact_Info *c, const char *type, const char
 
 	DBG("c=%p, type=%s, number=%s", c, type, number);
 
+	_contact_info_strings_own(c);
 	if (strcmp(type, "Mobile") == 0)
 		changed = eina_stringshare_replace(&(c->mobile), number);
 	else if (strcmp(type, "Work") == 0)
@@ -552,20 +759,19 @@ void contact_info_del(Contact_Info *c)
 	EINA_SAFETY_ON_NULL_RETURN(c);
 
 	_contact_info_on_del_dispatch(c);
-
-	if (c->it)
-		elm_object_item_del(c->it);
+	_contact_info_detach(c);
 
 	contacts = c->contacts;
 	contacts->c_list->list = eina_list_remove(contacts->c_list->list, c);
 	contacts->c_list->dirty = EINA_TRUE;
+	contacts->snap.stale = EINA_TRUE;
 	_contacts_save(contacts);
 
 	_contact_info_free(c);
 }
 
-static void _contacts_info_descriptor_init(Eet_Data_Descriptor **edd,
-						Eet_Data_Descriptor **edd_list)
+void contacts_db_descriptors_init(Eet_Data_Descriptor **edd,
+					Eet_Data_Descriptor **edd_list)
 {
 	Eet_Data_Descriptor_Class eddc;
 
@@ -619,13 +825,15 @@ static void _contact_info_free(Contact_Info *c_info)
 	if (c_info->changed_idler)
 		ecore_idler_del(c_info->changed_idler);
 
-	eina_stringshare_del(c_info->first_name);
-	eina_stringshare_del(c_info->last_name);
 	eina_stringshare_del(c_info->full_name);
-	eina_stringshare_del(c_info->mobile);
-	eina_stringshare_del(c_info->home);
-	eina_stringshare_del(c_info->work);
-	eina_stringshare_del(c_info->picture);
+	if (!c_info->mapped) {
+		eina_stringshare_del(c_info->first_name);
+		eina_stringshare_del(c_info->last_name);
+		eina_stringshare_del(c_info->mobile);
+		eina_stringshare_del(c_info->home);
+		eina_stringshare_del(c_info->work);
+		eina_stringshare_del(c_info->picture);
+	}
 	free(c_info);
 }
 
@@ -635,6 +843,10 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 	Contacts *contacts = data;
 	Contact_Info *c_info;
 
+	if (contacts->snap.idler)
+		ecore_idler_del(contacts->snap.idler);
+	if (contacts->index_job)
+		ecore_job_del(contacts->index_job);
 	if (contacts->c_list->save_poller)
 		ecore_poller_del(contacts->c_list->save_poller);
 	if (contacts->c_list->dirty)
@@ -647,10 +859,17 @@ static void _on_del(void *data, Evas *e __UNUSED__,
 		_contact_info_free(c_info);
 	}
 	free(contacts->c_list);
+	eina_inarray_free(contacts->sorted);
+	if (contacts->snap.current &&
+		contacts->snap.current != contacts->snap.loaded)
+		contacts_snapshot_close(contacts->snap.current);
+	if (contacts->snap.loaded)
+		contacts_snapshot_close(contacts->snap.loaded);
 	elm_genlist_item_class_free(contacts->itc);
 	elm_genlist_item_class_free(contacts->group);
 	free(contacts->path);
 	free(contacts->bkp);
+	free(contacts->snap_path);
 	free(contacts);
 	eet_shutdown();
 }
@@ -734,7 +953,7 @@ static void _on_item_click(void *data, Evas_Object *obj __UNUSED__,
 	elm_object_signal_emit(contacts->layout, "show,details", "gui");
 }
 
-static int _sort_by_name_cb(const void *v1, const void *v2)
+int contacts_db_sort_cb(const void *v1, const void *v2)
 {
 	const Contact_Info *c1, *c2;
 	int r;
@@ -752,56 +971,275 @@ static int _sort_by_name_cb(const void *v1, const void *v2)
 	return r;
 }
 
-static void _contacts_read(Contacts *contacts)
+/* first position whose contact sorts after c */
+static unsigned int _contacts_upper_bound(const Contacts *contacts,
+						const Contact_Info *c)
 {
+	unsigned int lo = 0, hi = eina_inarray_count(contacts->sorted);
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (contacts_db_sort_cb(_contacts_nth(contacts, mid), c) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static int _contacts_position_get(const Contacts *contacts,
+					const Contact_Info *c)
+{
+	unsigned int i = _contacts_upper_bound(contacts, c);
+
+	/* walk back over the contacts with the same name */
+	while (i > 0) {
+		const Contact_Info *other = _contacts_nth(contacts, --i);
+		if (other == c)
+			return i;
+		if (contacts_db_sort_cb(other, c) != 0)
+			break;
+	}
+
+	return -1;
+}
+
+static void _contacts_index_update(void *data)
+{
+	Contacts *contacts = data;
+	char label[2] = { '\0', '\0' };
+	unsigned int i;
+
+	contacts->index_job = NULL;
+	elm_index_item_clear(contacts->index);
+	for (i = 1; i < CONTACTS_LETTERS; i++) {
+		if (!contacts->letters[i].group)
+			continue;
+		label[0] = i;
+		elm_index_item_append(contacts->index, label, NULL,
+					contacts->letters + i);
+	}
+	elm_index_level_go(contacts->index, 0);
+}
+
+/* the index has a letter for each group, rebuilt once groups settle */
+static void _contacts_index_changed(Contacts *contacts)
+{
+	if (!contacts->index_job)
+		contacts->index_job = ecore_job_add(_contacts_index_update,
+							contacts);
+}
+
+static void _on_index_changed(void *data __UNUSED__,
+				Evas_Object *obj __UNUSED__, void *event_info)
+{
+	Contacts_Letter *l = elm_object_item_data_get(event_info);
+
+	if (l && l->group)
+		elm_genlist_item_show(l->group, ELM_GENLIST_ITEM_SCROLLTO_TOP);
+}
+
+static Elm_Object_Item *_contacts_group_get(Contacts *contacts,
+						unsigned char letter)
+{
+	Contacts_Letter *l = contacts->letters + letter;
+	unsigned int i;
+
+	if (l->group)
+		return l->group;
+
+	for (i = letter + 1; i < CONTACTS_LETTERS; i++) {
+		if (contacts->letters[i].group)
+			break;
+	}
+
+	if (i < CONTACTS_LETTERS)
+		l->group = elm_genlist_item_insert_before(
+			contacts->genlist, contacts->group, l, NULL,
+			contacts->letters[i].group, ELM_GENLIST_ITEM_GROUP,
+			NULL, NULL);
+	else
+		l->group = elm_genlist_item_append(
+			contacts->genlist, contacts->group, l, NULL,
+			ELM_GENLIST_ITEM_GROUP, NULL, NULL);
+
+	elm_genlist_item_select_mode_set(l->group,
+					ELM_OBJECT_SELECT_MODE_DISPLAY_ONLY);
+	_contacts_index_changed(contacts);
+	return l->group;
+}
+
+/* c must already be at pos in contacts->sorted */
+static void _contacts_item_insert(Contacts *contacts, Contact_Info *c,
+					unsigned int pos)
+{
+	unsigned char letter = c->first_name[0];
+	Elm_Object_Item *group = _contacts_group_get(contacts, letter);
+	Contact_Info *next = NULL;
+
+	if (pos + 1 < eina_inarray_count(contacts->sorted))
+		next = _contacts_nth(contacts, pos + 1);
+
+	if (next && next->it && (unsigned char)next->first_name[0] == letter)
+		c->it = elm_genlist_item_insert_before(contacts->genlist,
+							contacts->itc, c,
+							group, next->it,
+							ELM_GENLIST_ITEM_NONE,
+							_on_item_click,
+							contacts);
+	else
+		c->it = elm_genlist_item_append(contacts->genlist,
+						contacts->itc, c, group,
+						ELM_GENLIST_ITEM_NONE,
+						_on_item_click, contacts);
+
+	contacts->letters[letter].count++;
+}
+
+static void _contact_info_detach(Contact_Info *c)
+{
+	Contacts *contacts = c->contacts;
+	Contacts_Letter *l = contacts->letters +
+		(unsigned char)c->first_name[0];
+	int pos = _contacts_position_get(contacts, c);
+
+	if (pos >= 0)
+		eina_inarray_remove_at(contacts->sorted, pos);
+
+	if (!c->it)
+		return;
+
+	elm_object_item_del(c->it);
+	c->it = NULL;
+	l->count--;
+	if (l->count == 0 && l->group) {
+		elm_object_item_del(l->group);
+		l->group = NULL;
+		_contacts_index_changed(contacts);
+	}
+}
+
+static void _contact_info_attach(Contact_Info *c)
+{
+	Contacts *contacts = c->contacts;
+	unsigned int pos = _contacts_upper_bound(contacts, c);
+
+	eina_inarray_insert_at(contacts->sorted, pos, &c);
+	_contacts_item_insert(contacts, c, pos);
+}
+
+/* contacts point to the mapped strings until they are changed */
+static Contacts_List *_contacts_snapshot_load(Contacts *contacts)
+{
+	Contacts_Snapshot *snap;
+	Contacts_List *c_list;
 	Contact_Info *c_info;
-	Eina_List *l;
+	unsigned int i, count;
+
+	snap = contacts_snapshot_open(contacts->snap_path, contacts->path);
+	if (!snap)
+		return NULL;
+
+	count = contacts_snapshot_count_get(snap);
+	c_list = calloc(1, sizeof(Contacts_List));
+	EINA_SAFETY_ON_NULL_GOTO(c_list, err_list);
+
+	for (i = 0; i < count; i++) {
+		c_info = calloc(1, sizeof(Contact_Info));
+		EINA_SAFETY_ON_NULL_GOTO(c_info, err_info);
+
+		c_info->first_name = contacts_snapshot_field_get(
+			snap, i, CONTACTS_SNAPSHOT_FIELD_FIRST_NAME);
+		c_info->last_name = contacts_snapshot_field_get(
+			snap, i, CONTACTS_SNAPSHOT_FIELD_LAST_NAME);
+		c_info->mobile = contacts_snapshot_field_get(
+			snap, i, CONTACTS_SNAPSHOT_FIELD_MOBILE);
+		c_info->work = contacts_snapshot_field_get(
+			snap, i, CONTACTS_SNAPSHOT_FIELD_WORK);
+		c_info->home = contacts_snapshot_field_get(
+			snap, i, CONTACTS_SNAPSHOT_FIELD_HOME);
+		c_info->picture = contacts_snapshot_field_get(
+			snap, i, CONTACTS_SNAPSHOT_FIELD_PICTURE);
+		c_info->mapped = EINA_TRUE;
+
+		c_list->list = eina_list_append(c_list->list, c_info);
+	}
+
+	contacts->snap.loaded = snap;
+	contacts->snap.current = snap;
+	DBG("loaded %u contacts from %s", count, contacts->snap_path);
+	return c_list;
+
+err_info:
+	EINA_LIST_FREE(c_list->list, c_info)
+		_contact_info_free(c_info);
+	free(c_list);
+err_list:
+	contacts_snapshot_close(snap);
+	return NULL;
+}
+
+static Contacts_List *_contacts_eet_read(Contacts *contacts,
+						Eina_Bool *from_bkp)
+{
+	Contacts_List *c_list = NULL;
 	Eet_File *efile;
-	Elm_Object_Item *it = NULL;
-	char group;
+
+	*from_bkp = EINA_FALSE;
 	efile = eet_open(contacts->path, EET_FILE_MODE_READ);
 
 	if (efile) {
-		contacts->c_list = eet_data_read(efile, contacts->edd_list,
-							CONTACTS_ENTRY);
+		c_list = eet_data_read(efile, contacts->edd_list,
+					CONTACTS_ENTRY);
 		eet_close(efile);
 	}
 
-	if (!contacts->c_list) {
+	if (!c_list) {
 		efile = eet_open(contacts->bkp, EET_FILE_MODE_READ);
 		if (efile) {
-			contacts->c_list = eet_data_read(
-				efile, contacts->edd_list, CONTACTS_ENTRY);
+			c_list = eet_data_read(efile, contacts->edd_list,
+						CONTACTS_ENTRY);
 			eet_close(efile);
+			*from_bkp = EINA_TRUE;
 		}
 	}
 
+	if (!c_list)
+		return NULL;
+
+	c_list->list = eina_list_sort(c_list->list, 0, contacts_db_sort_cb);
+	return c_list;
+}
+
+static void _contacts_read(Contacts *contacts)
+{
+	Contact_Info *c_info;
+	Eina_List *l;
+	Eina_Bool from_bkp;
+
+	contacts->c_list = _contacts_snapshot_load(contacts);
+	if (!contacts->c_list) {
+		contacts->c_list = _contacts_eet_read(contacts, &from_bkp);
+		/* a snapshot must describe contacts->path, not the backup */
+		if (contacts->c_list && !from_bkp)
+			contacts->snap.idler = ecore_idler_add(
+				_contacts_snapshot_idler, contacts);
+	}
+
 	if (!contacts->c_list)
 		contacts->c_list = calloc(1, sizeof(Contacts_List));
 
 	EINA_SAFETY_ON_NULL_RETURN(contacts->c_list);
-	contacts->c_list->list = eina_list_sort(contacts->c_list->list, 0,
-						_sort_by_name_cb);
-	group = '\0';
+
+	/* the list is already in order, so every item is appended */
 	EINA_LIST_FOREACH(contacts->c_list->list, l, c_info) {
 		if (!c_info)
 			continue;
-		if (group != c_info->first_name[0]) {
-			group = c_info->first_name[0];
-			it = elm_genlist_item_append(contacts->genlist,
-							contacts->group,
-							c_info, NULL,
-							ELM_GENLIST_ITEM_GROUP,
-							NULL,
-							NULL);
-			elm_genlist_item_select_mode_set(it, ELM_OBJECT_SELECT_MODE_DISPLAY_ONLY);
-		}
-		it = elm_genlist_item_append(contacts->genlist,contacts->itc,
-						c_info, it,
-						ELM_GENLIST_ITEM_NONE,
-						_on_item_click, contacts);
-		c_info->it = it;
 		c_info->contacts = contacts;
+		eina_inarray_push(contacts->sorted, &c_info);
+		_contacts_item_insert(contacts, c_info,
+				eina_inarray_count(contacts->sorted) - 1);
 	}
 }
 
@@ -829,9 +1267,9 @@ static char *_item_label_get(void *data, Evas_Object *obj __UNUSED__,
 static char *_group_label_get(void *data, Evas_Object *obj __UNUSED__,
 				const char *part __UNUSED__)
 {
-	Contact_Info *c_info = data;
+	Contacts_Letter *l = data;
 	char buf[2];
-	snprintf(buf, sizeof(buf), "%c", c_info->first_name[0]);
+	snprintf(buf, sizeof(buf), "%c", l->letter);
 	return strdup(buf);
 }
 
@@ -872,7 +1310,7 @@ Evas_Object *contacts_add(Evas_Object *parent)
 	const char *config_path;
 	char base_dir[PATH_MAX], *path;
 	Contacts *contacts;
-	Evas_Object *obj, *genlist, *details;
+	Evas_Object *obj, *genlist, *details, *index;
 	Elm_Genlist_Item_Class *itc, *group;
 
 	eet_init();
@@ -908,11 +1346,22 @@ Evas_Object *contacts_add(Evas_Object *parent)
 	group->func.del = NULL;
 	contacts->group = group;
 	contacts->genlist = genlist;
+	scroll_bench_genlist_add(genlist, "contacts");
 	contacts->itc = itc;
 	contacts->layout = obj;
 	contacts->details = details;
 
+	index = elm_index_add(obj);
+	EINA_SAFETY_ON_NULL_GOTO(index, err_index);
+	elm_index_autohide_disabled_set(index, EINA_TRUE);
+	evas_object_smart_callback_add(index, "delay,changed",
+					_on_index_changed, contacts);
+	evas_object_smart_callback_add(index, "selected",
+					_on_index_changed, contacts);
+	contacts->index = index;
+
 	elm_object_part_content_set(obj, "elm.swallow.genlist", genlist);
+	elm_object_part_content_set(obj, "elm.swallow.index", index);
 	elm_object_part_content_set(obj, "elm.swallow.details", details);
 
 	elm_object_signal_callback_add(details, "clicked,back", "gui",
@@ -936,7 +1385,19 @@ Evas_Object *contacts_add(Evas_Object *parent)
 		goto err_bkp;
 	contacts->bkp = path;
 
-	_contacts_info_descriptor_init(&contacts->edd, &contacts->edd_list);
+	r = asprintf(&path,  "%s/%s/contacts.snap", config_path,
+			PACKAGE_NAME);
+
+	if (r < 0)
+		goto err_snap;
+	contacts->snap_path = path;
+
+	contacts->sorted = eina_inarray_new(sizeof(Contact_Info *), 64);
+	EINA_SAFETY_ON_NULL_GOTO(contacts->sorted, err_sorted);
+	for (r = 0; r < CONTACTS_LETTERS; r++)
+		contacts->letters[r].letter = r;
+
+	contacts_db_descriptors_init(&contacts->edd, &contacts->edd_list);
 	_contacts_read(contacts);
 	EINA_SAFETY_ON_NULL_GOTO(contacts->c_list, err_read);
 
@@ -947,12 +1408,20 @@ Evas_Object *contacts_add(Evas_Object *parent)
 	return obj;
 
 err_read:
+	if (contacts->index_job)
+		ecore_job_del(contacts->index_job);
 	eet_data_descriptor_free(contacts->edd);
 	eet_data_descriptor_free(contacts->edd_list);
+	eina_inarray_free(contacts->sorted);
+err_sorted:
+	free(contacts->snap_path);
+err_snap:
 	free(contacts->bkp);
 err_bkp:
 	free(contacts->path);
 err_path:
+	evas_object_del(index);
+err_index:
 	elm_genlist_item_class_free(group);
 err_group:
 	elm_genlist_item_class_free(itc);
@@ -5,6 +5,7 @@
 
 #include "ofono.h"
 #include "log.h"
+#include "trace.h"
 
 #include <time.h>
 
@@ -31,6 +32,7 @@ static void _ofono_call_volume_properties_get(OFono_Modem *m);
 static void _ofono_msg_waiting_properties_get(OFono_Modem *m);
 static void _ofono_suppl_serv_properties_get(OFono_Modem *m);
 static void _ofono_msg_properties_get(OFono_Modem *m);
+static void _ofono_msg_messages_get(OFono_Modem *m);
 
 static OFono_Pending *_ofono_simple_do(OFono_API api, const char *method,
 					OFono_Simple_Cb cb, const void *data);
@@ -40,20 +42,25 @@ struct _OFono_Callback_List_Modem_Node
 	EINA_INLIST;
 	void (*cb)(void *data);
 	const void *cb_data;
+	OFono_Callback_Stat *stat; /* NULL unless profiling */
 };
 
 struct _OFono_Callback_List_Call_Node
 {
 	EINA_INLIST;
+	OFono_Callback_Priority priority;
 	void (*cb)(void *data, OFono_Call *call);
 	const void *cb_data;
+	OFono_Callback_Stat *stat; /* NULL unless profiling */
 };
 
 struct _OFono_Callback_List_Call_Disconnected_Node
 {
 	EINA_INLIST;
+	OFono_Callback_Priority priority;
 	void (*cb)(void *data, OFono_Call *call, const char *reason);
 	const void *cb_data;
+	OFono_Callback_Stat *stat; /* NULL unless profiling */
 };
 
 struct _OFono_Callback_List_USSD_Notify_Node
@@ -61,6 +68,7 @@ struct _OFono_Callback_List_USSD_Notify_Node
 	EINA_INLIST;
 	void (*cb)(void *data, Eina_Bool needs_reply, const char *msg);
 	const void *cb_data;
+	OFono_Callback_Stat *stat; /* NULL unless profiling */
 };
 
 struct _OFono_Callback_List_Sent_SMS_Node
@@ -68,6 +76,7 @@ struct _OFono_Callback_List_Sent_SMS_Node
 	EINA_INLIST;
 	OFono_Sent_SMS_Cb cb;
 	const void *cb_data;
+	OFono_Callback_Stat *stat; /* NULL unless profiling */
 };
 
 struct _OFono_Callback_List_Incoming_SMS_Node
@@ -75,6 +84,7 @@ struct _OFono_Callback_List_Incoming_SMS_Node
 	EINA_INLIST;
 	OFono_Incoming_SMS_Cb cb;
 	const void *cb_data;
+	OFono_Callback_Stat *stat; /* NULL unless profiling */
 };
 
 static Eina_Inlist *cbs_modem_changed = NULL;
@@ -90,6 +100,173 @@ static Eina_Inlist *cbs_call_removed = NULL;
 static Eina_Inlist *cbs_sent_sms_changed = NULL;
 static Eina_Inlist *cbs_incoming_sms = NULL;
 
+#define CB_PROFILE_REPORT 10
+
+/* -1 not checked yet, 0 off, else how many to report */
+static int cb_profile_report = -1;
+static Eina_Hash *cb_stats = NULL; /* "list owner" => OFono_Callback_Stat */
+
+Eina_Bool ofono_callback_profile_enabled_get(void)
+{
+	const char *s;
+
+	if (cb_profile_report >= 0)
+		return cb_profile_report > 0;
+
+	s = getenv(OFONO_CB_PROFILE_ENV);
+	if ((!s) || (s[0] == '\0')) {
+		cb_profile_report = 0;
+		return EINA_FALSE;
+	}
+
+	cb_profile_report = atoi(s);
+	if (cb_profile_report <= 0)
+		cb_profile_report = CB_PROFILE_REPORT;
+	return EINA_TRUE;
+}
+
+static void _cb_stat_free(OFono_Callback_Stat *stat)
+{
+	eina_stringshare_del(stat->owner);
+	free(stat);
+}
+
+/* __FILE__ may have the source directory in front, keep dir/file.c */
+static const char *_cb_owner_short(const char *owner)
+{
+	const char *p, *last = NULL, *prev = NULL;
+
+	for (p = owner; *p != '\0'; p++) {
+		if (*p == '/') {
+			prev = last;
+			last = p;
+		}
+	}
+	return prev ? prev + 1 : owner;
+}
+
+/* list is a literal, all callbacks of a file on a list share a stat */
+static OFono_Callback_Stat *_cb_stat_get(const char *list, const char *owner)
+{
+	OFono_Callback_Stat *stat;
+	char key[256];
+
+	if (!ofono_callback_profile_enabled_get())
+		return NULL;
+
+	owner = owner ? _cb_owner_short(owner) : "?";
+
+	if (!cb_stats) {
+		cb_stats = eina_hash_string_superfast_new(
+			EINA_FREE_CB(_cb_stat_free));
+		EINA_SAFETY_ON_NULL_RETURN_VAL(cb_stats, NULL);
+	}
+
+	snprintf(key, sizeof(key), "%s %s", list, owner);
+	stat = eina_hash_find(cb_stats, key);
+	if (stat)
+		return stat;
+
+	stat = calloc(1, sizeof(OFono_Callback_Stat));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(stat, NULL);
+	stat->list = list;
+	stat->owner = eina_stringshare_add(owner);
+	eina_hash_add(cb_stats, key, stat);
+	return stat;
+}
+
+static inline double _cb_stat_start(const OFono_Callback_Stat *stat)
+{
+	return stat ? ecore_time_get() : 0.0;
+}
+
+static void _cb_stat_end(OFono_Callback_Stat *stat, double start)
+{
+	double t;
+
+	if (!stat)
+		return;
+
+	t = ecore_time_get() - start;
+	stat->calls++;
+	stat->total += t;
+	if (t > stat->max)
+		stat->max = t;
+}
+
+static int _cb_stat_cmp(const void *a, const void *b)
+{
+	const OFono_Callback_Stat *sa = a, *sb = b;
+
+	if (sa->total > sb->total)
+		return -1;
+	return sa->total < sb->total;
+}
+
+Eina_List *ofono_callback_stats_get(unsigned int max)
+{
+	OFono_Callback_Stat *stat;
+	Eina_Iterator *it;
+	Eina_List *stats = NULL;
+
+	if (!cb_stats)
+		return NULL;
+
+	it = eina_hash_iterator_data_new(cb_stats);
+	EINA_ITERATOR_FOREACH(it, stat)
+		stats = eina_list_sorted_insert(stats, _cb_stat_cmp, stat);
+	eina_iterator_free(it);
+
+	while ((stats) && (eina_list_count(stats) > max))
+		stats = eina_list_remove_list(stats, eina_list_last(stats));
+	return stats;
+}
+
+static void _cb_stats_report(void)
+{
+	OFono_Callback_Stat *stat;
+	Eina_List *stats;
+
+	if (!cb_stats)
+		return;
+
+	stats = ofono_callback_stats_get(cb_profile_report);
+	INF("Slowest callbacks: list, added by, calls, total ms, avg us, "
+		"max ms");
+	EINA_LIST_FREE(stats, stat) {
+		INF("%-20s %-28s %8u %10.2f %10.1f %8.2f", stat->list,
+			stat->owner, stat->calls, stat->total * 1000.0,
+			stat->calls ? stat->total * 1e6 / stat->calls : 0.0,
+			stat->max * 1000.0);
+	}
+
+	/* nodes not deleted yet must not keep the freed stats */
+#define CB_STATS_CLEAR(list, type)					\
+	do {								\
+		type *node;						\
+		EINA_INLIST_FOREACH(list, node)				\
+			node->stat = NULL;				\
+	} while (0)
+	CB_STATS_CLEAR(cbs_modem_changed, OFono_Callback_List_Modem_Node);
+	CB_STATS_CLEAR(cbs_modem_connected, OFono_Callback_List_Modem_Node);
+	CB_STATS_CLEAR(cbs_modem_disconnected,
+			OFono_Callback_List_Modem_Node);
+	CB_STATS_CLEAR(cbs_ussd_notify, OFono_Callback_List_USSD_Notify_Node);
+	CB_STATS_CLEAR(cbs_call_changed, OFono_Callback_List_Call_Node);
+	CB_STATS_CLEAR(cbs_call_added, OFono_Callback_List_Call_Node);
+	CB_STATS_CLEAR(cbs_call_disconnected,
+			OFono_Callback_List_Call_Disconnected_Node);
+	CB_STATS_CLEAR(cbs_call_removed, OFono_Callback_List_Call_Node);
+	CB_STATS_CLEAR(cbs_sent_sms_changed,
+			OFono_Callback_List_Sent_SMS_Node);
+	CB_STATS_CLEAR(cbs_incoming_sms,
+			OFono_Callback_List_Incoming_SMS_Node);
+#undef CB_STATS_CLEAR
+
+	eina_hash_free(cb_stats);
+	cb_stats = NULL;
+}
+
 #define OFONO_SERVICE			"org.ofono"
 
 #define OFONO_PREFIX			OFONO_SERVICE "."
@@ -294,13 +471,28 @@ struct _OFono_Bus_Object
 	Eina_List *dbus_signals; /* of E_DBus_Signal_Handler */
 };
 
+static void _call_deferred_add(OFono_Callback_List_Call_Node *node,
+			OFono_Callback_List_Call_Disconnected_Node *dnode,
+			OFono_Call *call, const char *reason);
+
 static void _notify_ofono_callbacks_call_list(Eina_Inlist *list,
 						OFono_Call *call)
 {
 	OFono_Callback_List_Call_Node *node;
 
-	EINA_INLIST_FOREACH(list, node)
+	EINA_INLIST_FOREACH(list, node) {
+		OFono_Callback_Stat *stat = node->stat;
+		double t;
+
+		if (node->priority == OFONO_CALLBACK_PRIORITY_DEFERRED) {
+			_call_deferred_add(node, NULL, call, NULL);
+			continue;
+		}
+
+		t = _cb_stat_start(stat);
 		node->cb((void *) node->cb_data, call);
+		_cb_stat_end(stat, t);
+	}
 }
 
 static void _notify_ofono_callbacks_call_disconnected_list(Eina_Inlist *list,
@@ -311,8 +503,19 @@ static void _notify_ofono_callbacks_call_disconnected_list(Eina_Inlist *list,
 
 	DBG("call=%p, reason=%s", call, reason);
 
-	EINA_INLIST_FOREACH(list, node)
+	EINA_INLIST_FOREACH(list, node) {
+		OFono_Callback_Stat *stat = node->stat;
+		double t;
+
+		if (node->priority == OFONO_CALLBACK_PRIORITY_DEFERRED) {
+			_call_deferred_add(NULL, node, call, reason);
+			continue;
+		}
+
+		t = _cb_stat_start(stat);
 		node->cb((void *) node->cb_data, call, reason);
+		_cb_stat_end(stat, t);
+	}
 }
 
 static void _notify_ofono_callbacks_ussd_notify_list(Eina_Inlist *list,
@@ -323,16 +526,19 @@ static void _notify_ofono_callbacks_ussd_notify_list(Eina_Inlist *list,
 
 	DBG("needs_reply=%hhu, msg=%s", needs_reply, msg);
 
-	EINA_INLIST_FOREACH(list, node)
+	EINA_INLIST_FOREACH(list, node) {
+		OFono_Callback_Stat *stat = node->stat;
+		double t = _cb_stat_start(stat);
 		node->cb((void *) node->cb_data, needs_reply, msg);
+		_cb_stat_end(stat, t);
+	}
 }
 
-static void _bus_object_free(OFono_Bus_Object *o)
+/* no more replies or signals for o */
+static void _bus_object_detach(OFono_Bus_Object *o)
 {
 	E_DBus_Signal_Handler *sh;
 
-	eina_stringshare_del(o->path);
-
 	while (o->dbus_pending) {
 		ofono_pending_cancel(
 			EINA_INLIST_CONTAINER_GET(o->dbus_pending,
@@ -341,7 +547,12 @@ static void _bus_object_free(OFono_Bus_Object *o)
 
 	EINA_LIST_FREE(o->dbus_signals, sh)
 		e_dbus_signal_handler_del(bus_conn, sh);
+}
 
+static void _bus_object_free(OFono_Bus_Object *o)
+{
+	_bus_object_detach(o);
+	eina_stringshare_del(o->path);
 	free(o);
 }
 
@@ -450,6 +661,7 @@ struct _OFono_Call
 	Eina_Bool multiparty : 1;
 	Eina_Bool emergency : 1;
 	OFono_Call_Cb_Context *pending_dial;
+	unsigned int refs; /* the modem's and deferred callbacks' */
 };
 
 typedef struct _OFono_Sent_SMS_Cb_Context
@@ -496,6 +708,7 @@ struct _OFono_Modem
 	Eina_Bool muted : 1;
 	Eina_Bool voicemail_waiting : 1;
 	Eina_Bool use_delivery_reports : 1;
+	Eina_Bool sent_sms_fetched : 1; /* GetMessages answered */
 };
 
 static OFono_Call *_call_new(const char *path)
@@ -507,6 +720,7 @@ static OFono_Call *_call_new(const char *path)
 	EINA_SAFETY_ON_NULL_GOTO(c->base.path, error_path);
 
 	c->start_time = -1.0;
+	c->refs = 1;
 
 	return c;
 
@@ -515,11 +729,10 @@ error_path:
 	return NULL;
 }
 
-static void _call_free(OFono_Call *c)
+static void _call_unref(OFono_Call *c)
 {
-	DBG("c=%p %s", c, c->base.path);
-
-	_notify_ofono_callbacks_call_list(cbs_call_removed, c);
+	if (--c->refs > 0)
+		return;
 
 	eina_stringshare_del(c->line_id);
 	eina_stringshare_del(c->incoming_line);
@@ -528,6 +741,112 @@ static void _call_free(OFono_Call *c)
 	_bus_object_free(&c->base);
 }
 
+/* removed from its modem, deferred callbacks may still hold it */
+static void _call_free(OFono_Call *c)
+{
+	DBG("c=%p %s", c, c->base.path);
+
+	_notify_ofono_callbacks_call_list(cbs_call_removed, c);
+
+	_bus_object_detach(&c->base);
+	_call_unref(c);
+}
+
+typedef struct _OFono_Call_Deferred
+{
+	EINA_INLIST;
+	OFono_Callback_List_Call_Node *node; /* or dnode */
+	OFono_Callback_List_Call_Disconnected_Node *dnode;
+	OFono_Call *call; /* referenced */
+	const char *reason; /* stringshare, disconnected only */
+} OFono_Call_Deferred;
+
+static Eina_Inlist *call_deferred = NULL; /* oldest first */
+static Ecore_Idler *call_deferred_idler = NULL;
+
+static void _call_deferred_free(OFono_Call_Deferred *d)
+{
+	eina_stringshare_del(d->reason);
+	_call_unref(d->call);
+	free(d);
+}
+
+static void _call_deferred_run(OFono_Call_Deferred *d)
+{
+	OFono_Callback_Stat *stat;
+	double t;
+
+	if (d->node) {
+		stat = d->node->stat;
+		t = _cb_stat_start(stat);
+		d->node->cb((void *) d->node->cb_data, d->call);
+	} else {
+		stat = d->dnode->stat;
+		t = _cb_stat_start(stat);
+		d->dnode->cb((void *) d->dnode->cb_data, d->call, d->reason);
+	}
+	_cb_stat_end(stat, t);
+}
+
+/* out of the queue before running, the callback may delete its node */
+static void _call_deferred_flush(void)
+{
+	OFono_Call_Deferred *d;
+
+	while (call_deferred) {
+		d = EINA_INLIST_CONTAINER_GET(call_deferred,
+						OFono_Call_Deferred);
+		call_deferred = eina_inlist_remove(call_deferred,
+							call_deferred);
+		_call_deferred_run(d);
+		_call_deferred_free(d);
+	}
+}
+
+static Eina_Bool _call_deferred_idler_cb(void *data __UNUSED__)
+{
+	_call_deferred_flush();
+	call_deferred_idler = NULL;
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _call_deferred_add(OFono_Callback_List_Call_Node *node,
+			OFono_Callback_List_Call_Disconnected_Node *dnode,
+			OFono_Call *call, const char *reason)
+{
+	OFono_Call_Deferred *d;
+
+	d = calloc(1, sizeof(OFono_Call_Deferred));
+	EINA_SAFETY_ON_NULL_RETURN(d);
+
+	d->node = node;
+	d->dnode = dnode;
+	d->call = call;
+	call->refs++;
+	d->reason = eina_stringshare_add(reason);
+
+	call_deferred = eina_inlist_append(call_deferred, EINA_INLIST_GET(d));
+	if (!call_deferred_idler)
+		call_deferred_idler = ecore_idler_add(_call_deferred_idler_cb,
+							NULL);
+}
+
+/* events of a callback deleted before they ran */
+static void _call_deferred_node_del(const void *node)
+{
+	OFono_Call_Deferred *d;
+	Eina_Inlist *next;
+
+	EINA_INLIST_FOREACH_SAFE(call_deferred, next, d) {
+		if (((const void *)d->node != node) &&
+			((const void *)d->dnode != node))
+			continue;
+		call_deferred = eina_inlist_remove(call_deferred,
+							EINA_INLIST_GET(d));
+		_call_deferred_free(d);
+	}
+}
+
 static OFono_Call_State _call_state_parse(const char *str)
 {
 	if (strcmp(str, "active") == 0)
@@ -759,11 +1078,13 @@ static void _call_added(void *data, DBusMessage *msg)
 	}
 
 	dbus_message_iter_get_basic(&iter, &path);
+	trace_mark(path, "ofono-call-added");
 
 	dbus_message_iter_next(&iter);
 	dbus_message_iter_recurse(&iter, &properties);
 
 	_call_add(m, path, &properties);
+	trace_mark(path, "ofono-call-notified");
 }
 
 static void _call_removed(void *data, DBusMessage *msg)
@@ -964,6 +1285,12 @@ const char *ofono_call_name_get(const OFono_Call *c)
 	return c->name;
 }
 
+const char *ofono_call_path_get(const OFono_Call *c)
+{
+	EINA_SAFETY_ON_NULL_RETURN_VAL(c, NULL);
+	return c->base.path;
+}
+
 const char *ofono_call_line_id_get(const OFono_Call *c)
 {
 	EINA_SAFETY_ON_NULL_RETURN_VAL(c, NULL);
@@ -1053,6 +1380,15 @@ error_path:
 static void _sent_sms_free(OFono_Sent_SMS *sms)
 {
 	DBG("sms=%p %s", sms, sms->base.path);
+	if (sms->pending_send) {
+		OFono_Sent_SMS_Cb_Context *ctx = sms->pending_send;
+		/* gone before MessageAdded, do not leave the sender waiting */
+		if (ctx->cb)
+			ctx->cb((void *)ctx->data, OFONO_ERROR_FAILED, NULL);
+		eina_stringshare_del(ctx->destination);
+		eina_stringshare_del(ctx->message);
+		free(ctx);
+	}
 	eina_stringshare_del(sms->destination);
 	eina_stringshare_del(sms->message);
 	_bus_object_free(&sms->base);
@@ -1201,8 +1537,12 @@ static void _notify_ofono_callbacks_modem_list(Eina_Inlist *list)
 {
 	OFono_Callback_List_Modem_Node *node;
 
-	EINA_INLIST_FOREACH(list, node)
+	EINA_INLIST_FOREACH(list, node) {
+		OFono_Callback_Stat *stat = node->stat;
+		double t = _cb_stat_start(stat);
 		node->cb((void *) node->cb_data);
+		_cb_stat_end(stat, t);
+	}
 }
 
 static void _call_volume_property_changed(void *data, DBusMessage *msg)
@@ -1345,8 +1685,12 @@ static void _notify_ofono_callbacks_sent_sms(OFono_Error err,
 {
 	OFono_Callback_List_Sent_SMS_Node *node;
 
-	EINA_INLIST_FOREACH(cbs_sent_sms_changed, node)
+	EINA_INLIST_FOREACH(cbs_sent_sms_changed, node) {
+		OFono_Callback_Stat *stat = node->stat;
+		double t = _cb_stat_start(stat);
 		node->cb((void *) node->cb_data, err, sms);
+		_cb_stat_end(stat, t);
+	}
 }
 
 static void _sent_sms_property_changed(void *data, DBusMessage *msg)
@@ -1378,8 +1722,11 @@ static void _notify_ofono_callbacks_incoming_sms(unsigned int sms_class,
 	OFono_Callback_List_Incoming_SMS_Node *node;
 
 	EINA_INLIST_FOREACH(cbs_incoming_sms, node) {
+		OFono_Callback_Stat *stat = node->stat;
+		double t = _cb_stat_start(stat);
 		node->cb((void *) node->cb_data, sms_class, timestamp, sender,
 			message);
+		_cb_stat_end(stat, t);
 	}
 }
 
@@ -1483,7 +1830,9 @@ static OFono_Sent_SMS *_sent_sms_pending_add(OFono_Modem *m, const char *path,
 	return sms;
 }
 
-static void _msg_add(OFono_Modem *m, const char *path, DBusMessageIter *prop)
+/* adds the message or updates the one known by path */
+static OFono_Sent_SMS *_msg_update(OFono_Modem *m, const char *path,
+					DBusMessageIter *prop)
 {
 	OFono_Sent_SMS *sms;
 
@@ -1494,7 +1843,7 @@ static void _msg_add(OFono_Modem *m, const char *path, DBusMessageIter *prop)
 		DBG("SMS already exists %p (%s)", sms, path);
 	else {
 		sms = _sent_sms_common_add(m, path);
-		EINA_SAFETY_ON_NULL_RETURN(sms);
+		EINA_SAFETY_ON_NULL_RETURN_VAL(sms, NULL);
 	}
 
 	for (; dbus_message_iter_get_arg_type(prop) == DBUS_TYPE_DICT_ENTRY;
@@ -1511,6 +1860,15 @@ static void _msg_add(OFono_Modem *m, const char *path, DBusMessageIter *prop)
 		_sent_sms_property_update(sms, key, &value);
 	}
 
+	return sms;
+}
+
+static void _msg_add(OFono_Modem *m, const char *path, DBusMessageIter *prop)
+{
+	OFono_Sent_SMS *sms = _msg_update(m, path, prop);
+
+	EINA_SAFETY_ON_NULL_RETURN(sms);
+
 	if (sms->pending_send) {
 		OFono_Sent_SMS_Cb_Context *ctx = sms->pending_send;
 		sms->destination = ctx->destination;
@@ -1624,8 +1982,10 @@ static void _modem_update_interfaces(OFono_Modem *m, unsigned int ifaces)
 		_ofono_suppl_serv_properties_get(m);
 
 	if (((m->interfaces & OFONO_API_MSG) == 0) &&
-		(ifaces & OFONO_API_MSG) == OFONO_API_MSG)
+		(ifaces & OFONO_API_MSG) == OFONO_API_MSG) {
 		_ofono_msg_properties_get(m);
+		_ofono_msg_messages_get(m);
+	}
 }
 
 static void _modem_property_update(OFono_Modem *m, const char *key,
@@ -1848,6 +2208,64 @@ static void _ofono_msg_properties_get_reply(void *data,	DBusMessage *msg,
 	_notify_ofono_callbacks_modem_list(cbs_modem_changed);
 }
 
+static void _ofono_msg_messages_get_reply(void *data, DBusMessage *msg,
+						DBusError *err)
+{
+	OFono_Modem *m = data;
+	DBusMessageIter iter, array;
+	unsigned int count = 0;
+
+	/* known or not, there is nothing more to wait for */
+	m->sent_sms_fetched = EINA_TRUE;
+
+	if (dbus_error_is_set(err)) {
+		DBG("%s: %s", err->name, err->message);
+		goto end;
+	}
+
+	if ((!dbus_message_iter_init(msg, &iter)) ||
+		(dbus_message_iter_get_arg_type(&iter) != DBUS_TYPE_ARRAY)) {
+		ERR("Unexpected GetMessages reply");
+		goto end;
+	}
+
+	dbus_message_iter_recurse(&iter, &array);
+	for (; dbus_message_iter_get_arg_type(&array) == DBUS_TYPE_STRUCT;
+			dbus_message_iter_next(&array)) {
+		DBusMessageIter entry, properties;
+		const char *path;
+
+		dbus_message_iter_recurse(&array, &entry);
+		dbus_message_iter_get_basic(&entry, &path);
+		dbus_message_iter_next(&entry);
+		dbus_message_iter_recurse(&entry, &properties);
+
+		/* not ours, nobody to notify until their state changes */
+		_msg_update(m, path, &properties);
+		count++;
+	}
+	DBG("m=%s, %u messages", m->base.path, count);
+
+end:
+	_notify_ofono_callbacks_modem_list(cbs_modem_changed);
+}
+
+/* messages oFono was sending before we started */
+static void _ofono_msg_messages_get(OFono_Modem *m)
+{
+	DBusMessage *msg;
+	msg = dbus_message_new_method_call(bus_id, m->base.path,
+						OFONO_PREFIX
+						OFONO_MSG_IFACE,
+						"GetMessages");
+	DBG("m=%s", m->base.path);
+	EINA_SAFETY_ON_NULL_RETURN(msg);
+
+	m->sent_sms_fetched = EINA_FALSE;
+	_bus_object_message_send(&m->base, msg,
+				_ofono_msg_messages_get_reply, m);
+}
+
 static void _ofono_msg_properties_get(OFono_Modem *m)
 {
 	DBusMessage *msg;
@@ -3067,10 +3485,19 @@ void ofono_shutdown(void)
 	_ofono_disconnected();
 	eina_stringshare_replace(&modem_path_wanted, NULL);
 
+	/* calls removed by the above included */
+	if (call_deferred_idler) {
+		ecore_idler_del(call_deferred_idler);
+		call_deferred_idler = NULL;
+	}
+	_call_deferred_flush();
+
 	eina_hash_free(modems);
 	modems = NULL;
 
 	eina_list_free(modem_types);
+
+	_cb_stats_report();
 }
 
 static OFono_Pending *_ofono_call_volume_property_set(char *property,
@@ -3258,6 +3685,37 @@ time_t ofono_sent_sms_timestamp_get(const OFono_Sent_SMS *sms)
 	return sms->timestamp;
 }
 
+static Eina_Bool _sent_sms_pending_count(const Eina_Hash *hash __UNUSED__,
+					const void *key __UNUSED__,
+					void *data, void *fdata)
+{
+	const OFono_Sent_SMS *sms = data;
+	unsigned int *count = fdata;
+
+	if (sms->state == OFONO_SENT_SMS_STATE_PENDING)
+		(*count)++;
+	return EINA_TRUE;
+}
+
+Eina_Bool ofono_sent_sms_fetched_get(void)
+{
+	OFono_Modem *m = _modem_selected_get();
+
+	return m ? m->sent_sms_fetched : EINA_FALSE;
+}
+
+unsigned int ofono_sent_sms_pending_count_get(void)
+{
+	OFono_Modem *m = _modem_selected_get();
+	unsigned int count = 0;
+
+	if (!m)
+		return 0;
+
+	eina_hash_foreach(m->sent_sms, _sent_sms_pending_count, &count);
+	return count;
+}
+
 OFono_Pending *ofono_sent_sms_cancel(OFono_Sent_SMS *sms, OFono_Simple_Cb cb,
 					const void *data)
 {
@@ -3321,15 +3779,23 @@ static void _ofono_sms_send_reply(void *data, DBusMessage *msg, DBusError *err)
 					 */
 					return;
 				}
+				ERR("Could not add sms %s", path);
+				oe = OFONO_ERROR_FAILED;
+			} else if (!sms->destination) {
+				/* MessageAdded or GetMessages came first */
+				sms->destination = ctx->destination;
+				sms->message = ctx->message;
+				sms->timestamp = time(NULL);
+				ctx->destination = NULL;
+				ctx->message = NULL;
 			}
-
-			ERR("Could not find sms %s", path);
-			oe = OFONO_ERROR_FAILED;
 		}
 	}
 
 	if (ctx->cb)
 		ctx->cb((void *)ctx->data, oe, sms);
+	if (sms)
+		_notify_ofono_callbacks_sent_sms(OFONO_ERROR_NONE, sms);
 
 	eina_stringshare_del(ctx->destination);
 	eina_stringshare_del(ctx->message);
@@ -3387,6 +3853,259 @@ error:
 	return NULL;
 }
 
+#define SMS_QUEUE_RETRIES 3
+#define SMS_QUEUE_DELAY 2.0
+
+typedef struct _OFono_SMS_Queue_Item
+{
+	EINA_INLIST;
+	OFono_SMS_Queue *queue; /* NULL once the queue is freed */
+	const char *number;
+	const char *message;
+	const void *data;
+	Ecore_Timer *retry;
+	unsigned int tries;
+	double pushed;
+} OFono_SMS_Queue_Item;
+
+struct _OFono_SMS_Queue
+{
+	OFono_SMS_Queue_Cb cb;
+	const void *data;
+	unsigned int window;
+	unsigned int retries;
+	double delay;
+	Eina_Inlist *waiting;
+	Eina_Inlist *sending; /* or waiting to retry */
+	OFono_SMS_Queue_Stats stats;
+	double busy_since;
+	double latency_total;
+	Eina_Bool processing;
+};
+
+static void _sms_queue_process(OFono_SMS_Queue *q);
+
+static void _sms_queue_item_free(OFono_SMS_Queue_Item *item)
+{
+	if (item->retry)
+		ecore_timer_del(item->retry);
+	eina_stringshare_del(item->number);
+	eina_stringshare_del(item->message);
+	free(item);
+}
+
+static void _sms_queue_notify(OFono_SMS_Queue *q, OFono_SMS_Queue_Item *item,
+				OFono_SMS_Queue_State state, OFono_Error error,
+				OFono_Sent_SMS *sms)
+{
+	if (q->cb)
+		q->cb((void *)q->data, (void *)item->data, item->number,
+			state, error, sms);
+}
+
+static void _sms_queue_item_done(OFono_SMS_Queue *q,
+					OFono_SMS_Queue_Item *item)
+{
+	q->sending = eina_inlist_remove(q->sending, EINA_INLIST_GET(item));
+	q->stats.sending--;
+	_sms_queue_item_free(item);
+
+	if ((!q->waiting) && (!q->sending))
+		q->stats.busy_time += ecore_loop_time_get() - q->busy_since;
+}
+
+static Eina_Bool _sms_queue_item_retry(void *data);
+
+static void _sms_queue_item_reply(void *data, OFono_Error err,
+					OFono_Sent_SMS *sms)
+{
+	OFono_SMS_Queue_Item *item = data;
+	OFono_SMS_Queue *q = item->queue;
+	double latency;
+
+	if (!q) {
+		_sms_queue_item_free(item);
+		return;
+	}
+
+	if (err == OFONO_ERROR_NONE) {
+		latency = ecore_loop_time_get() - item->pushed;
+		q->latency_total += latency;
+		if (latency > q->stats.latency_max)
+			q->stats.latency_max = latency;
+		q->stats.sent++;
+		_sms_queue_notify(q, item, OFONO_SMS_QUEUE_STATE_SENT, err, sms);
+		_sms_queue_item_done(q, item);
+	} else if (((err == OFONO_ERROR_IN_PROGRESS) ||
+			(err == OFONO_ERROR_TIMEDOUT)) &&
+			(item->tries <= q->retries)) {
+		double delay = q->delay * (1 << (item->tries - 1));
+
+		DBG("retry %s in %0.1fs: %s", item->number, delay,
+			ofono_error_message_get(err));
+		q->stats.retries++;
+		/* still counts in the window, so the modem gets a break */
+		item->retry = ecore_timer_add(delay, _sms_queue_item_retry,
+						item);
+		_sms_queue_notify(q, item, OFONO_SMS_QUEUE_STATE_RETRY, err,
+					NULL);
+		return;
+	} else {
+		DBG("failed %s: %s", item->number,
+			ofono_error_message_get(err));
+		q->stats.failed++;
+		_sms_queue_notify(q, item, OFONO_SMS_QUEUE_STATE_FAILED, err,
+					NULL);
+		_sms_queue_item_done(q, item);
+	}
+
+	_sms_queue_process(q);
+}
+
+static void _sms_queue_item_send(OFono_SMS_Queue *q,
+					OFono_SMS_Queue_Item *item)
+{
+	item->tries++;
+	_sms_queue_notify(q, item, OFONO_SMS_QUEUE_STATE_SENDING,
+				OFONO_ERROR_NONE, NULL);
+	/* on errors the reply is called before this returns */
+	ofono_sms_send(item->number, item->message, _sms_queue_item_reply,
+			item);
+}
+
+static Eina_Bool _sms_queue_item_retry(void *data)
+{
+	OFono_SMS_Queue_Item *item = data;
+
+	item->retry = NULL;
+	_sms_queue_item_send(item->queue, item);
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _sms_queue_process(OFono_SMS_Queue *q)
+{
+	OFono_SMS_Queue_Item *item;
+
+	if (q->processing)
+		return;
+
+	q->processing = EINA_TRUE;
+	while ((q->waiting) && (q->stats.sending < q->window)) {
+		item = EINA_INLIST_CONTAINER_GET(q->waiting,
+							OFono_SMS_Queue_Item);
+		q->waiting = eina_inlist_remove(q->waiting,
+						EINA_INLIST_GET(item));
+		q->stats.waiting--;
+		q->sending = eina_inlist_append(q->sending,
+						EINA_INLIST_GET(item));
+		q->stats.sending++;
+		_sms_queue_item_send(q, item);
+	}
+	q->processing = EINA_FALSE;
+}
+
+OFono_SMS_Queue *ofono_sms_queue_new(unsigned int window,
+					OFono_SMS_Queue_Cb cb,
+					const void *data)
+{
+	OFono_SMS_Queue *q;
+
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(window == 0, NULL);
+
+	q = calloc(1, sizeof(OFono_SMS_Queue));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(q, NULL);
+
+	q->cb = cb;
+	q->data = data;
+	q->window = window;
+	q->retries = SMS_QUEUE_RETRIES;
+	q->delay = SMS_QUEUE_DELAY;
+	return q;
+}
+
+void ofono_sms_queue_free(OFono_SMS_Queue *q)
+{
+	OFono_SMS_Queue_Item *item;
+
+	EINA_SAFETY_ON_NULL_RETURN(q);
+
+	while (q->waiting) {
+		item = EINA_INLIST_CONTAINER_GET(q->waiting,
+							OFono_SMS_Queue_Item);
+		q->waiting = eina_inlist_remove(q->waiting, q->waiting);
+		_sms_queue_item_free(item);
+	}
+
+	while (q->sending) {
+		item = EINA_INLIST_CONTAINER_GET(q->sending,
+							OFono_SMS_Queue_Item);
+		q->sending = eina_inlist_remove(q->sending, q->sending);
+		/* the ones oFono has are freed on its reply */
+		if (item->retry)
+			_sms_queue_item_free(item);
+		else
+			item->queue = NULL;
+	}
+
+	free(q);
+}
+
+void ofono_sms_queue_retry_set(OFono_SMS_Queue *q, unsigned int retries,
+				double delay)
+{
+	EINA_SAFETY_ON_NULL_RETURN(q);
+	EINA_SAFETY_ON_TRUE_RETURN(delay < 0.0);
+
+	q->retries = retries;
+	q->delay = delay;
+}
+
+Eina_Bool ofono_sms_queue_push(OFono_SMS_Queue *q, const char *number,
+				const char *message, const void *item_data)
+{
+	OFono_SMS_Queue_Item *item;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(q, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(number, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(message, EINA_FALSE);
+
+	item = calloc(1, sizeof(OFono_SMS_Queue_Item));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(item, EINA_FALSE);
+
+	item->queue = q;
+	item->number = eina_stringshare_add(number);
+	item->message = eina_stringshare_add(message);
+	item->data = item_data;
+	item->pushed = ecore_loop_time_get();
+
+	if ((!q->waiting) && (!q->sending))
+		q->busy_since = item->pushed;
+
+	q->waiting = eina_inlist_append(q->waiting, EINA_INLIST_GET(item));
+	q->stats.waiting++;
+	q->stats.queued++;
+	_sms_queue_notify(q, item, OFONO_SMS_QUEUE_STATE_WAITING,
+				OFONO_ERROR_NONE, NULL);
+
+	_sms_queue_process(q);
+	return EINA_TRUE;
+}
+
+void ofono_sms_queue_stats_get(const OFono_SMS_Queue *q,
+				OFono_SMS_Queue_Stats *stats)
+{
+	EINA_SAFETY_ON_NULL_RETURN(q);
+	EINA_SAFETY_ON_NULL_RETURN(stats);
+
+	*stats = q->stats;
+	if ((q->waiting) || (q->sending))
+		stats->busy_time += ecore_loop_time_get() - q->busy_since;
+	if (stats->busy_time > 0.0)
+		stats->rate = stats->sent / stats->busy_time;
+	if (stats->sent)
+		stats->latency_avg = q->latency_total / stats->sent;
+}
+
 OFono_Pending *ofono_tones_send(const char *tones,
 						OFono_Simple_Cb cb,
 						const void *data)
@@ -3430,6 +4149,236 @@ error_no_dbus_message:
 	return NULL;
 }
 
+typedef struct _OFono_Tones_Queue_Call
+{
+	EINA_INLIST;
+	OFono_Tones_Queue *queue; /* NULL once the queue is freed */
+	char *tones;
+	double *pushed; /* of each tone */
+} OFono_Tones_Queue_Call;
+
+struct _OFono_Tones_Queue
+{
+	OFono_Tones_Queue_Cb cb;
+	const void *data;
+	unsigned int depth;
+	double coalesce;
+	Eina_Strbuf *todo;
+	Eina_Inarray *pushed; /* double, of each tone in todo */
+	Eina_Inlist *sending;
+	unsigned int in_flight;
+	Ecore_Timer *coalescer;
+	OFono_Tones_Queue_Stats stats;
+	double latency_total;
+	Eina_Bool processing;
+};
+
+static void _tones_queue_process(OFono_Tones_Queue *q, Eina_Bool flush);
+
+static void _tones_queue_call_free(OFono_Tones_Queue_Call *call)
+{
+	free(call->tones);
+	free(call->pushed);
+	free(call);
+}
+
+static void _tones_queue_call_reply(void *data, OFono_Error err)
+{
+	OFono_Tones_Queue_Call *call = data;
+	OFono_Tones_Queue *q = call->queue;
+	double now, latency;
+	unsigned int i, count;
+
+	if (!q) {
+		_tones_queue_call_free(call);
+		return;
+	}
+
+	q->sending = eina_inlist_remove(q->sending, EINA_INLIST_GET(call));
+	q->in_flight--;
+
+	count = strlen(call->tones);
+	if (err == OFONO_ERROR_NONE) {
+		now = ecore_loop_time_get();
+		for (i = 0; i < count; i++) {
+			latency = now - call->pushed[i];
+			q->latency_total += latency;
+			if (latency > q->stats.latency_max)
+				q->stats.latency_max = latency;
+		}
+		q->stats.sent += count;
+		DBG("sent %s, first tone after %0.3fs", call->tones,
+			now - call->pushed[0]);
+	} else {
+		DBG("failed %s: %s", call->tones,
+			ofono_error_message_get(err));
+		q->stats.failed += count;
+	}
+
+	if (q->cb)
+		q->cb((void *)q->data, call->tones, err);
+	_tones_queue_call_free(call);
+
+	_tones_queue_process(q, EINA_FALSE);
+}
+
+static Eina_Bool _tones_queue_send(OFono_Tones_Queue *q)
+{
+	OFono_Tones_Queue_Call *call;
+	unsigned int count;
+
+	if (q->coalescer) {
+		ecore_timer_del(q->coalescer);
+		q->coalescer = NULL;
+	}
+
+	count = eina_strbuf_length_get(q->todo);
+	call = calloc(1, sizeof(OFono_Tones_Queue_Call));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(call, EINA_FALSE);
+	call->pushed = malloc(count * sizeof(double));
+	EINA_SAFETY_ON_NULL_GOTO(call->pushed, err_pushed);
+
+	memcpy(call->pushed, eina_inarray_nth(q->pushed, 0),
+		count * sizeof(double));
+	call->tones = eina_strbuf_string_steal(q->todo);
+	eina_inarray_flush(q->pushed);
+	call->queue = q;
+
+	q->sending = eina_inlist_append(q->sending, EINA_INLIST_GET(call));
+	q->in_flight++;
+	q->stats.calls++;
+
+	/* on errors the reply is called before this returns */
+	ofono_tones_send(call->tones, _tones_queue_call_reply, call);
+	return EINA_TRUE;
+
+err_pushed:
+	free(call);
+	return EINA_FALSE;
+}
+
+static Eina_Bool _tones_queue_coalesced(void *data)
+{
+	OFono_Tones_Queue *q = data;
+
+	q->coalescer = NULL;
+	_tones_queue_process(q, EINA_TRUE);
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _tones_queue_process(OFono_Tones_Queue *q, Eina_Bool flush)
+{
+	double waited;
+
+	if (q->processing)
+		return;
+
+	q->processing = EINA_TRUE;
+	while ((eina_strbuf_length_get(q->todo) > 0) &&
+		(q->in_flight < q->depth)) {
+		/* oFono is busy, wait a bit for more tones to go along */
+		waited = ecore_loop_time_get() -
+			*(double *)eina_inarray_nth(q->pushed, 0);
+		if ((!flush) && (q->in_flight > 0) &&
+			(waited < q->coalesce)) {
+			if (!q->coalescer)
+				q->coalescer = ecore_timer_add(
+					q->coalesce - waited,
+					_tones_queue_coalesced, q);
+			break;
+		}
+		if (!_tones_queue_send(q))
+			break;
+		flush = EINA_FALSE;
+	}
+	q->processing = EINA_FALSE;
+}
+
+OFono_Tones_Queue *ofono_tones_queue_new(unsigned int depth, double coalesce,
+						OFono_Tones_Queue_Cb cb,
+						const void *data)
+{
+	OFono_Tones_Queue *q;
+
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(depth == 0, NULL);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(coalesce < 0.0, NULL);
+
+	q = calloc(1, sizeof(OFono_Tones_Queue));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(q, NULL);
+
+	q->todo = eina_strbuf_new();
+	EINA_SAFETY_ON_NULL_GOTO(q->todo, err_todo);
+	q->pushed = eina_inarray_new(sizeof(double), 16);
+	EINA_SAFETY_ON_NULL_GOTO(q->pushed, err_pushed);
+
+	q->cb = cb;
+	q->data = data;
+	q->depth = depth;
+	q->coalesce = coalesce;
+	return q;
+
+err_pushed:
+	eina_strbuf_free(q->todo);
+err_todo:
+	free(q);
+	return NULL;
+}
+
+void ofono_tones_queue_free(OFono_Tones_Queue *q)
+{
+	OFono_Tones_Queue_Call *call;
+
+	EINA_SAFETY_ON_NULL_RETURN(q);
+
+	/* the ones oFono has are freed on its reply */
+	while (q->sending) {
+		call = EINA_INLIST_CONTAINER_GET(q->sending,
+						OFono_Tones_Queue_Call);
+		q->sending = eina_inlist_remove(q->sending, q->sending);
+		call->queue = NULL;
+	}
+
+	if (q->coalescer)
+		ecore_timer_del(q->coalescer);
+	eina_strbuf_free(q->todo);
+	eina_inarray_free(q->pushed);
+	free(q);
+}
+
+Eina_Bool ofono_tones_queue_push(OFono_Tones_Queue *q, const char *tones)
+{
+	double now;
+	size_t i;
+
+	EINA_SAFETY_ON_NULL_RETURN_VAL(q, EINA_FALSE);
+	EINA_SAFETY_ON_NULL_RETURN_VAL(tones, EINA_FALSE);
+
+	now = ecore_loop_time_get();
+	for (i = 0; tones[i] != '\0'; i++) {
+		if (eina_inarray_push(q->pushed, &now) < 0)
+			return EINA_FALSE;
+		if (!eina_strbuf_append_char(q->todo, tones[i])) {
+			eina_inarray_pop(q->pushed);
+			return EINA_FALSE;
+		}
+		q->stats.queued++;
+	}
+
+	_tones_queue_process(q, EINA_FALSE);
+	return EINA_TRUE;
+}
+
+void ofono_tones_queue_stats_get(const OFono_Tones_Queue *q,
+					OFono_Tones_Queue_Stats *stats)
+{
+	EINA_SAFETY_ON_NULL_RETURN(q);
+	EINA_SAFETY_ON_NULL_RETURN(stats);
+
+	*stats = q->stats;
+	if (stats->sent)
+		stats->latency_avg = q->latency_total / stats->sent;
+}
+
 OFono_Pending *ofono_multiparty_create(OFono_Simple_Cb cb,
 					const void *data)
 {
@@ -3499,13 +4448,15 @@ static OFono_Callback_List_Modem_Node * _ofono_callback_modem_node_create(
 }
 
 OFono_Callback_List_Modem_Node *
-ofono_modem_conected_cb_add(void (*cb)(void *data), const void *data)
+ofono_modem_conected_cb_add_full(void (*cb)(void *data), const void *data,
+					const char *owner)
 {
 	OFono_Callback_List_Modem_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
 	node = _ofono_callback_modem_node_create(cb, data);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("modem_connected", owner);
 
 	cbs_modem_connected = eina_inlist_append(cbs_modem_connected,
 							EINA_INLIST_GET(node));
@@ -3514,13 +4465,15 @@ ofono_modem_conected_cb_add(void (*cb)(void *data), const void *data)
 }
 
 OFono_Callback_List_Modem_Node *
-ofono_modem_disconnected_cb_add(void (*cb)(void *data), const void *data)
+ofono_modem_disconnected_cb_add_full(void (*cb)(void *data), const void *data,
+					const char *owner)
 {
 	OFono_Callback_List_Modem_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
 	node = _ofono_callback_modem_node_create(cb, data);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("modem_disconnected", owner);
 
 	cbs_modem_disconnected = eina_inlist_append(cbs_modem_disconnected,
 							EINA_INLIST_GET(node));
@@ -3529,13 +4482,15 @@ ofono_modem_disconnected_cb_add(void (*cb)(void *data), const void *data)
 }
 
 OFono_Callback_List_Modem_Node *
-ofono_modem_changed_cb_add(void (*cb)(void *data), const void *data)
+ofono_modem_changed_cb_add_full(void (*cb)(void *data), const void *data,
+				const char *owner)
 {
 	OFono_Callback_List_Modem_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
 	node = _ofono_callback_modem_node_create(cb, data);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("modem_changed", owner);
 
 	cbs_modem_changed = eina_inlist_append(cbs_modem_changed,
 						EINA_INLIST_GET(node));
@@ -3569,8 +4524,39 @@ void ofono_modem_connected_cb_del(OFono_Callback_List_Modem_Node *node)
 	_ofono_callback_modem_list_delete(&cbs_modem_connected, node);
 }
 
+/* after the callbacks of the same or a more urgent class */
+static Eina_Inlist *_ofono_callback_call_list_insert(Eina_Inlist *list,
+					OFono_Callback_List_Call_Node *node)
+{
+	OFono_Callback_List_Call_Node *itr;
+
+	EINA_INLIST_FOREACH(list, itr) {
+		if (itr->priority > node->priority)
+			return eina_inlist_prepend_relative(list,
+							EINA_INLIST_GET(node),
+							EINA_INLIST_GET(itr));
+	}
+	return eina_inlist_append(list, EINA_INLIST_GET(node));
+}
+
+static Eina_Inlist *_ofono_callback_call_disconnected_list_insert(
+			Eina_Inlist *list,
+			OFono_Callback_List_Call_Disconnected_Node *node)
+{
+	OFono_Callback_List_Call_Disconnected_Node *itr;
+
+	EINA_INLIST_FOREACH(list, itr) {
+		if (itr->priority > node->priority)
+			return eina_inlist_prepend_relative(list,
+							EINA_INLIST_GET(node),
+							EINA_INLIST_GET(itr));
+	}
+	return eina_inlist_append(list, EINA_INLIST_GET(node));
+}
+
 static OFono_Callback_List_Call_Node *_ofono_callback_call_node_create(
-	void (*cb)(void *data, OFono_Call *call),const void *data)
+	void (*cb)(void *data, OFono_Call *call),const void *data,
+	OFono_Callback_Priority priority)
 {
 	OFono_Callback_List_Call_Node *node;
 
@@ -3579,6 +4565,7 @@ static OFono_Callback_List_Call_Node *_ofono_callback_call_node_create(
 
 	node->cb_data = data;
 	node->cb = cb;
+	node->priority = priority;
 
 	return node;
 }
@@ -3586,7 +4573,7 @@ static OFono_Callback_List_Call_Node *_ofono_callback_call_node_create(
 static OFono_Callback_List_Call_Disconnected_Node *
 _ofono_callback_call_disconnected_node_create(
 	void (*cb)(void *data, OFono_Call *call, const char *reason),
-	const void *data)
+	const void *data, OFono_Callback_Priority priority)
 {
 	OFono_Callback_List_Call_Disconnected_Node *node;
 
@@ -3595,6 +4582,7 @@ _ofono_callback_call_disconnected_node_create(
 
 	node->cb_data = data;
 	node->cb = cb;
+	node->priority = priority;
 
 	return node;
 }
@@ -3615,76 +4603,91 @@ _ofono_callback_ussd_notify_node_create(
 	return node;
 }
 
-OFono_Callback_List_Call_Node *ofono_call_added_cb_add(
-	void (*cb)(void *data,OFono_Call *call), const void *data)
+OFono_Callback_List_Call_Node *ofono_call_added_cb_add_full(
+	void (*cb)(void *data,OFono_Call *call), const void *data,
+	OFono_Callback_Priority priority, const char *owner)
 {
 	OFono_Callback_List_Call_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
-	node = _ofono_callback_call_node_create(cb, data);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(
+		priority > OFONO_CALLBACK_PRIORITY_DEFERRED, NULL);
+	node = _ofono_callback_call_node_create(cb, data, priority);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("call_added", owner);
 
-	cbs_call_added = eina_inlist_append(cbs_call_added,
-						EINA_INLIST_GET(node));
+	cbs_call_added = _ofono_callback_call_list_insert(cbs_call_added, node);
 
 	return node;
 }
 
-OFono_Callback_List_Call_Node *ofono_call_removed_cb_add(
-	void (*cb)(void *data, OFono_Call *call), const void *data)
+OFono_Callback_List_Call_Node *ofono_call_removed_cb_add_full(
+	void (*cb)(void *data, OFono_Call *call), const void *data,
+	OFono_Callback_Priority priority, const char *owner)
 {
 	OFono_Callback_List_Call_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
-	node = _ofono_callback_call_node_create(cb, data);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(
+		priority > OFONO_CALLBACK_PRIORITY_DEFERRED, NULL);
+	node = _ofono_callback_call_node_create(cb, data, priority);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("call_removed", owner);
 
-	cbs_call_removed = eina_inlist_append(cbs_call_removed,
-						EINA_INLIST_GET(node));
+	cbs_call_removed = _ofono_callback_call_list_insert(cbs_call_removed, node);
 
 	return node;
 }
 
-OFono_Callback_List_Call_Node *ofono_call_changed_cb_add(
-	void (*cb)(void *data, OFono_Call *call), const void *data)
+OFono_Callback_List_Call_Node *ofono_call_changed_cb_add_full(
+	void (*cb)(void *data, OFono_Call *call), const void *data,
+	OFono_Callback_Priority priority, const char *owner)
 {
 	OFono_Callback_List_Call_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
-	node = _ofono_callback_call_node_create(cb, data);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(
+		priority > OFONO_CALLBACK_PRIORITY_DEFERRED, NULL);
+	node = _ofono_callback_call_node_create(cb, data, priority);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("call_changed", owner);
 
-	cbs_call_changed = eina_inlist_append(cbs_call_changed,
-						EINA_INLIST_GET(node));
+	cbs_call_changed = _ofono_callback_call_list_insert(cbs_call_changed, node);
 
 	return node;
 }
 
-OFono_Callback_List_Call_Disconnected_Node *ofono_call_disconnected_cb_add(
+OFono_Callback_List_Call_Disconnected_Node *ofono_call_disconnected_cb_add_full(
 	void (*cb)(void *data, OFono_Call *call, const char *reason),
-	const void *data)
+	const void *data, OFono_Callback_Priority priority,
+	const char *owner)
 {
 	OFono_Callback_List_Call_Disconnected_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
-	node = _ofono_callback_call_disconnected_node_create(cb, data);
+	EINA_SAFETY_ON_TRUE_RETURN_VAL(
+		priority > OFONO_CALLBACK_PRIORITY_DEFERRED, NULL);
+	node = _ofono_callback_call_disconnected_node_create(cb, data,
+								priority);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("call_disconnected", owner);
 
-	cbs_call_disconnected = eina_inlist_append(cbs_call_disconnected,
-							EINA_INLIST_GET(node));
+	cbs_call_disconnected = _ofono_callback_call_disconnected_list_insert(
+		cbs_call_disconnected, node);
 
 	return node;
 }
 
-OFono_Callback_List_USSD_Notify_Node *ofono_ussd_notify_cb_add(
+OFono_Callback_List_USSD_Notify_Node *ofono_ussd_notify_cb_add_full(
 	void (*cb)(void *data, Eina_Bool needs_reply, const char *msg),
-	const void *data)
+	const void *data, const char *owner)
 {
 	OFono_Callback_List_USSD_Notify_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
 	node = _ofono_callback_ussd_notify_node_create(cb, data);
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("ussd_notify", owner);
 
 	cbs_ussd_notify = eina_inlist_append(cbs_ussd_notify,
 						EINA_INLIST_GET(node));
@@ -3697,6 +4700,8 @@ static void _ofono_callback_call_list_delete(Eina_Inlist **list,
 {
 	EINA_SAFETY_ON_NULL_RETURN(*list);
 	*list = eina_inlist_remove(*list, EINA_INLIST_GET(node));
+	if (node->priority == OFONO_CALLBACK_PRIORITY_DEFERRED)
+		_call_deferred_node_del(node);
 	free(node);
 }
 
@@ -3713,6 +4718,8 @@ void ofono_call_disconnected_cb_del(
 	EINA_SAFETY_ON_NULL_RETURN(cbs_call_disconnected);
 	cbs_call_disconnected = eina_inlist_remove(cbs_call_disconnected,
 							EINA_INLIST_GET(node));
+	if (node->priority == OFONO_CALLBACK_PRIORITY_DEFERRED)
+		_call_deferred_node_del(node);
 	free(node);
 }
 
@@ -3738,13 +4745,15 @@ void ofono_call_removed_cb_del(OFono_Callback_List_Call_Node *node)
 }
 
 OFono_Callback_List_Sent_SMS_Node *
-ofono_sent_sms_changed_cb_add(OFono_Sent_SMS_Cb cb, const void *data)
+ofono_sent_sms_changed_cb_add_full(OFono_Sent_SMS_Cb cb, const void *data,
+					const char *owner)
 {
 	OFono_Callback_List_Sent_SMS_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
 	node = calloc(1, sizeof(OFono_Callback_List_Sent_SMS_Node));
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("sent_sms_changed", owner);
 	node->cb = cb;
 	node->cb_data = data;
 
@@ -3763,13 +4772,15 @@ void ofono_sent_sms_changed_cb_del(OFono_Callback_List_Sent_SMS_Node *node)
 }
 
 OFono_Callback_List_Incoming_SMS_Node *
-ofono_incoming_sms_cb_add(OFono_Incoming_SMS_Cb cb, const void *data)
+ofono_incoming_sms_cb_add_full(OFono_Incoming_SMS_Cb cb, const void *data,
+				const char *owner)
 {
 	OFono_Callback_List_Incoming_SMS_Node *node;
 
 	EINA_SAFETY_ON_NULL_RETURN_VAL(cb, NULL);
 	node = calloc(1, sizeof(OFono_Callback_List_Incoming_SMS_Node));
 	EINA_SAFETY_ON_NULL_RETURN_VAL(node, NULL);
+	node->stat = _cb_stat_get("incoming_sms", owner);
 	node->cb = cb;
 	node->cb_data = data;
 
@@ -103,6 +103,7 @@ OFono_Pending *ofono_call_answer(OFono_Call *c, OFono_Simple_Cb cb,
 					const void *data);
 
 OFono_Call_State ofono_call_state_get(const OFono_Call *c);
+const char *ofono_call_path_get(const OFono_Call *c);
 const char *ofono_call_name_get(const OFono_Call *c);
 const char *ofono_call_line_id_get(const OFono_Call *c);
 Eina_Bool ofono_call_multiparty_get(const OFono_Call *c);
@@ -112,26 +113,100 @@ time_t ofono_call_full_start_time_get(const OFono_Call *c);
 #define ofono_call_state_valid_check(c) \
 	(ofono_call_state_get(c) != OFONO_CALL_STATE_DISCONNECTED)
 
-OFono_Callback_List_Call_Node *ofono_call_added_cb_add(
-	void (*cb)(void *data,OFono_Call *call), const void *data);
-
-OFono_Callback_List_Call_Node *ofono_call_removed_cb_add(
-	void (*cb)(void *data, OFono_Call *call), const void *data);
-
-OFono_Callback_List_Call_Node *ofono_call_changed_cb_add(
-	void (*cb)(void *data, OFono_Call *call), const void *data);
-
-OFono_Callback_List_Call_Disconnected_Node *ofono_call_disconnected_cb_add(
+/* Order in which the callbacks of a call event run, in the order they
+ * were added within a class. Deferred ones run from an idler once the
+ * frame is done, in the order of the events, and see the call as it is
+ * then, missing the states it went through in between. A removed call
+ * stays valid, but no longer updated, until the deferred callbacks of
+ * its removal ran.
+ */
+typedef enum
+{
+	OFONO_CALLBACK_PRIORITY_REALTIME = 0, /* UI following the call */
+	OFONO_CALLBACK_PRIORITY_NORMAL,
+	OFONO_CALLBACK_PRIORITY_DEFERRED /* only the latest state matters */
+} OFono_Callback_Priority;
+
+/* The *_cb_add() below are macros passing the file adding the callback,
+ * it is what callback profiling reports them under. The call ones add
+ * normal priority callbacks, *_cb_priority_add() take the class.
+ */
+OFono_Callback_List_Call_Node *ofono_call_added_cb_add_full(
+	void (*cb)(void *data,OFono_Call *call), const void *data,
+	OFono_Callback_Priority priority, const char *owner);
+#define ofono_call_added_cb_add(cb, data) \
+	ofono_call_added_cb_add_full(cb, data, \
+					OFONO_CALLBACK_PRIORITY_NORMAL, __FILE__)
+#define ofono_call_added_cb_priority_add(cb, data, priority) \
+	ofono_call_added_cb_add_full(cb, data, priority, __FILE__)
+
+OFono_Callback_List_Call_Node *ofono_call_removed_cb_add_full(
+	void (*cb)(void *data, OFono_Call *call), const void *data,
+	OFono_Callback_Priority priority, const char *owner);
+#define ofono_call_removed_cb_add(cb, data) \
+	ofono_call_removed_cb_add_full(cb, data, \
+					OFONO_CALLBACK_PRIORITY_NORMAL, __FILE__)
+#define ofono_call_removed_cb_priority_add(cb, data, priority) \
+	ofono_call_removed_cb_add_full(cb, data, priority, __FILE__)
+
+OFono_Callback_List_Call_Node *ofono_call_changed_cb_add_full(
+	void (*cb)(void *data, OFono_Call *call), const void *data,
+	OFono_Callback_Priority priority, const char *owner);
+#define ofono_call_changed_cb_add(cb, data) \
+	ofono_call_changed_cb_add_full(cb, data, \
+					OFONO_CALLBACK_PRIORITY_NORMAL, __FILE__)
+#define ofono_call_changed_cb_priority_add(cb, data, priority) \
+	ofono_call_changed_cb_add_full(cb, data, priority, __FILE__)
+
+OFono_Callback_List_Call_Disconnected_Node *ofono_call_disconnected_cb_add_full(
 	void (*cb)(void *data, OFono_Call *call, const char *reason),
-	const void *data);
-
-OFono_Callback_List_USSD_Notify_Node *ofono_ussd_notify_cb_add(
+	const void *data, OFono_Callback_Priority priority,
+	const char *owner);
+#define ofono_call_disconnected_cb_add(cb, data) \
+	ofono_call_disconnected_cb_add_full(cb, data, \
+					OFONO_CALLBACK_PRIORITY_NORMAL, __FILE__)
+#define ofono_call_disconnected_cb_priority_add(cb, data, priority) \
+	ofono_call_disconnected_cb_add_full(cb, data, priority, __FILE__)
+
+OFono_Callback_List_USSD_Notify_Node *ofono_ussd_notify_cb_add_full(
 	void (*cb)(void *data, Eina_Bool needs_reply, const char *msg),
-	const void *data);
+	const void *data, const char *owner);
+#define ofono_ussd_notify_cb_add(cb, data) \
+	ofono_ussd_notify_cb_add_full(cb, data, __FILE__)
 
 OFono_Pending *ofono_tones_send(const char *tones, OFono_Simple_Cb cb,
 				const void *data);
 
+/* DTMF queue: tones pushed within coalesce seconds go in one SendTones,
+ * at most depth of them in flight. oFono plays them in order. The first
+ * tone after a pause is sent right away. cb is called with the tones of
+ * each SendTones once oFono replied, it must not free the queue.
+ */
+typedef struct _OFono_Tones_Queue OFono_Tones_Queue;
+
+typedef struct _OFono_Tones_Queue_Stats
+{
+	unsigned int queued; /* tones */
+	unsigned int sent;
+	unsigned int failed;
+	unsigned int calls; /* SendTones */
+	double latency_avg; /* of each tone, from push to the reply */
+	double latency_max;
+} OFono_Tones_Queue_Stats;
+
+typedef void (*OFono_Tones_Queue_Cb)(void *data, const char *tones,
+					OFono_Error error);
+
+OFono_Tones_Queue *ofono_tones_queue_new(unsigned int depth, double coalesce,
+						OFono_Tones_Queue_Cb cb,
+						const void *data);
+void ofono_tones_queue_free(OFono_Tones_Queue *q);
+
+Eina_Bool ofono_tones_queue_push(OFono_Tones_Queue *q, const char *tones);
+
+void ofono_tones_queue_stats_get(const OFono_Tones_Queue *q,
+					OFono_Tones_Queue_Stats *stats);
+
 void ofono_call_changed_cb_del(OFono_Callback_List_Call_Node *callback_node);
 void ofono_call_disconnected_cb_del(OFono_Callback_List_Call_Disconnected_Node *callback_node);
 void ofono_ussd_notify_cb_del(OFono_Callback_List_USSD_Notify_Node *callback_node);
@@ -199,19 +274,83 @@ const char *ofono_message_alphabet_get(void);
 OFono_Pending *ofono_sms_send(const char *number, const char *message,
 				OFono_Sent_SMS_Cb cb, const void *data);
 
+/* SMS send queue: sends to many numbers, at most window messages at a
+ * time, and retries the ones oFono was too busy or too slow for.
+ * SENT means oFono took the message, see ofono_sent_sms_state_get().
+ * cb must not free the queue.
+ */
+typedef struct _OFono_SMS_Queue OFono_SMS_Queue;
+
+typedef enum
+{
+	OFONO_SMS_QUEUE_STATE_WAITING = 0,
+	OFONO_SMS_QUEUE_STATE_SENDING,
+	OFONO_SMS_QUEUE_STATE_RETRY,
+	OFONO_SMS_QUEUE_STATE_SENT,
+	OFONO_SMS_QUEUE_STATE_FAILED
+} OFono_SMS_Queue_State;
+
+typedef struct _OFono_SMS_Queue_Stats
+{
+	unsigned int queued;
+	unsigned int waiting;
+	unsigned int sending;
+	unsigned int sent;
+	unsigned int failed;
+	unsigned int retries;
+	double busy_time; /* seconds with messages in the queue */
+	double rate; /* sent per second of busy_time */
+	double latency_avg; /* from push to sent */
+	double latency_max;
+} OFono_SMS_Queue_Stats;
+
+typedef void (*OFono_SMS_Queue_Cb)(void *data, void *item_data,
+					const char *number,
+					OFono_SMS_Queue_State state,
+					OFono_Error error,
+					OFono_Sent_SMS *sms);
+
+OFono_SMS_Queue *ofono_sms_queue_new(unsigned int window,
+					OFono_SMS_Queue_Cb cb,
+					const void *data);
+void ofono_sms_queue_free(OFono_SMS_Queue *q);
+
+/* the delay doubles after each try */
+void ofono_sms_queue_retry_set(OFono_SMS_Queue *q, unsigned int retries,
+				double delay);
+
+/* item_data is given back to cb with the states of this message */
+Eina_Bool ofono_sms_queue_push(OFono_SMS_Queue *q, const char *number,
+				const char *message, const void *item_data);
+
+void ofono_sms_queue_stats_get(const OFono_SMS_Queue *q,
+				OFono_SMS_Queue_Stats *stats);
+
 OFono_Sent_SMS_State ofono_sent_sms_state_get(const OFono_Sent_SMS *sms);
 const char *ofono_sent_sms_destination_get(const OFono_Sent_SMS *sms);
 const char *ofono_sent_sms_message_get(const OFono_Sent_SMS *sms);
 time_t ofono_sent_sms_timestamp_get(const OFono_Sent_SMS *sms);
 
+/* whether the messages oFono had before we started are known yet */
+Eina_Bool ofono_sent_sms_fetched_get(void);
+
+/* messages oFono is still sending, including the ones of others */
+unsigned int ofono_sent_sms_pending_count_get(void);
+
 OFono_Pending *ofono_sent_sms_cancel(OFono_Sent_SMS *sms, OFono_Simple_Cb cb, const void *data);
 
-OFono_Callback_List_Sent_SMS_Node *ofono_sent_sms_changed_cb_add(OFono_Sent_SMS_Cb cb,
-									const void *data);
+OFono_Callback_List_Sent_SMS_Node *ofono_sent_sms_changed_cb_add_full(OFono_Sent_SMS_Cb cb,
+									const void *data,
+									const char *owner);
+#define ofono_sent_sms_changed_cb_add(cb, data) \
+	ofono_sent_sms_changed_cb_add_full(cb, data, __FILE__)
 void ofono_sent_sms_changed_cb_del(OFono_Callback_List_Sent_SMS_Node *node);
 
-OFono_Callback_List_Incoming_SMS_Node *ofono_incoming_sms_cb_add(OFono_Incoming_SMS_Cb cb,
-										const void *data);
+OFono_Callback_List_Incoming_SMS_Node *ofono_incoming_sms_cb_add_full(OFono_Incoming_SMS_Cb cb,
+										const void *data,
+										const char *owner);
+#define ofono_incoming_sms_cb_add(cb, data) \
+	ofono_incoming_sms_cb_add_full(cb, data, __FILE__)
 void ofono_incoming_sms_cb_del(OFono_Callback_List_Incoming_SMS_Node *node);
 
 /* Setup: */
@@ -223,14 +362,22 @@ void ofono_modem_path_wanted_set(const char *path);
 
 unsigned int ofono_modem_api_get(void);
 
-OFono_Callback_List_Modem_Node *ofono_modem_conected_cb_add(void (*cb)(void *data),
-							const void *data);
+OFono_Callback_List_Modem_Node *ofono_modem_conected_cb_add_full(void (*cb)(void *data),
+							const void *data,
+							const char *owner);
+#define ofono_modem_conected_cb_add(cb, data) \
+	ofono_modem_conected_cb_add_full(cb, data, __FILE__)
 
-OFono_Callback_List_Modem_Node *ofono_modem_disconnected_cb_add(
-	void (*cb)(void *data), const void *data);
+OFono_Callback_List_Modem_Node *ofono_modem_disconnected_cb_add_full(
+	void (*cb)(void *data), const void *data, const char *owner);
+#define ofono_modem_disconnected_cb_add(cb, data) \
+	ofono_modem_disconnected_cb_add_full(cb, data, __FILE__)
 
-OFono_Callback_List_Modem_Node *ofono_modem_changed_cb_add(void (*cb)(void *data),
-							const void *data);
+OFono_Callback_List_Modem_Node *ofono_modem_changed_cb_add_full(void (*cb)(void *data),
+							const void *data,
+							const char *owner);
+#define ofono_modem_changed_cb_add(cb, data) \
+	ofono_modem_changed_cb_add_full(cb, data, __FILE__)
 
 void ofono_modem_changed_cb_del(OFono_Callback_List_Modem_Node *callback_node);
 void ofono_modem_disconnected_cb_del(OFono_Callback_List_Modem_Node *callback_node);
@@ -240,6 +387,29 @@ void ofono_pending_cancel(OFono_Pending *pending);
 
 const char *ofono_error_message_get(OFono_Error e);
 
+/* Callback profiling, on if OFONO_EFL_CB_PROFILE is set: each callback
+ * run is timed and counted under its list and the file that added it.
+ * The variable is how many of the slowest are logged (INF) by
+ * ofono_shutdown(), 10 if it is not a positive number.
+ */
+#define OFONO_CB_PROFILE_ENV "OFONO_EFL_CB_PROFILE"
+
+typedef struct _OFono_Callback_Stat
+{
+	const char *list; /* "call_changed", "incoming_sms"... */
+	const char *owner; /* file that added the callbacks */
+	unsigned int calls;
+	double total; /* seconds */
+	double max;
+} OFono_Callback_Stat;
+
+Eina_Bool ofono_callback_profile_enabled_get(void);
+
+/* up to max stats, the most total time first, NULL if profiling is off.
+ * The stats belong to ofono, free the list with eina_list_free().
+ */
+Eina_List *ofono_callback_stats_get(unsigned int max);
+
 Eina_Bool ofono_init(void);
 void ofono_shutdown(void);
 
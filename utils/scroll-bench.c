@@ -0,0 +1,433 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Elementary.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "log.h"
+#include "scroll-bench.h"
+
+#define SCROLL_BENCH_DELAY 3.0 /* after the last list, for data to load */
+#define SCROLL_BENCH_PAUSE 0.5 /* between lists */
+#define SCROLL_BENCH_STEP 32
+#define SCROLL_BENCH_FRAMES_MAX 20000
+#define SCROLL_BENCH_DROPPED 1.5 /* frame times */
+#define SCROLL_BENCH_SLOTS 8 /* item classes that can be counted */
+
+typedef struct _Run {
+	Evas_Object *genlist;
+	const char *name;
+	Evas_Object *clipper; /* to restore after the run */
+	Evas_Coord x, y, w, h;
+	Eina_Bool visible;
+	Evas_Coord pos;
+	Evas_Coord last_y;
+	unsigned int items;
+	unsigned int realized;
+	unsigned int dropped;
+	double last_render;
+	Eina_Inarray *frames; /* double, between renders */
+	Eina_Inarray *realizes; /* double, to calculate each step */
+} Run;
+
+typedef struct _Slot {
+	Elm_Genlist_Item_Class *itc;
+	Elm_Gen_Item_Text_Get_Cb text_get;
+	Elm_Gen_Item_Content_Get_Cb content_get;
+} Slot;
+
+/* -1 not checked yet, 0 disabled */
+static int bench_enabled = -1;
+static FILE *report = NULL;
+static Eina_List *runs = NULL; /* waiting for their turn */
+static Run *current = NULL;
+static Ecore_Timer *next_timer = NULL;
+static Ecore_Animator *animator = NULL;
+static Evas_Coord step = SCROLL_BENCH_STEP;
+static Slot slots[SCROLL_BENCH_SLOTS];
+static unsigned int text_gets = 0;
+static unsigned int content_gets = 0;
+static Eina_Bool header_done = EINA_FALSE;
+
+static char *_slot_text_get(unsigned int n, void *data, Evas_Object *obj,
+				const char *part)
+{
+	text_gets++;
+	return slots[n].text_get(data, obj, part);
+}
+
+static Evas_Object *_slot_content_get(unsigned int n, void *data,
+					Evas_Object *obj, const char *part)
+{
+	content_gets++;
+	return slots[n].content_get(data, obj, part);
+}
+
+/* the item class is not passed to its functions, one pair per slot */
+#define SLOT_FUNCS(n)							\
+	static char *_slot_text_get_##n(void *data, Evas_Object *obj,	\
+					const char *part)		\
+	{								\
+		return _slot_text_get(n, data, obj, part);		\
+	}								\
+	static Evas_Object *_slot_content_get_##n(void *data,		\
+						Evas_Object *obj,	\
+						const char *part)	\
+	{								\
+		return _slot_content_get(n, data, obj, part);		\
+	}
+
+SLOT_FUNCS(0)
+SLOT_FUNCS(1)
+SLOT_FUNCS(2)
+SLOT_FUNCS(3)
+SLOT_FUNCS(4)
+SLOT_FUNCS(5)
+SLOT_FUNCS(6)
+SLOT_FUNCS(7)
+
+static const struct {
+	Elm_Gen_Item_Text_Get_Cb text_get;
+	Elm_Gen_Item_Content_Get_Cb content_get;
+} slot_funcs[SCROLL_BENCH_SLOTS] = {
+	{_slot_text_get_0, _slot_content_get_0},
+	{_slot_text_get_1, _slot_content_get_1},
+	{_slot_text_get_2, _slot_content_get_2},
+	{_slot_text_get_3, _slot_content_get_3},
+	{_slot_text_get_4, _slot_content_get_4},
+	{_slot_text_get_5, _slot_content_get_5},
+	{_slot_text_get_6, _slot_content_get_6},
+	{_slot_text_get_7, _slot_content_get_7}
+};
+
+/* counting stays on until the program exits */
+static void _slot_wrap(Elm_Genlist_Item_Class *itc)
+{
+	unsigned int i;
+
+	for (i = 0; i < SCROLL_BENCH_SLOTS; i++) {
+		if (slots[i].itc == itc)
+			return;
+		if (!slots[i].itc)
+			break;
+	}
+
+	if (i == SCROLL_BENCH_SLOTS) {
+		WRN("More than %u item classes, calls of %p not counted",
+			SCROLL_BENCH_SLOTS, itc);
+		return;
+	}
+
+	slots[i].itc = itc;
+	slots[i].text_get = itc->func.text_get;
+	slots[i].content_get = itc->func.content_get;
+	if (itc->func.text_get)
+		itc->func.text_get = slot_funcs[i].text_get;
+	if (itc->func.content_get)
+		itc->func.content_get = slot_funcs[i].content_get;
+}
+
+Eina_Bool scroll_bench_enabled_get(void)
+{
+	const char *path, *s;
+
+	if (bench_enabled >= 0)
+		return bench_enabled;
+
+	bench_enabled = 0;
+	path = getenv(SCROLL_BENCH_ENV);
+	if ((!path) || (path[0] == '\0'))
+		return EINA_FALSE;
+
+	report = fopen(path, "a");
+	if (!report) {
+		ERR("Could not open %s: %s", path, strerror(errno));
+		return EINA_FALSE;
+	}
+
+	s = getenv(SCROLL_BENCH_STEP_ENV);
+	if ((s) && (atoi(s) > 0))
+		step = atoi(s);
+
+	bench_enabled = 1;
+	return EINA_TRUE;
+}
+
+static void _run_free(Run *run)
+{
+	eina_stringshare_del(run->name);
+	if (run->frames)
+		eina_inarray_free(run->frames);
+	if (run->realizes)
+		eina_inarray_free(run->realizes);
+	free(run);
+}
+
+static int _double_cmp(const void *a, const void *b)
+{
+	const double *da = a, *db = b;
+
+	if (*da < *db)
+		return -1;
+	return *da > *db;
+}
+
+/* nearest rank, in ms */
+static double _percentile_ms(Eina_Inarray *values, unsigned int p)
+{
+	unsigned int count = eina_inarray_count(values), rank;
+
+	if (count == 0)
+		return 0.0;
+
+	rank = (count * p + 99) / 100;
+	if (rank > 0)
+		rank--;
+	return *(double *)eina_inarray_nth(values, rank) * 1000.0;
+}
+
+static void _run_report(Run *run)
+{
+	if (!header_done) {
+		fprintf(report, "%-16s %7s %6s %27s %7s %27s %8s %8s %8s\n",
+			"", "", "", "frame (ms)", "", "realize (ms)", "", "",
+			"");
+		fprintf(report, "%-16s %7s %6s %8s %8s %9s %7s %8s %8s %9s "
+			"%8s %8s %8s\n", "list", "items", "frames", "p50",
+			"p99", "max", "dropped", "p50", "p99", "max",
+			"realized", "text", "content");
+		header_done = EINA_TRUE;
+	}
+
+	eina_inarray_sort(run->frames, _double_cmp);
+	eina_inarray_sort(run->realizes, _double_cmp);
+
+	fprintf(report, "%-16s %7u %6u %8.2f %8.2f %9.2f %7u %8.2f %8.2f "
+		"%9.2f %8u %8u %8u\n", run->name, run->items,
+		eina_inarray_count(run->frames),
+		_percentile_ms(run->frames, 50),
+		_percentile_ms(run->frames, 99),
+		_percentile_ms(run->frames, 100), run->dropped,
+		_percentile_ms(run->realizes, 50),
+		_percentile_ms(run->realizes, 99),
+		_percentile_ms(run->realizes, 100), run->realized,
+		text_gets, content_gets);
+	fflush(report);
+}
+
+static Eina_Bool _bench_next(void *data);
+static void _on_genlist_del(void *data, Evas *e, Evas_Object *obj,
+				void *event);
+
+static void _on_realized(void *data, Evas_Object *obj __UNUSED__,
+				void *event_info __UNUSED__)
+{
+	Run *run = data;
+	run->realized++;
+}
+
+static void _on_render_post(void *data, Evas *e __UNUSED__,
+				void *event_info __UNUSED__)
+{
+	Run *run = data;
+	double now = ecore_time_get();
+	double interval;
+
+	if (run->last_render > 0.0) {
+		interval = now - run->last_render;
+		eina_inarray_push(run->frames, &interval);
+		if (interval > ecore_animator_frametime_get() *
+				SCROLL_BENCH_DROPPED)
+			run->dropped++;
+	}
+	run->last_render = now;
+}
+
+static void _run_end(Run *run)
+{
+	Evas *e = evas_object_evas_get(run->genlist);
+
+	if (animator) {
+		ecore_animator_del(animator);
+		animator = NULL;
+	}
+
+	evas_event_callback_del_full(e, EVAS_CALLBACK_RENDER_POST,
+					_on_render_post, run);
+	evas_object_smart_callback_del(run->genlist, "realized",
+					_on_realized);
+	evas_object_event_callback_del_full(run->genlist, EVAS_CALLBACK_DEL,
+						_on_genlist_del, run);
+
+	evas_object_move(run->genlist, run->x, run->y);
+	evas_object_resize(run->genlist, run->w, run->h);
+	if (run->clipper)
+		evas_object_clip_set(run->genlist, run->clipper);
+	if (!run->visible)
+		evas_object_hide(run->genlist);
+
+	_run_report(run);
+
+	current = NULL;
+	_run_free(run);
+	next_timer = ecore_timer_add(SCROLL_BENCH_PAUSE, _bench_next, NULL);
+}
+
+static Eina_Bool _on_frame(void *data)
+{
+	Run *run = data;
+	Evas *e = evas_object_evas_get(run->genlist);
+	Evas_Coord y, w, h;
+	double t, realize;
+
+	elm_scroller_region_get(run->genlist, NULL, &y, &w, &h);
+	if ((run->pos > 0) && (y == run->last_y)) {
+		DBG("%s: bottom at %d", run->name, y);
+		_run_end(run);
+		return ECORE_CALLBACK_CANCEL;
+	}
+	if (eina_inarray_count(run->realizes) >= SCROLL_BENCH_FRAMES_MAX) {
+		WRN("%s: stopped after %u frames", run->name,
+			SCROLL_BENCH_FRAMES_MAX);
+		_run_end(run);
+		return ECORE_CALLBACK_CANCEL;
+	}
+
+	run->last_y = y;
+	run->pos += step;
+	elm_scroller_region_show(run->genlist, 0, run->pos, w, h);
+
+	/* realizes the items now rather than in the render */
+	t = ecore_time_get();
+	evas_smart_objects_calculate(e);
+	realize = ecore_time_get() - t;
+	eina_inarray_push(run->realizes, &realize);
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+static void _run_start(Run *run)
+{
+	Evas_Object *win = elm_object_top_widget_get(run->genlist);
+	Evas *e = evas_object_evas_get(run->genlist);
+	Elm_Object_Item *it;
+	Evas_Coord w, h;
+
+	DBG("%s", run->name);
+
+	if (win)
+		evas_object_show(win);
+	evas_output_viewport_get(e, NULL, NULL, &w, &h);
+
+	evas_object_geometry_get(run->genlist, &run->x, &run->y,
+					&run->w, &run->h);
+	run->clipper = evas_object_clip_get(run->genlist);
+	run->visible = evas_object_visible_get(run->genlist);
+
+	evas_object_clip_unset(run->genlist);
+	evas_object_move(run->genlist, 0, 0);
+	evas_object_resize(run->genlist, w, h);
+	evas_object_raise(run->genlist);
+	evas_object_show(run->genlist);
+
+	it = elm_genlist_first_item_get(run->genlist);
+	for (; it != NULL; it = elm_genlist_item_next_get(it)) {
+		Elm_Genlist_Item_Class *itc = (Elm_Genlist_Item_Class *)
+			elm_genlist_item_item_class_get(it);
+		if (itc)
+			_slot_wrap(itc);
+		run->items++;
+	}
+
+	text_gets = content_gets = 0;
+	evas_object_smart_callback_add(run->genlist, "realized",
+					_on_realized, run);
+	evas_event_callback_add(e, EVAS_CALLBACK_RENDER_POST,
+				_on_render_post, run);
+
+	elm_scroller_region_show(run->genlist, 0, 0, w, h);
+	evas_smart_objects_calculate(e);
+	run->realized = 0;
+
+	animator = ecore_animator_add(_on_frame, run);
+}
+
+static Eina_Bool _bench_next(void *data __UNUSED__)
+{
+	Run *run;
+
+	next_timer = NULL;
+
+	if (current)
+		return ECORE_CALLBACK_CANCEL;
+
+	if (!runs) {
+		INF("Scroll benchmark done");
+		fclose(report);
+		report = NULL;
+		elm_exit();
+		return ECORE_CALLBACK_CANCEL;
+	}
+
+	run = eina_list_data_get(runs);
+	runs = eina_list_remove_list(runs, runs);
+	current = run;
+	_run_start(run);
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _on_genlist_del(void *data, Evas *e,
+				Evas_Object *obj __UNUSED__,
+				void *event __UNUSED__)
+{
+	Run *run = data;
+
+	if (run == current) {
+		/* the program is going away, nothing to restore */
+		if (animator) {
+			ecore_animator_del(animator);
+			animator = NULL;
+		}
+		evas_event_callback_del_full(e, EVAS_CALLBACK_RENDER_POST,
+						_on_render_post, run);
+		current = NULL;
+	} else
+		runs = eina_list_remove(runs, run);
+	_run_free(run);
+}
+
+void scroll_bench_genlist_add(Evas_Object *genlist, const char *name)
+{
+	Run *run;
+
+	if (!scroll_bench_enabled_get())
+		return;
+
+	EINA_SAFETY_ON_NULL_RETURN(genlist);
+	EINA_SAFETY_ON_NULL_RETURN(name);
+
+	run = calloc(1, sizeof(Run));
+	EINA_SAFETY_ON_NULL_RETURN(run);
+	run->genlist = genlist;
+	run->name = eina_stringshare_add(name);
+	run->frames = eina_inarray_new(sizeof(double), 256);
+	run->realizes = eina_inarray_new(sizeof(double), 256);
+	if ((!run->frames) || (!run->realizes)) {
+		_run_free(run);
+		return;
+	}
+
+	evas_object_event_callback_add(genlist, EVAS_CALLBACK_DEL,
+					_on_genlist_del, run);
+	runs = eina_list_append(runs, run);
+
+	/* starts once lists stop coming, the current run starts the next */
+	if (current)
+		return;
+	if (next_timer)
+		ecore_timer_del(next_timer);
+	next_timer = ecore_timer_add(SCROLL_BENCH_DELAY, _bench_next, NULL);
+}
@@ -0,0 +1,34 @@
+#ifndef _EFL_OFONO_SCROLL_BENCH_H__
+#define _EFL_OFONO_SCROLL_BENCH_H__ 1
+
+/*
+ * Scroll benchmark of the genlists, built in with --enable-scroll-bench
+ * only. It is on if OFONO_EFL_SCROLL_BENCH names a file to append the
+ * report to.
+ *
+ * Lists register when they are created. A while after the last one,
+ * each is scrolled from top to bottom in turn, a step every animator
+ * frame, then the program exits. For each list the report has the
+ * time between rendered frames and the frames dropped, the time to
+ * realize the items of each step, and the calls to the text_get and
+ * content_get of its item classes.
+ *
+ * A list is laid over the whole window for its run, out of the clipper
+ * of its tab, so lists in hidden tabs are measured the same way.
+ */
+
+#define SCROLL_BENCH_ENV "OFONO_EFL_SCROLL_BENCH"
+#define SCROLL_BENCH_STEP_ENV "OFONO_EFL_SCROLL_BENCH_STEP" /* pixels */
+
+#ifdef HAVE_SCROLL_BENCH
+Eina_Bool scroll_bench_enabled_get(void);
+
+/* does nothing unless enabled */
+void scroll_bench_genlist_add(Evas_Object *genlist, const char *name);
+#else
+#define scroll_bench_enabled_get() EINA_FALSE
+#define scroll_bench_genlist_add(genlist, name) \
+	do { (void)(genlist); (void)(name); } while (0)
+#endif
+
+#endif
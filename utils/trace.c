@@ -0,0 +1,65 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <Eina.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+/* -1 not checked yet, -2 disabled */
+static int trace_fd = -1;
+
+Eina_Bool trace_enabled_get(void)
+{
+	const char *path;
+
+	if (trace_fd >= 0)
+		return EINA_TRUE;
+	if (trace_fd == -2)
+		return EINA_FALSE;
+
+	trace_fd = -2;
+	path = getenv(TRACE_ENV);
+	if ((!path) || (path[0] == '\0'))
+		return EINA_FALSE;
+
+	trace_fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (trace_fd < 0) {
+		EINA_LOG_ERR("Could not open trace file %s: %s", path,
+				strerror(errno));
+		trace_fd = -2;
+		return EINA_FALSE;
+	}
+
+	return EINA_TRUE;
+}
+
+void trace_mark(const char *key, const char *hop)
+{
+	struct timespec ts;
+	char buf[256];
+	int len;
+
+	if (!trace_enabled_get())
+		return;
+
+	EINA_SAFETY_ON_NULL_RETURN(hop);
+	if ((!key) || (key[0] == '\0'))
+		key = "-";
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	len = snprintf(buf, sizeof(buf), "%ld.%09ld %s %s\n",
+			(long)ts.tv_sec, ts.tv_nsec, key, hop);
+	if ((len <= 0) || (len >= (int)sizeof(buf)))
+		return;
+
+	/* a single write with O_APPEND, lines of processes do not mix */
+	if (write(trace_fd, buf, len) != len)
+		EINA_LOG_WARN("Could not write trace of %s %s", key, hop);
+}
@@ -0,0 +1,18 @@
+#ifndef _EFL_OFONO_TRACE_H__
+#define _EFL_OFONO_TRACE_H__ 1
+
+/*
+ * Latency trace of an incoming call, from oFono to the answer screen.
+ *
+ * If OFONO_EFL_TRACE names a file, each hop appends a line with the
+ * monotonic time, the key (the call path) and the hop name. The clock
+ * is shared by all processes, so the dialer and the answer daemon may
+ * write to the same file. Summarize it with ofono-efl-call-trace-report.
+ */
+
+#define TRACE_ENV "OFONO_EFL_TRACE"
+
+Eina_Bool trace_enabled_get(void);
+void trace_mark(const char *key, const char *hop);
+
+#endif
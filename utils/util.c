@@ -12,6 +12,26 @@
 
 static char def_theme[PATH_MAX] = "";
 
+/* decoded pictures kept alive by a hidden image per canvas and size, so
+ * icons of the same picture hit the evas image cache instead of
+ * decoding the file again.
+ */
+#define PICTURE_CACHE_BYTES (4 * 1024 * 1024)
+/* resolved picture paths kept, all are dropped when it is reached */
+#define PICTURE_PATHS_MAX 256
+
+typedef struct _Picture_Cache_Item {
+	EINA_INLIST;
+	const char *key; /* canvas, size and path */
+	Evas_Object *holder;
+	unsigned int bytes;
+} Picture_Cache_Item;
+
+static Eina_Hash *picture_paths = NULL; /* picture -> file */
+static Eina_Hash *picture_items = NULL; /* key -> Picture_Cache_Item */
+static Eina_Inlist *picture_lru = NULL; /* least recently used first */
+static unsigned int picture_bytes = 0;
+
 /* TODO: find a configurable way to format the number.
  * Right now it's: 1-234-567-8901 as per
  * http://en.wikipedia.org/wiki/Local_conventions_for_writing_telephone_numbers#North_America
@@ -130,24 +150,166 @@ char *date_short_format(time_t date)
 	return buf;
 }
 
+static const char *_picture_path_get(const char *picture)
+{
+	const char *path;
+
+	if (!picture_paths)
+		picture_paths = eina_hash_string_superfast_new(
+			EINA_FREE_CB(eina_stringshare_del));
+	EINA_SAFETY_ON_NULL_RETURN_VAL(picture_paths, NULL);
+
+	path = eina_hash_find(picture_paths, picture);
+	if (path)
+		return path;
+
+	if (eina_hash_population(picture_paths) >= PICTURE_PATHS_MAX)
+		eina_hash_free_buckets(picture_paths);
+
+#ifdef HAVE_TIZEN
+	path = eina_stringshare_add(picture);
+#else
+	path = eina_stringshare_printf("%s/%s/%s", efreet_config_home_get(),
+					PACKAGE_NAME, picture);
+#endif
+	EINA_SAFETY_ON_NULL_RETURN_VAL(path, NULL);
+	eina_hash_add(picture_paths, picture, path);
+	return path;
+}
+
+static void _picture_holder_del(void *data, Evas *e __UNUSED__,
+				Evas_Object *o __UNUSED__,
+				void *event_info __UNUSED__)
+{
+	Picture_Cache_Item *item = data;
+
+	picture_lru = eina_inlist_remove(picture_lru, EINA_INLIST_GET(item));
+	picture_bytes -= item->bytes;
+	eina_hash_del_by_key(picture_items, item->key);
+	eina_stringshare_del(item->key);
+	free(item);
+}
+
+static void _picture_cache_use(Evas *e, const char *path, int size)
+{
+	Picture_Cache_Item *item;
+	const char *key;
+
+	if (!picture_items)
+		picture_items = eina_hash_stringshared_new(NULL);
+	EINA_SAFETY_ON_NULL_RETURN(picture_items);
+
+	key = eina_stringshare_printf("%p %d %s", e, size, path);
+	EINA_SAFETY_ON_NULL_RETURN(key);
+
+	item = eina_hash_find(picture_items, key);
+	if (item) {
+		eina_stringshare_del(key);
+		picture_lru = eina_inlist_demote(picture_lru,
+						EINA_INLIST_GET(item));
+		return;
+	}
+
+	item = calloc(1, sizeof(Picture_Cache_Item));
+	EINA_SAFETY_ON_NULL_GOTO(item, err_item);
+	item->holder = evas_object_image_add(e);
+	EINA_SAFETY_ON_NULL_GOTO(item->holder, err_holder);
+
+	evas_object_image_load_size_set(item->holder, size, size);
+	evas_object_image_file_set(item->holder, path, NULL);
+	if (evas_object_image_load_error_get(item->holder) !=
+		EVAS_LOAD_ERROR_NONE) {
+		ERR("Could not load picture %s", path);
+		goto err_load;
+	}
+	evas_object_image_preload(item->holder, EINA_FALSE);
+
+	item->key = key;
+	item->bytes = size * size * 4;
+	evas_object_event_callback_add(item->holder, EVAS_CALLBACK_DEL,
+					_picture_holder_del, item);
+	eina_hash_add(picture_items, key, item);
+	picture_lru = eina_inlist_append(picture_lru, EINA_INLIST_GET(item));
+	picture_bytes += item->bytes;
+
+	while ((picture_bytes > PICTURE_CACHE_BYTES) &&
+		(picture_lru != EINA_INLIST_GET(item))) {
+		Picture_Cache_Item *old = EINA_INLIST_CONTAINER_GET(
+			picture_lru, Picture_Cache_Item);
+		DBG("evict %s", old->key);
+		evas_object_del(old->holder);
+	}
+	return;
+
+err_load:
+	evas_object_del(item->holder);
+err_holder:
+	free(item);
+err_item:
+	eina_stringshare_del(key);
+}
+
+static void _picture_icon_del(void *data, Evas *e __UNUSED__,
+				Evas_Object *o __UNUSED__,
+				void *event_info __UNUSED__)
+{
+	eina_stringshare_del(data);
+}
+
+/* the theme gave the icon its size, it is decoded at that size only */
+static void _picture_icon_resize(void *data, Evas *e, Evas_Object *icon,
+					void *event_info __UNUSED__)
+{
+	const char *path = data;
+	Evas_Coord w, h;
+	int size;
+
+	evas_object_geometry_get(icon, NULL, NULL, &w, &h);
+	size = (w > h) ? w : h;
+	if (size <= 0)
+		return;
+
+	evas_object_event_callback_del_full(icon, EVAS_CALLBACK_RESIZE,
+						_picture_icon_resize, path);
+	evas_object_event_callback_del_full(icon, EVAS_CALLBACK_DEL,
+						_picture_icon_del, path);
+
+	_picture_cache_use(e, path, size);
+
+	elm_image_prescale_set(icon, size);
+	elm_image_preload_disabled_set(icon, EINA_FALSE);
+	eina_stringshare_del(path);
+}
+
 Evas_Object *picture_icon_get(Evas_Object *parent, const char *picture)
 {
 	Evas_Object *icon = elm_icon_add(parent);
+	const char *path;
 
-	if (!picture || *picture == '\0')
+	if (!picture || *picture == '\0') {
 		elm_icon_standard_set(icon, "no-picture");
-	else {
+		return icon;
+	}
+
+	path = _picture_path_get(picture);
+	if (!path) {
+		elm_icon_standard_set(icon, "no-picture");
+		return icon;
+	}
+
+	/* only the header is read until it is drawn or gets its size */
+	elm_image_preload_disabled_set(icon, EINA_TRUE);
 #ifdef HAVE_TIZEN
-		elm_icon_file_set(icon, picture, NULL);
+	elm_icon_file_set(icon, path, NULL);
 #else
-		char path[PATH_MAX];
-		const char *prefix;
-		prefix = efreet_config_home_get();
-		snprintf(path, sizeof(path), "%s/%s/%s", prefix, PACKAGE_NAME,
-				picture);
-		elm_image_file_set(icon, path, NULL);
+	elm_image_file_set(icon, path, NULL);
 #endif
-	}
+
+	path = eina_stringshare_ref(path);
+	evas_object_event_callback_add(icon, EVAS_CALLBACK_RESIZE,
+					_picture_icon_resize, path);
+	evas_object_event_callback_add(icon, EVAS_CALLBACK_DEL,
+					_picture_icon_del, path);
 	return icon;
 }
 
@@ -195,4 +357,17 @@ Eina_Bool util_init(const char *theme)
 
 void util_shutdown(void)
 {
+	while (picture_lru) {
+		Picture_Cache_Item *item = EINA_INLIST_CONTAINER_GET(
+			picture_lru, Picture_Cache_Item);
+		evas_object_del(item->holder);
+	}
+	if (picture_items) {
+		eina_hash_free(picture_items);
+		picture_items = NULL;
+	}
+	if (picture_paths) {
+		eina_hash_free(picture_paths);
+		picture_paths = NULL;
+	}
 }